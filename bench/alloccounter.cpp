@@ -0,0 +1,61 @@
+#include "alloccounter.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+namespace
+{
+std::atomic<long long> allocations{0};
+}
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+}
+
+bool bench::allocationCountingAvailable()
+{
+    return true;
+}
+
+#else
+
+bool bench::allocationCountingAvailable()
+{
+    return false;
+}
+
+#endif
+
+long long bench::allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace bench
+{
+
+// Number of malloc/calloc/realloc calls made by the whole process so far.
+// Always 0 when the allocator can't be interposed (non-glibc platforms).
+long long allocationCount();
+bool allocationCountingAvailable();
+
+}
@@ -0,0 +1,94 @@
+#include "harness.hpp"
+#include "alloccounter.hpp"
+
+#include <QJsonValue>
+
+#include <algorithm>
+#include <chrono>
+
+namespace bench
+{
+
+namespace
+{
+
+auto percentile(std::vector<qint64> const& sorted, double fraction) -> qint64
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+
+    auto index = static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+}
+
+auto BenchResult::toJson() const -> QJsonObject
+{
+    auto sorted = latenciesNs;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto seconds = elapsedNs / 1e9;
+    auto opsPerSec = seconds > 0 ? operations / seconds : 0.0;
+
+    QJsonObject latency{
+        {"p50", percentile(sorted, 0.50)},
+        {"p90", percentile(sorted, 0.90)},
+        {"p99", percentile(sorted, 0.99)},
+        {"max", sorted.empty() ? 0 : sorted.back()},
+    };
+
+    QJsonObject json{
+        {"name", name},
+        {"operations", operations},
+        {"elapsedNs", elapsedNs},
+        {"opsPerSec", opsPerSec},
+        {"latencyNs", latency},
+    };
+
+    if (allocationCountingAvailable())
+    {
+        json.insert("allocations", allocations);
+        json.insert("allocationsPerOp", operations > 0 ? static_cast<double>(allocations) / operations : 0.0);
+    }
+    else
+    {
+        json.insert("allocations", QJsonValue{});
+        json.insert("allocationsPerOp", QJsonValue{});
+    }
+
+    return json;
+}
+
+auto measure(QString const& name, long long iterations, std::function<void(long long)> const& operation) -> BenchResult
+{
+    using Clock = std::chrono::steady_clock;
+
+    // warm up free lists and reusable buffers before counting
+    for (long long i = 0; i < std::min(iterations, 1000LL); ++i)
+    {
+        operation(i);
+    }
+
+    BenchResult result{ name, iterations, 0, 0, {} };
+    result.latenciesNs.resize(static_cast<std::size_t>(iterations));
+
+    auto allocationsBefore = allocationCount();
+    auto begin = Clock::now();
+
+    for (long long i = 0; i < iterations; ++i)
+    {
+        auto start = Clock::now();
+        operation(i);
+        result.latenciesNs[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    result.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+    result.allocations = allocationCount() - allocationsBefore;
+
+    return result;
+}
+
+}
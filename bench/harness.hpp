@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include <functional>
+#include <vector>
+
+namespace bench
+{
+
+struct BenchResult
+{
+    QString name;
+    long long operations;
+    qint64 elapsedNs;
+    long long allocations;
+    std::vector<qint64> latenciesNs;
+
+    auto toJson() const -> QJsonObject;
+};
+
+// Runs the operation `iterations` times after a short warm-up, timing every call.
+// The latency buffer is reserved up front so it doesn't show up in the allocation count.
+auto measure(QString const& name, long long iterations, std::function<void(long long)> const& operation) -> BenchResult;
+
+}
@@ -0,0 +1,621 @@
+#include "texteditoractions.hpp"
+#include "formatactions.hpp"
+#include "editortabwidget.hpp"
+#include "editorobservers.hpp"
+#include "dbussession.hpp"
+#include "alloccounter.hpp"
+#include "harness.hpp"
+#include "textsearch.hpp"
+#include "sessionlog.hpp"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDataStream>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QTextDocument>
+#include <QTextStream>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+using bench::BenchResult;
+using bench::measure;
+
+namespace
+{
+
+struct Frame
+{
+    ActionType type;
+    QByteArray raw;
+};
+
+auto serialize(ActionUP action) -> Frame
+{
+    auto memento = action->getMemento();
+    return Frame{ memento->getActionType(), memento->toRaw() };
+}
+
+// How sendAction framed actions before FrameWriter: the payload serialized on its own
+// and then streamed as a QByteArray into a new frame
+auto packUnbuffered(Memento const* memento, int appId) -> QByteArray
+{
+    QByteArray frame;
+    QDataStream stream{ &frame, QIODevice::WriteOnly };
+    stream << appId << static_cast<int>(memento->getActionType()) << memento->toRaw();
+
+    return frame;
+}
+
+// Keeps the last frame a session sent
+struct CaptureInteraction : public Interaction
+{
+    void sendMessage(QByteArray const& frame) override
+    {
+        last = frame;
+    }
+
+    QByteArray last;
+};
+
+auto generateText(int words) -> QString
+{
+    static QStringList const vocabulary{
+        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+        "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore",
+    };
+
+    QString text;
+    for (int i = 0; i < words; ++i)
+    {
+        text += vocabulary[(i * 7 + i / 3) % vocabulary.size()];
+        text += (i % 12 == 11) ? "\n" : " ";
+    }
+
+    return text;
+}
+
+auto generateHtml(int paragraphs, int seed) -> QString
+{
+    QString html{"<html><body>"};
+
+    for (int i = 0; i < paragraphs; ++i)
+    {
+        auto words = generateText(24 + (i + seed) % 16).split(' ');
+
+        html += QString{"<p style=\"font-size:%1pt\">"}.arg(10 + (i + seed) % 8);
+        for (int w = 0; w < words.size(); ++w)
+        {
+            switch ((w + seed) % 5)
+            {
+            case 0: html += "<b>" + words[w] + "</b> "; break;
+            case 1: html += "<i>" + words[w] + "</i> "; break;
+            case 2: html += "<span style=\"color:#a03020\">" + words[w] + "</span> "; break;
+            default: html += words[w] + " "; break;
+            }
+        }
+        html += "</p>";
+    }
+
+    html += "</body></html>";
+    return html;
+}
+
+// One side of a shared editing session: its own editor, documents and session.
+struct Peer
+{
+    explicit Peer(InProcessBus* bus)
+        : editor{new AdditionalEmiterTextEditor}
+        , docsEditor{editor}
+        , session{DBusSession::create(new InProcessInteraction{bus})}
+    {
+        docsEditor.addDocument("bench", new QTextDocument);
+    }
+
+    ~Peer()
+    {
+        delete session;
+    }
+
+    auto reset(QString const& text) -> void
+    {
+        docsEditor.getCurrentDocument()->setPlainText(text);
+    }
+
+    AdditionalEmiterTextEditor* editor;
+    EditorTabWidget docsEditor;
+    DBusSession* session;
+};
+
+// Sender and receiver wired the way two editor instances are:
+// TextChangeObserver -> DBusSession -> bus -> DBusSession -> DBusActionsObserver.
+struct Pipeline
+{
+    Pipeline()
+        : sender{&bus}
+        , receiver{&bus}
+    {
+        GlobalMementoBuilder::createInstance(&receiver.docsEditor);
+
+        ensureDelivery();
+
+        typing = new TextChangeObserver{ sender.editor, 10, sender.session };
+        applier = new DBusActionsObserver{ receiver.docsEditor.getEditor(), &receiver.docsEditor, receiver.session };
+    }
+
+    auto reset(QString const& text, int cursorPosition) -> void
+    {
+        sender.reset(text);
+        receiver.reset(text);
+
+        auto cursor = sender.editor->textCursor();
+        cursor.setPosition(cursorPosition);
+        sender.editor->setTextCursor(cursor);
+    }
+
+    auto send(ActionUP action) -> void
+    {
+        sender.session->sendAction(std::move(action));
+    }
+
+    InProcessBus bus;
+    Peer sender;
+    Peer receiver;
+    TextChangeObserver* typing{nullptr};
+    DBusActionsObserver* applier{nullptr};
+
+private:
+    // Sessions drop frames carrying their own application id, which is picked at
+    // random; make sure the two peers didn't end up with the same one.
+    auto ensureDelivery() -> void
+    {
+        for (int attempt = 0; attempt < 16; ++attempt)
+        {
+            auto delivered = false;
+            auto probe = QObject::connect(receiver.session, &DBusSession::actionReceived, [&] { delivered = true; });
+            send(ActionUP{ new FormatAlignLeft{sender.editor} });
+            QObject::disconnect(probe);
+
+            if (delivered)
+            {
+                return;
+            }
+
+            delete receiver.session;
+            receiver.session = DBusSession::create(new InProcessInteraction{&bus});
+        }
+
+        throw std::runtime_error{"Can't set up a receiving session with a distinct application id"};
+    }
+};
+
+struct Scenario
+{
+    QString name;
+    long long defaultIterations;
+    std::function<BenchResult(Pipeline&, long long)> run;
+};
+
+auto benchDeserialize(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    auto editor = pipeline.sender.editor;
+
+    std::vector<Frame> frames;
+    frames.emplace_back(serialize(ActionUP{ new TextChangeAction_1{TextChangeType::Added, QChar{'a'}, editor} }));
+    frames.emplace_back(serialize(ActionUP{ new TextChangeAction_1{TextChangeType::Removed, QChar{'b'}, editor} }));
+    frames.emplace_back(serialize(ActionUP{ new FormatBold{true, editor} }));
+    frames.emplace_back(serialize(ActionUP{ new FormatSize{14, editor} }));
+    frames.emplace_back(serialize(ActionUP{ new FormatFamily{"Serif", editor} }));
+    frames.emplace_back(serialize(ActionUP{ new FormatAlignCenter{editor} }));
+
+    auto builder = GlobalMementoBuilder::instance();
+
+    return measure("deserialize", iterations, [&](long long i)
+        {
+            auto const& frame = frames[i % frames.size()];
+            auto data = frame.raw;
+            auto action = builder->deserializeAction(std::move(data), frame.type);
+        }
+    );
+}
+
+auto benchKeystrokeSend(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    auto editor = pipeline.sender.editor;
+    auto session = DBusSession::create(new DisabledInteraction{});
+    auto observer = new TextChangeObserver{ editor, 10, session };
+
+    auto result = measure("keystroke.send", iterations, [&](long long i)
+        {
+            observer->onSymAdded(QChar{'a'});
+        }
+    );
+
+    delete observer;
+    delete session;
+
+    return result;
+}
+
+// Peers running the unbuffered framing must read the same bytes; the application id
+// is the session's own, so only what follows it is compared
+auto checkFrameCompatibility(QTextEdit* editor) -> void
+{
+    auto capture = new CaptureInteraction;
+    auto session = DBusSession::create(capture);
+
+    auto check = [&](ActionUP action)
+    {
+        auto expected = packUnbuffered(action->getMemento(), 0).mid(sizeof(int));
+        session->sendAction(std::move(action));
+
+        if (capture->last.mid(sizeof(int)) != expected)
+        {
+            throw std::runtime_error{"Frames differ from the unbuffered framing"};
+        }
+    };
+
+    check(ActionUP{ new TextChangeAction_1{TextChangeType::Added, QChar{'a'}, editor} });
+    check(ActionUP{ new FormatBold{true, editor} });
+    check(ActionUP{ new FormatAlignLeft{editor} });
+
+    delete session;
+}
+
+// frame.unbuffered against frame.buffered gives the allocations FrameWriter saves per
+// keystroke; both build the action through the pool, so that part is the same
+auto benchFrame(Pipeline& pipeline, long long iterations, bool buffered) -> BenchResult
+{
+    auto editor = pipeline.sender.editor;
+    checkFrameCompatibility(editor);
+
+    auto session = DBusSession::create(new DisabledInteraction{});
+
+    auto result = measure(buffered ? "frame.buffered" : "frame.unbuffered", iterations, [&](long long i)
+        {
+            ActionUP action{ new TextChangeAction_1{TextChangeType::Added, QChar{'a'}, editor} };
+
+            if (buffered)
+            {
+                session->sendAction(std::move(action));
+            }
+            else
+            {
+                auto frame = packUnbuffered(action->getMemento(), 0);
+            }
+        }
+    );
+
+    delete session;
+
+    return result;
+}
+
+auto benchKeystrokeReceive(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    auto editor = pipeline.sender.editor;
+    pipeline.reset(generateText(400), 1000);
+
+    auto added = serialize(ActionUP{ new TextChangeAction_1{TextChangeType::Added, QChar{'a'}, editor} });
+    auto removed = serialize(ActionUP{ new TextChangeAction_1{TextChangeType::Removed, QChar{'a'}, editor} });
+
+    return measure("keystroke.receive", iterations, [&](long long i)
+        {
+            auto const& frame = i % 2 == 0 ? added : removed;
+            emit pipeline.receiver.session->actionReceived(frame.type, frame.raw);
+        }
+    );
+}
+
+// Bursts of twelve characters followed by four backspaces at a fixed caret.
+auto benchTyping(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    pipeline.reset(generateText(400), 1000);
+
+    auto const sample = generateText(64);
+
+    return measure("typing", iterations, [&](long long i)
+        {
+            auto sym = sample[static_cast<int>(i % sample.size())];
+            if (i % 16 < 12)
+            {
+                pipeline.typing->onSymAdded(sym);
+            }
+            else
+            {
+                pipeline.typing->onSymRemoved(sym);
+            }
+        }
+    );
+}
+
+// Every eight operations a new range is selected and formatted the way a user
+// toggles several toolbar buttons in a row.
+auto benchFormatting(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    pipeline.reset(generateText(2000), 0);
+
+    auto editor = pipeline.sender.editor;
+    auto length = editor->document()->characterCount() - 1;
+
+    return measure("formatting", iterations, [&](long long i)
+        {
+            if (i % 8 == 0)
+            {
+                auto begin = static_cast<int>((i / 8 * 97) % (length - 64));
+                auto cursor = editor->textCursor();
+                cursor.setPosition(begin);
+                cursor.setPosition(begin + 16 + static_cast<int>(i % 48), QTextCursor::KeepAnchor);
+                editor->setTextCursor(cursor);
+            }
+
+            switch (i % 8)
+            {
+            case 0: pipeline.send(ActionUP{ new FormatBold{true, editor} }); break;
+            case 1: pipeline.send(ActionUP{ new FormatItalic{true, editor} }); break;
+            case 2: pipeline.send(ActionUP{ new FormatUnderline{true, editor} }); break;
+            case 3: pipeline.send(ActionUP{ new FormatSize{14, editor} }); break;
+            case 4: pipeline.send(ActionUP{ new FormatFamily{"Serif", editor} }); break;
+            case 5: pipeline.send(ActionUP{ new FormatColor{QColor{Qt::darkRed}, editor} }); break;
+            case 6: pipeline.send(ActionUP{ new FormatBold{false, editor} }); break;
+            default: pipeline.send(ActionUP{ new FormatAlignCenter{editor} }); break;
+            }
+        }
+    );
+}
+
+auto writeDocuments(QTemporaryDir const& dir, int count) -> QStringList
+{
+    QStringList paths;
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto path = dir.filePath(QString{"doc_%1.html"}.arg(i));
+
+        QFile file{path};
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            throw std::runtime_error{
+                QString{"Can't create file{%1}. Error{%2}"}
+                    .arg(path)
+                    .arg(file.errorString())
+                    .toStdString()
+            };
+        }
+
+        QTextStream stream{&file};
+        stream << generateHtml(40 + i * 20, i);
+        paths << path;
+    }
+
+    return paths;
+}
+
+auto benchFileOpen(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    QTemporaryDir dir;
+    auto paths = writeDocuments(dir, 8);
+    auto docsEditor = &pipeline.sender.docsEditor;
+
+    return measure("file.open", iterations, [&](long long i)
+        {
+            pipeline.send(ActionUP{ new FileOpenAction{paths[static_cast<int>(i % paths.size())], docsEditor} });
+        }
+    );
+}
+
+auto benchFileSave(Pipeline& pipeline, long long iterations) -> BenchResult
+{
+    QTemporaryDir dir;
+    auto paths = writeDocuments(dir, 1);
+    auto docsEditor = &pipeline.sender.docsEditor;
+
+    pipeline.send(ActionUP{ new FileOpenAction{paths.front(), docsEditor} });
+
+    return measure("file.save", iterations, [&](long long i)
+        {
+            pipeline.send(ActionUP{ new FileSaveAction{paths.front(), docsEditor} });
+        }
+    );
+}
+
+// 50M characters, i.e. 100 MB of UTF-16, searched the way TextFinder searches a snapshot
+auto benchFind(QString const& name, bool caseSensitive, long long iterations) -> BenchResult
+{
+    auto const sample = generateText(100'000);
+
+    QString text;
+    text.reserve(50'000'000 + sample.size());
+    while (text.size() < 50'000'000)
+    {
+        text += sample;
+    }
+
+    std::size_t matches = 0;
+    auto result = measure(name, iterations, [&](long long i)
+        {
+            matches = textsearch::findAllParallel(text, "Dolor", caseSensitive).size();
+        }
+    );
+
+    std::cerr << name.toStdString() << ": " << matches << " matches, kernel " << textsearch::kernelName() << std::endl;
+    return result;
+}
+
+// Recorded traffic (RichTextEditor --record) fed through a receiving session as fast
+// as it applies, cycling over the log when iterations exceed its frame count
+auto benchReplay(Pipeline& pipeline, QString const& path, long long iterations) -> BenchResult
+{
+    sessionlog::Reader reader;
+    if (!reader.open(path))
+    {
+        throw std::runtime_error{
+            QString{"Can't open session log{%1}. Error{%2}"}
+                .arg(path)
+                .arg(reader.errorString())
+                .toStdString()
+        };
+    }
+
+    std::vector<QByteArray> frames;
+    sessionlog::Entry entry;
+    qint64 recordedUs = 0;
+
+    while (reader.next(entry))
+    {
+        frames.push_back(entry.frame);
+        recordedUs = entry.timeUs;
+    }
+
+    if (frames.empty())
+    {
+        throw std::runtime_error{"The session log holds no frames"};
+    }
+
+    pipeline.reset(generateText(400), 1000);
+
+    InProcessBus bus;
+    auto session = DBusSession::create(new InProcessInteraction{&bus});
+    auto applier = new DBusActionsObserver{ pipeline.receiver.docsEditor.getEditor(), nullptr, session };
+
+    long long failures = 0;
+    auto count = iterations > 0 ? iterations : static_cast<long long>(frames.size());
+
+    auto result = measure("replay", count, [&](long long i)
+        {
+            try
+            {
+                bus.publish(frames[static_cast<std::size_t>(i % frames.size())]);
+            }
+            catch (std::exception const&)
+            {
+                ++failures;
+            }
+        }
+    );
+
+    delete applier;
+    delete session;
+
+    std::cerr << "replay: " << frames.size() << " frames recorded over " << recordedUs / 1000 << " ms"
+        << (reader.isComplete() ? "" : " (log not closed cleanly)")
+        << ", " << failures << " failed to apply" << std::endl;
+
+    return result;
+}
+
+auto scenarios() -> std::vector<Scenario> const&
+{
+    static std::vector<Scenario> const all{
+        { "deserialize", 1'000'000, benchDeserialize },
+        { "keystroke.send", 1'000'000, benchKeystrokeSend },
+        { "keystroke.receive", 1'000'000, benchKeystrokeReceive },
+        { "frame.unbuffered", 1'000'000, [](Pipeline& p, long long n) { return benchFrame(p, n, false); } },
+        { "frame.buffered", 1'000'000, [](Pipeline& p, long long n) { return benchFrame(p, n, true); } },
+        { "typing", 200'000, benchTyping },
+        { "formatting", 100'000, benchFormatting },
+        { "file.open", 2'000, benchFileOpen },
+        { "file.save", 2'000, benchFileSave },
+        { "find", 10, [](Pipeline&, long long n) { return benchFind("find", true, n); } },
+        { "find.nocase", 10, [](Pipeline&, long long n) { return benchFind("find.nocase", false, n); } },
+    };
+
+    return all;
+}
+
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("rte_bench");
+    qInstallMessageHandler([](QtMsgType, QMessageLogContext const&, QString const&) {});
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays action streams through the editor session pipeline");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"n", "iterations"}, "Operations per scenario instead of the scenario default.", "count"},
+        {{"s", "scenario"}, "Scenario to run, may be repeated. Runs all when omitted.", "name"},
+        {{"o", "output"}, "Write the JSON report to the file instead of stdout.", "path"},
+        {"list", "List available scenarios."},
+        {"replay", "Replay a session log recorded with --record as an extra scenario.", "path"},
+    });
+    parser.process(app);
+
+    if (parser.isSet("list"))
+    {
+        for (auto const& scenario : scenarios())
+        {
+            std::cout << scenario.name.toStdString() << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    auto selected = parser.values("scenario");
+    for (auto const& name : selected)
+    {
+        auto known = std::any_of(scenarios().begin(), scenarios().end(),
+            [&](Scenario const& scenario) { return scenario.name == name; });
+
+        if (!known)
+        {
+            std::cerr << "Unknown scenario: " << name.toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    long long iterations = parser.isSet("iterations") ? parser.value("iterations").toLongLong() : 0;
+
+    DBusSession::createDisabled();
+    Pipeline pipeline;
+
+    QJsonArray results;
+    for (auto const& scenario : scenarios())
+    {
+        if (!selected.isEmpty() && !selected.contains(scenario.name))
+        {
+            continue;
+        }
+
+        auto count = iterations > 0 ? iterations : scenario.defaultIterations;
+        results.append(scenario.run(pipeline, count).toJson());
+    }
+
+    if (parser.isSet("replay"))
+    {
+        results.append(benchReplay(pipeline, parser.value("replay"), iterations).toJson());
+    }
+
+    QJsonObject report{
+        {"qt", QString{qVersion()}},
+        {"platform", QApplication::platformName()},
+        {"allocationCounting", bench::allocationCountingAvailable()},
+        {"results", results},
+    };
+
+    auto json = QJsonDocument{report}.toJson(QJsonDocument::Indented);
+
+    if (parser.isSet("output"))
+    {
+        QFile file{parser.value("output")};
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            std::cerr << "Can't write report: " << file.errorString().toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+        file.write(json);
+    }
+    else
+    {
+        std::cout << json.constData();
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "texteditoractions.hpp"
+#include "formatactions.hpp"
+
+#include <array>
+#include <utility>
+
+enum class ActionContext
+{
+    Editor,
+    Documents,
+};
+
+template<ActionType Type>
+struct ActionRegistration
+{
+    static constexpr bool registered = false;
+};
+
+#define REGISTER_ACTION(Type, ActionClass, MementoClass, Context) \
+    template<> \
+    struct ActionRegistration<ActionType::Type> \
+    { \
+        static constexpr bool registered = true; \
+        static constexpr ActionContext context = ActionContext::Context; \
+        using ActionT = ActionClass; \
+        using MementoT = MementoClass; \
+    };
+
+REGISTER_ACTION(FormatBold, FormatBold, BoldMemento, Editor)
+REGISTER_ACTION(FormatItalic, FormatItalic, ItalicMemento, Editor)
+REGISTER_ACTION(FormatUnderline, FormatUnderline, UnderlineMemento, Editor)
+REGISTER_ACTION(FormatAlignLeft, FormatAlignLeft, AlignLeftMemento, Editor)
+REGISTER_ACTION(FormatAlignRight, FormatAlignRight, AlignRightMemento, Editor)
+REGISTER_ACTION(FormatAlignCenter, FormatAlignCenter, AlignCenterMemento, Editor)
+REGISTER_ACTION(FormatAlignJustify, FormatAlignJustify, AlignJustifyMemento, Editor)
+REGISTER_ACTION(FormatIndent, FormatIndent, IndentMemento, Editor)
+REGISTER_ACTION(FormatUnindent, FormatIndent, IndentMemento, Editor)
+REGISTER_ACTION(FormatColor, FormatColor, ColorMemento, Editor)
+REGISTER_ACTION(FormatUnderlineColor, FormatUnderlineColor, UnderlineColorMemento, Editor)
+REGISTER_ACTION(FormatChecked, FormatChecked, CheckedMemento, Editor)
+
+REGISTER_ACTION(FontSize, FormatSize, SizeMemento, Editor)
+REGISTER_ACTION(FontFamily, FormatFamily, FamilyMemento, Editor)
+
+REGISTER_ACTION(EditCopy, EditCopyAction, EditCopyMemento, Editor)
+REGISTER_ACTION(EditPaste, EditPasteAction, EditPasteMemento, Editor)
+REGISTER_ACTION(EditCut, EditCutAction, EditCutMemento, Editor)
+REGISTER_ACTION(EditRedo, EditRedoAction, EditRedoMemento, Editor)
+REGISTER_ACTION(EditUndo, EditUndoAction, EditUndoMemento, Editor)
+
+REGISTER_ACTION(FileOpen, FileOpenAction, FileOpenMemento, Documents)
+REGISTER_ACTION(FileSave, FileSaveAction, FileSaveMemento, Documents)
+REGISTER_ACTION(FileSaveAs, FileSaveAsAction, FileSaveAsMemento, Documents)
+
+REGISTER_ACTION(DocNew, DocNewAction, DocNewMemento, Documents)
+
+REGISTER_ACTION(TextChange, TextChangeAction_1, TextChangeAction_1::MementoInner, Editor)
+
+REGISTER_ACTION(Composite, CompositeAction, CompositeMemento, Editor)
+
+REGISTER_ACTION(FormatMerge, FormatMerge, MergeMemento, Editor)
+
+REGISTER_ACTION(StyleDefine, StyleDefine, StyleDefineMemento, Editor)
+REGISTER_ACTION(StyleApply, StyleApply, StyleApplyMemento, Editor)
+
+REGISTER_ACTION(TextReplace, TextReplaceAction, TextReplaceMemento, Editor)
+
+#undef REGISTER_ACTION
+
+struct ActionRegistry
+{
+    using Deserializer = ActionUP (*)(GlobalMementoBuilder const& builder, QDataStream& stream);
+
+    static constexpr std::size_t size = static_cast<std::size_t>(ActionType::Count);
+
+    template<ActionType Type>
+    static ActionUP deserialize(GlobalMementoBuilder const& builder, QDataStream& stream)
+    {
+        using Registration = ActionRegistration<Type>;
+        using ActionT = typename Registration::ActionT;
+        using MementoT = typename Registration::MementoT;
+
+        if constexpr (Registration::context == ActionContext::Documents)
+        {
+            return builder.build<ActionT, MementoT>(stream, builder.m_docsEditor);
+        }
+        else
+        {
+            return builder.build<ActionT, MementoT>(stream, builder.m_docsEditor->getEditor());
+        }
+    }
+
+    template<std::size_t... Types>
+    static constexpr std::array<Deserializer, sizeof...(Types)> makeTable(std::index_sequence<Types...>)
+    {
+        static_assert((ActionRegistration<static_cast<ActionType>(Types)>::registered && ...),
+            "Every ActionType must be registered with REGISTER_ACTION in actionregistry.hpp");
+
+        return { &ActionRegistry::deserialize<static_cast<ActionType>(Types)>... };
+    }
+};
+
+inline constexpr auto actionRegistry = ActionRegistry::makeTable(std::make_index_sequence<ActionRegistry::size>{});
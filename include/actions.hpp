@@ -1,8 +1,12 @@
 #pragma once
 
+#include "objectpool.hpp"
+
 #include <memory>
 #include <QByteArray>
 
+class QDataStream;
+
 enum class ActionType : uint16_t
 {
     FormatBold,
@@ -34,6 +38,17 @@ enum class ActionType : uint16_t
     DocNew,
     
     TextChange,
+
+    Composite,
+
+    FormatMerge,
+
+    StyleDefine,
+    StyleApply,
+
+    TextReplace,
+
+    Count,
 };
 
 struct Memento;
@@ -47,9 +62,10 @@ struct MementoDeserializer
     virtual ~MementoDeserializer() = default;
     virtual bool actionIsSupported(ActionType action) const = 0;
     virtual ActionUP deserializeAction(QByteArray&& data, ActionType action) = 0;
+    virtual ActionUP deserializeAction(QDataStream& stream, ActionType action) = 0;
 };
 
-struct Action
+struct Action : public tools::PoolAllocated
 {
     virtual ~Action() = default;
     virtual void execute() = 0;
@@ -59,10 +75,12 @@ protected:
     virtual void setMemento(MementoUP memento) = 0;
 };
 
-struct Memento
+struct Memento : public tools::PoolAllocated
 {
     virtual ~Memento() = default;
     virtual ActionType getActionType() const = 0;
     virtual QByteArray toRaw() const = 0;
     virtual void initFromRaw(QByteArray&& raw) = 0;
+    virtual void writeRaw(QDataStream& stream) const = 0;
+    virtual void readRaw(QDataStream& stream) = 0;
 };
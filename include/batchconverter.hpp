@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <vector>
+
+// Headless conversion of editor HTML files into any format documentwriters can save.
+// Files are spread over a pool, every task parses into a QTextDocument of its own, so
+// workers share nothing but the report callback.
+namespace batchconverter
+{
+
+struct Job
+{
+    QString input;
+    QString output;
+};
+
+struct Result
+{
+    Job job;
+    bool ok;
+    QString error;
+    double ms;
+};
+
+struct Summary
+{
+    int converted;
+    int failed;
+    double ms;
+};
+
+// Wildcards are allowed in the file name of inputGlob. The first '*' of outputPattern
+// is replaced by an input's base name, the output extension picks the format:
+// "in/*.html" with "out/*.md" converts in/a.html to out/a.md.
+auto expand(QString const& inputGlob, QString const& outputPattern) -> std::vector<Job>;
+
+// Outputs claimed by more than one job, which would be written concurrently: a
+// pattern without '*', or inputs differing only in their extension
+auto collisions(std::vector<Job> const& jobs) -> QStringList;
+
+// Blocks until every job is done. report is called once per file from the worker
+// threads, never concurrently.
+auto run(std::vector<Job> const& jobs, int threads, std::function<void(Result const&)> report) -> Summary;
+
+// expand, collisions and run for the command line: prints a line per file and a
+// summary to stdout, problems to stderr. Returns EXIT_SUCCESS if every file converted.
+auto convertAndReport(QString const& input, QString const& output, int threads) -> int;
+
+}
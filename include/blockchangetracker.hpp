@@ -0,0 +1,185 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Translates QTextDocument::contentsChange into block ranges, for consumers that keep
+// one entry per block: blocks [first, first + removed) were replaced by
+// [first, first + added). Remote actions change the document like local edits do, so
+// both are covered. Layout-only updates (markContentsDirty) show up as blocks
+// replaced by themselves.
+struct BlockChangeTracker : public QObject
+{
+    BlockChangeTracker(QObject* parent = nullptr);
+
+    void setDocument(QTextDocument* doc);
+    auto document() const -> QTextDocument*;
+
+signals:
+    void reset(int blockCount);
+    void blocksChanged(int first, int removed, int added);
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    Q_OBJECT
+
+    QPointer<QTextDocument> m_document;
+    int m_blockCount;
+};
+
+// Bookkeeping shared by the consumers of BlockChangeTracker that work on a pool:
+// TextFinder, RegexSearch and SpellChecker
+namespace blocktracking
+{
+
+// Tasks take a token when they're started and stop at their next check once cancel
+// was called; results come back with the token's generation and are dropped unless
+// it's still the current one
+struct Generation
+{
+    struct Token
+    {
+        auto isCancelled() const -> bool;
+
+        std::shared_ptr<std::atomic<quint64>> current;
+        quint64 generation;
+    };
+
+    Generation();
+
+    auto token() const -> Token;
+    auto isCurrent(quint64 generation) const -> bool;
+
+    // Tasks still queued on pool are dropped without running
+    auto cancel(QThreadPool& pool) -> void;
+
+private:
+    std::shared_ptr<std::atomic<quint64>> m_current;
+};
+
+// One entry per block for results computed on a pool. An entry gets a new stamp
+// whenever its block changes, and a result is only taken when the stamp still
+// matches. Queued entries are in a batch in flight and aren't sent again.
+template<typename Result>
+struct Entries
+{
+    struct Entry
+    {
+        quint64 stamp;
+        bool done;
+        bool queued;
+        Result result;
+    };
+
+    Entries()
+        : m_nextStamp{0}
+    {   }
+
+    auto size() const -> int
+    {
+        return static_cast<int>(m_entries.size());
+    }
+
+    auto operator[](int index) -> Entry&
+    {
+        return m_entries[index];
+    }
+
+    auto operator[](int index) const -> Entry const&
+    {
+        return m_entries[index];
+    }
+
+    auto clear() -> void
+    {
+        m_entries.clear();
+    }
+
+    // Every block is to do, as after BlockChangeTracker::reset
+    auto reset(int blockCount) -> void
+    {
+        m_entries.assign(blockCount, Entry{ 0, false, false, {} });
+        for (auto& entry : m_entries)
+        {
+            entry.stamp = ++m_nextStamp;
+        }
+    }
+
+    // Blocks [first, first + removed) were replaced by [first, first + added), which
+    // are to do again. True when blocks moved: the indices of the batches in flight
+    // are stale then, so they have to be cancelled.
+    auto replace(int first, int removed, int added) -> bool
+    {
+        auto moved = removed != added;
+        if (moved)
+        {
+            auto begin = m_entries.begin() + first;
+            m_entries.erase(begin, begin + removed);
+            m_entries.insert(m_entries.begin() + first, added, Entry{ 0, false, false, {} });
+        }
+
+        for (auto i = first; i < first + added; ++i)
+        {
+            m_entries[i] = Entry{ ++m_nextStamp, false, false, {} };
+        }
+
+        return moved;
+    }
+
+    // Nothing is in flight after a cancel. Returns the first entry that was queued,
+    // size() when there was none.
+    auto unqueue() -> int
+    {
+        auto first = size();
+        for (auto i = 0; i < size(); ++i)
+        {
+            if (m_entries[i].queued)
+            {
+                first = std::min(first, i);
+                m_entries[i].queued = false;
+            }
+        }
+
+        return first;
+    }
+
+    // The entry for a result computed from block at stamp, marked done; nullptr when
+    // the block changed since or got its result already
+    auto take(int block, quint64 stamp) -> Entry*
+    {
+        if (block >= size())
+        {
+            return nullptr;
+        }
+
+        auto& entry = m_entries[block];
+        if (entry.stamp != stamp || entry.done)
+        {
+            return nullptr;
+        }
+
+        entry.done = true;
+        entry.queued = false;
+        return &entry;
+    }
+
+private:
+    std::vector<Entry> m_entries;
+    quint64 m_nextStamp;
+};
+
+// Extra selections are shared with other overlays, each one marking its own with a
+// format property: the editor's selections but those carrying property
+auto otherSelections(QTextEdit* editor, int property) -> QList<QTextEdit::ExtraSelection>;
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QApplication>
+#include <QCommandLineParser>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CLIApplication
+{
+    using Handler = std::function<void(std::string_view value)>;
+    using Execution = std::function<void(QCommandLineParser const& parser)>;
+
+    CLIApplication(QApplication& app);
+
+    auto setApplicationName(std::string_view name) -> CLIApplication&;
+    auto setApplicationDescription(std::string_view description) -> CLIApplication&;
+    auto setApplicationVersion(std::string_view version) -> CLIApplication&;
+    auto addOption(QCommandLineOption& option, bool required, Handler hndl) -> CLIApplication&;
+    auto setupConflictedOptions(std::vector<std::reference_wrapper<QCommandLineOption>> const& conflictedOptions) -> CLIApplication&;
+    auto setupExecutionAfterProcessing(Execution exec) -> CLIApplication&;
+    auto addPositionalArgument(QString const& name, QString const& description, QString const& syntax = {}) -> CLIApplication&;
+
+    auto process() -> void;
+    auto positionalArguments() const -> QStringList;
+
+private:
+
+    struct Option
+    {
+        QCommandLineOption& option;
+        Handler handler;
+        std::vector<std::string> conflicted;
+        bool required;
+    };
+
+    std::vector<Option> m_options;
+    QApplication& m_app;
+    QCommandLineParser m_parser;
+    Execution m_executeAfterProcessing;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <QDBusConnection>
+#include <QDBusAbstractAdaptor>
+#include <QDBusInterface>
+#include <QDBusVariant>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+
+#include "dbussession.hpp"
+
+#define SERVICE_NAME "org.example.RichText"
+#define INTERFACE_NAME "org.example.RichText.events"
+#define TRACE_INTERFACE_NAME "org.example.RichText.trace"
+#define INSTANCE_INTERFACE_NAME "org.example.RichText.instance"
+#define INSTANCE_PATH "/instance"
+
+class DBusPublisher : public QDBusAbstractAdaptor
+{
+	Q_OBJECT
+	Q_CLASSINFO("D-Bus Interface", INTERFACE_NAME)
+public:
+	DBusPublisher(QObject* parent);
+
+signals:
+	void action(QDBusVariant const& action);
+};
+
+class DBusSubscriber : public QDBusAbstractInterface
+{
+	Q_OBJECT
+
+public:
+	DBusSubscriber(QString const& service, QString const& path, QDBusConnection const& connection, QObject* parent = nullptr);
+
+signals:
+	void action(QDBusVariant const& action);
+};
+
+// Served by the first process of a session under SERVICE_NAME.sessions.<session>
+class InstanceAdaptor : public QDBusAbstractAdaptor
+{
+	Q_OBJECT
+	Q_CLASSINFO("D-Bus Interface", INSTANCE_INTERFACE_NAME)
+public:
+	InstanceAdaptor(Interaction* interaction, QObject* parent);
+
+public slots:
+	bool openFiles(QStringList const& paths);
+
+private:
+	Interaction* m_interaction;
+};
+
+#if defined(RICHTEXT_TRACING)
+class TraceAdaptor : public QDBusAbstractAdaptor
+{
+	Q_OBJECT
+	Q_CLASSINFO("D-Bus Interface", TRACE_INTERFACE_NAME)
+public:
+	TraceAdaptor(QObject* parent);
+
+public slots:
+	QByteArray chromeTrace();
+	bool writeChromeTrace(QString const& path);
+};
+#endif
+
+struct EnabledInteraction : public Interaction
+{
+	EnabledInteraction(QObject* parent = nullptr);
+	EnabledInteraction(QDBusConnection const& connection, QObject* parent = nullptr);
+
+	void initInstance(QString const& session, bool serveInstance = true);
+	void sendMessage(QByteArray const& frame) override;
+
+signals: //Only for internal use
+	void action(QDBusVariant const& action);
+
+private slots:
+	void onAction(QDBusVariant const& action);
+
+private:
+	Q_OBJECT
+
+	DBusPublisher* m_server;
+	DBusSubscriber* m_client;
+	QDBusConnection m_connection;
+};
+
+// Joins a session without blocking the GUI thread. Each attempt connects to the bus
+// and registers the session's objects and names on a thread of its own, under its
+// own connection name, and is given up after a timeout; failed attempts are retried
+// with a doubling delay. The pending DBusSession completes the join with the
+// interaction on success, or fails it once all attempts failed, and the joiner
+// deletes itself.
+struct SessionJoiner : public QObject
+{
+	SessionJoiner(QString const& session, bool serveInstance, QObject* parent = nullptr);
+	~SessionJoiner();
+
+	void start();
+
+private:
+	Q_OBJECT
+
+	void attempt();
+	void onConnected(int attempt, QString const& name, EnabledInteraction* interaction, QString const& error);
+	void retry(QString const& error);
+
+	QString m_session;
+	bool m_serveInstance;
+	int m_attempts;
+	// The attempt that's still wanted, 0 for none; read by the join threads
+	std::shared_ptr<std::atomic<int>> m_inFlight;
+	QTimer m_timeout;
+};
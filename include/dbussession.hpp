@@ -1,42 +1,25 @@
-#include <QDBusConnection>
-#include <QDBusAbstractAdaptor>
-#include <QDBusInterface>
-#include <QDBusVariant>
+#pragma once
 
-#include "actions.hpp"
-
-#define SERVICE_NAME "org.example.RichText"
-#define INTERFACE_NAME "org.example.RichText.events"
-
-class DBusPublisher : public QDBusAbstractAdaptor
-{
-	Q_OBJECT
-	Q_CLASSINFO("D-Bus Interface", INTERFACE_NAME)
-public:
-	DBusPublisher(QObject* parent);
-
-signals:
-	void action(QDBusVariant const& action);
-};
-
-class DBusSubscriber : public QDBusAbstractInterface
-{
-	Q_OBJECT
+#include <QObject>
+#include <QByteArray>
+#include <QStringList>
 
-public:
-	DBusSubscriber(QString const& service, QString const& path, QDBusConnection const& connection, QObject* parent = nullptr);
+#include <vector>
 
-signals:
-	void action(QDBusVariant const& action);
-};
+#include "actions.hpp"
+#include "framebuffer.hpp"
 
+// Transport for session frames. The D-Bus implementation lives in dbusinteraction.hpp,
+// so code that only needs DisabledInteraction or InProcessInteraction doesn't pull in QtDBus.
 struct Interaction : public QObject
 {
 	Interaction(QObject* parent = nullptr);
-	virtual void sendMessage(QDBusVariant const& msg) = 0;
+	virtual void sendMessage(QByteArray const& frame) = 0;
 
 signals:
-	void messageReceived(QDBusVariant const& msg);
+	void messageReceived(QByteArray const& frame);
+	// Another launch of the same session handed over its file arguments
+	void openFilesRequested(QStringList const& paths);
 
 private:
 	Q_OBJECT
@@ -44,26 +27,35 @@ private:
 
 struct DisabledInteraction : public Interaction
 {
-	void sendMessage(QDBusVariant const& msg) override
+	void sendMessage(QByteArray const& frame) override
 	{	}
 };
 
-struct EnabledInteraction : public Interaction
+// Delivers every message synchronously to all interactions attached to the bus,
+// the sender included, the same way a D-Bus signal reaches its own emitter.
+struct InProcessBus : public QObject
 {
-	EnabledInteraction(QObject* parent = nullptr);
+	InProcessBus(QObject* parent = nullptr);
 
-	void initInstance(QString const& session);
-	void sendMessage(QDBusVariant const& msg) override;
+	void publish(QByteArray const& frame);
 
-signals: //Only for internal use
-	void action(QDBusVariant const& action);
+signals:
+	void message(QByteArray const& frame);
 
 private:
 	Q_OBJECT
+};
+
+struct InProcessInteraction : public Interaction
+{
+	InProcessInteraction(InProcessBus* bus, QObject* parent = nullptr);
 
-	DBusPublisher* m_server;
-	DBusSubscriber* m_client;
-	QDBusConnection m_connection;
+	void sendMessage(QByteArray const& frame) override;
+
+private:
+	Q_OBJECT
+
+	InProcessBus* m_bus;
 };
 
 struct DBusSession : public QObject
@@ -71,25 +63,63 @@ struct DBusSession : public QObject
 	void sendAction(ActionUP action);
 	void sendString(QString const& str);
 
-	static void createDetached();
 	static void createDisabled();
+	static DBusSession* create(Interaction* interaction);
+
+	// Lets the window come up before the bus is reached: the instance exists, so
+	// observers can connect to it, and frames are buffered until join() hands over
+	// the real transport and flushes them in order
+	static void createPending();
+	void join(Interaction* interaction);
+	bool isPending() const;
+
+	// How SessionJoiner ends: join() with the real transport and emit joined(), or join
+	// a DisabledInteraction, so the editor works offline, and emit joinFailed()
+	void completeJoin(Interaction* interaction);
+	void failJoin(QString const& error);
+
+	// D-Bus backed sessions, defined in dbusinteraction.cpp (richtext_dbus). These
+	// return at once: the bus is reached in the background by SessionJoiner, with a
+	// pending instance buffering frames meanwhile
+	static void createDetached();
 	static void createCommon();
-	static void createSession(QString const& session);
+	// serveInstance: whether this process may claim the session's single-instance name
+	static void createSession(QString const& session, bool serveInstance = true);
+
+	// Single-instance mode: hands the paths to the process that joined the session
+	// first. False when there is none or it didn't answer in time.
+	static bool openInRunning(QString const& session, QStringList const& paths);
+
 	static DBusSession* instance();
 
 signals:
 	void actionReceived(ActionType action, QByteArray const& raw);
+	// Every frame off the transport, own ones and malformed ones included
+	void frameReceived(QByteArray const& frame);
+	void joined();
+	void joinFailed(QString const& error);
+	void openFilesRequested(QStringList const& paths);
+
 private slots:
-	void parseMessage(QDBusVariant const& msg);
+	void parseMessage(QByteArray const& frame);
 
 private:
 	Q_OBJECT
 
     DBusSession();
-	QDBusVariant packPackage(QByteArray const& data, int appId, int actionType);
+	QByteArray packPackage(QByteArray const& data, int appId, int actionType);
+	void send(QByteArray const& frame);
 
 	Interaction* m_interaction;
+	bool m_pending;
 	int m_appId;
+	FrameWriter m_writer;
+	FrameReader m_reader;
+	QByteArray m_payload;
+	std::vector<QByteArray> m_backlog;
+	qint64 m_backlogBytes;
+	// The large backlog warning was logged for this join
+	bool m_backlogWarned;
 
 	static DBusSession* _instance;
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QTextCursor>
+#include <QTextDocument>
+
+#include "blockchangetracker.hpp"
+#include "implicittreap.hpp"
+
+// Word, character and paragraph counts of a document, kept per block in an implicit
+// treap that sums them by position. Only blocks reported by BlockChangeTracker are
+// counted again, so typing costs O(block length + log n), and inserting or removing
+// blocks O(log n) per block.
+struct DocumentStatistics : public QObject
+{
+    struct Counts
+    {
+        int words;
+        int characters;
+        int paragraphs;
+    };
+
+    DocumentStatistics(QObject* parent = nullptr);
+
+    void setDocument(QTextDocument* doc);
+
+    auto totals() const -> Counts;
+    auto wordsBefore(QTextCursor const& cursor) const -> int;
+
+    static auto countWords(QStringView text) -> int;
+
+signals:
+    void changed();
+
+private slots:
+    void onReset(int blockCount);
+    void onBlocksChanged(int first, int removed, int added);
+
+private:
+    Q_OBJECT
+
+    struct BlockCounts
+    {
+        int words;
+        int characters;
+        int paragraphs;
+
+        friend auto operator+(BlockCounts const& lhs, BlockCounts const& rhs) -> BlockCounts
+        {
+            return BlockCounts{ lhs.words + rhs.words, lhs.characters + rhs.characters, lhs.paragraphs + rhs.paragraphs };
+        }
+    };
+
+    auto countBlock(QTextBlock const& block) const -> BlockCounts;
+
+    BlockChangeTracker m_tracker;
+    tools::ImplicitTreap<BlockCounts> m_blocks;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QTextBlockFormat>
+#include <QTextCharFormat>
+#include <QTextDocument>
+#include <QVector>
+
+struct DBusSession;
+
+// Named paragraph and character styles of one document, owned by the document itself.
+// Formats only carry the style id, so every block using a style shares one format in
+// the document's format collection and peers only exchange the id once the style is
+// known to them. Built-in styles are fixed, without reference to local fonts, so every
+// peer has the same ones and they never need to be sent. User style ids are picked at
+// random by the defining peer and travel with the definition.
+struct DocumentStyles : public QObject
+{
+    enum class Kind : int
+    {
+        Paragraph,
+        Character,
+    };
+
+    enum : int
+    {
+        StyleIdProperty = QTextFormat::UserProperty + 1,
+    };
+
+    enum BuiltIn : int
+    {
+        Normal = 1,
+        Heading1,
+        Heading2,
+        Heading3,
+        Emphasis,
+        Code,
+
+        FirstUserId = 0x100,
+    };
+
+    struct Style
+    {
+        int id;
+        QString name;
+        Kind kind;
+        QTextBlockFormat blockFormat;
+        QTextCharFormat charFormat;
+    };
+
+    static auto of(QTextDocument* doc) -> DocumentStyles*;
+    static auto find(QTextDocument const* doc) -> DocumentStyles const*;
+
+    // The id a new definition of name should use: the one of a style already called
+    // that, else a random one no style of this document has
+    auto allocateId(QString const& name) const -> int;
+
+    // Definitions and where they're used, for files: saved formats lose the id property.
+    // Empty when the document uses no styles and defines none of its own.
+    static auto save(QTextDocument const* doc) -> QByteArray;
+    static auto restore(QTextDocument* doc, QByteArray const& data) -> bool;
+
+    auto define(Style style) -> void;
+    auto style(int id) const -> Style const*;
+    auto styles() const -> QVector<Style>;
+
+    auto isSynced(int id) const -> bool;
+    auto markSynced(int id) -> void;
+
+signals:
+    void stylesChanged();
+
+private:
+    Q_OBJECT
+
+    DocumentStyles(QTextDocument* doc);
+
+    auto defineBuiltIns() -> void;
+
+    QHash<int, Style> m_styles;
+    QSet<int> m_synced;
+    QPointer<DBusSession> m_session;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QIODevice>
+#include <QString>
+#include <QTextDocument>
+
+// Serializers for saving documents. Markdown and ODT walk the blocks and fragments and
+// hand the output to the device a chunk at a time, so memory use doesn't depend on
+// the document size; ODT goes through ZipWriter with content.xml deflated on the fly.
+// Only HTML keeps everything the editor shows, Markdown and ODT are exports: saving to
+// them doesn't make the file the document's path.
+namespace documentwriters
+{
+
+enum class Format
+{
+    Html,
+    Markdown,
+    Odt,
+};
+
+// By extension: .md and .markdown are Markdown, .odt is ODT, anything else HTML
+auto formatFor(QString const& path) -> Format;
+
+// Whether the format keeps the whole document, so saving again to the same file is safe
+auto isLossless(Format format) -> bool;
+
+// Replaces the file only once everything was written; on failure error says why
+auto save(QTextDocument const* doc, QString const& path, QString* error = nullptr) -> bool;
+
+// Reads HTML or Markdown into doc, picked by extension like save. HTML is decoded
+// by its charset meta tag, UTF-8 without one; ODT can't be read.
+auto load(QString const& path, QTextDocument* doc, QString* error = nullptr) -> bool;
+
+auto writeMarkdown(QTextDocument const* doc, QIODevice* device) -> bool;
+auto writeOdt(QTextDocument const* doc, QIODevice* device) -> bool;
+
+}
@@ -3,6 +3,9 @@
 #include <QTextEdit>
 
 #include "actions.hpp"
+#include "framebuffer.hpp"
+
+struct DBusSession;
 
 class AdditionalEmiterTextEditor : public QTextEdit
 {
@@ -16,6 +19,8 @@ signals:
 protected:
 	void keyReleaseEvent(QKeyEvent* event) override;
 	void keyPressEvent(QKeyEvent* event) override;
+	void paintEvent(QPaintEvent* event) override;
+	void resizeEvent(QResizeEvent* event) override;
 
 private:
 	Q_OBJECT
@@ -26,7 +31,7 @@ private:
 
 struct TextChangeObserver : public QObject
 {
-	TextChangeObserver(AdditionalEmiterTextEditor* textEditor, size_t buffSize);
+	TextChangeObserver(AdditionalEmiterTextEditor* textEditor, size_t buffSize, DBusSession* session = nullptr);
 
 public slots:
 	void onSymAdded(QChar const& sym);
@@ -36,11 +41,15 @@ private:
 	Q_OBJECT
 
 	AdditionalEmiterTextEditor* m_editor;
+	DBusSession* m_session;
 };
 
 struct DBusActionsObserver : public QObject
 {
-	DBusActionsObserver(QTextEdit* textEditor, QObject* parent = nullptr);
+	DBusActionsObserver(QTextEdit* textEditor, QObject* parent = nullptr, DBusSession* session = nullptr);
+
+	auto editor() const -> QTextEdit*;
+	auto setEditor(QTextEdit* textEditor) -> void;
 
 private slots:
 	void onDataReceived(ActionType action, QByteArray const& raw);
@@ -49,4 +58,5 @@ private:
 	Q_OBJECT
 
 	QTextEdit* m_editor;
+	FrameReader m_reader;
 };
@@ -4,18 +4,49 @@
 #include <QTabBar>
 #include <QHash>
 #include <QTextEdit>
+#include <QSplitter>
+#include <QStackedWidget>
+#include <QVector>
+
+#include "editorobservers.hpp"
+#include "largefileviewer.hpp"
 
 struct EditorTabWidget : public QWidget
 {
-    EditorTabWidget(QTextEdit* textEditor, QWidget* parent = nullptr);
+    EditorTabWidget(AdditionalEmiterTextEditor* textEditor, QWidget* parent = nullptr);
 
-    auto addDocument(QString const& title, QTextDocument* doc, bool overwrite = false) -> void;
+    // Always takes ownership of doc. When title already has a tab, doc replaces its
+    // document only with overwrite, which deletes the old one; otherwise doc is deleted
+    // and the existing tab is kept, as it is when title is shown in a viewer.
+    auto addDocument(QString const& title, QTextDocument* doc, bool overwrite = false, bool makeCurrent = true) -> void;
+    // Takes ownership of viewer the same way, a title already open keeps its tab
+    auto addViewer(QString const& title, LargeFileViewer* viewer) -> void;
     auto changeCurrentTitle(QString const& newTitle) -> void;
     auto getCurrentDocument() const -> QTextDocument*;
     auto getEditor() const -> QTextEdit*;
+    auto getViews() const -> QVector<AdditionalEmiterTextEditor*>;
+
+    // The viewer of the current tab, nullptr when the tab holds a document
+    auto currentViewer() const -> LargeFileViewer*;
+
+    auto splitView(Qt::Orientation orientation) -> void;
+    auto closeView() -> void;
 
 signals:
     void currentDocumentChanged(QTextDocument* doc);
+    void currentEditorChanged(QTextEdit* editor);
+    void viewAdded(AdditionalEmiterTextEditor* view);
+
+    // The view is deleted once control returns to the event loop, getEditor already
+    // returns a surviving one
+    void viewClosed(AdditionalEmiterTextEditor* view);
+
+    // nullptr when a document tab becomes current; getEditor and getCurrentDocument
+    // keep the last document while a viewer is shown
+    void currentViewerChanged(LargeFileViewer* viewer);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 private slots:
     void onCurrentChanged(int index);
@@ -23,7 +54,15 @@ private slots:
 private:
     Q_OBJECT
 
-    QTextEdit* m_textEditor;
+    auto tabIndex(QString const& title) const -> int;
+    auto attachView(AdditionalEmiterTextEditor* view) -> void;
+    auto setActiveView(AdditionalEmiterTextEditor* view) -> void;
+
+    AdditionalEmiterTextEditor* m_textEditor;
+    QVector<AdditionalEmiterTextEditor*> m_views;
+    QSplitter* m_splitter;
+    QStackedWidget* m_stack;
     QTabBar* m_tabs;
     QHash<QString, QTextDocument*> m_docs;
-};
\ No newline at end of file
+    QHash<QString, LargeFileViewer*> m_viewers;
+};
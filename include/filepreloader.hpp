@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QTextDocument>
+#include <QThreadPool>
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+// Reads and parses files into documents on a pool, one file per task, so opening
+// many files takes about as long as the largest one. Each document is built on its
+// worker and moved to the GUI thread. Results are handed over in the order the
+// paths were given, each as soon as it and all files before it are done.
+struct FilePreloader : public QObject
+{
+    FilePreloader(QObject* parent = nullptr);
+    ~FilePreloader();
+
+    // Can be called again while loading, the new paths queue up behind the others
+    void start(QStringList const& paths);
+    void cancel();
+
+signals:
+    // The receiver owns doc; first is set for the first document of a start() call
+    void loaded(QString const& path, QTextDocument* doc, bool first);
+    // Files of LargeFileViewer::autoThreshold and above aren't read
+    void viewRequested(QString const& path);
+    void failed(QString const& path, QString const& error);
+
+private:
+    Q_OBJECT
+
+    struct Result
+    {
+        QString path;
+        QTextDocument* doc;
+        QString error;
+        bool large;
+        int batch;
+    };
+
+    static auto load(QString const& path) -> Result;
+    auto onLoaded(int sequence, Result result) -> void;
+
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    std::map<int, Result> m_ready;
+    int m_nextSequence;
+    int m_nextDelivery;
+    int m_batch;
+    int m_shownBatch;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QWidget>
+
+#include "textfinder.hpp"
+
+struct FindPanel : public QWidget
+{
+    FindPanel(TextFinder* finder, QWidget* parent = nullptr);
+
+    void activate(QString const& needle);
+
+signals:
+    void closeRequested();
+
+protected:
+    void keyPressEvent(QKeyEvent* event) override;
+
+private slots:
+    void onNeedleChanged();
+    void onMatchesChanged(int count, bool finished);
+
+private:
+    Q_OBJECT
+
+    TextFinder* m_finder;
+    QLineEdit* m_needle;
+    QLineEdit* m_replacement;
+    QCheckBox* m_caseSensitive;
+    QCheckBox* m_regex;
+    QLabel* m_status;
+};
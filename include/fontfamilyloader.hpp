@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QStringList>
+
+// Enumerates font families on a worker thread. The list is cached on disk and the
+// cache is reused while fontconfig's cache directories are unchanged, so most starts
+// don't touch the font database at all.
+struct FontFamilyLoader : public QObject
+{
+    struct Result
+    {
+        QStringList families;
+        bool fromCache;
+        qint64 elapsedMs;
+    };
+
+    FontFamilyLoader(QObject* parent = nullptr);
+
+    void start();
+
+signals:
+    void loaded(QStringList const& families);
+
+private slots:
+    void onFinished();
+
+private:
+    Q_OBJECT
+
+    static auto load() -> Result;
+    static auto cachePath() -> QString;
+    static auto cacheKey() -> qint64;
+
+    QFutureWatcher<Result> m_watcher;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "texteditoractions.hpp"
+#include "documentstyles.hpp"
 
 #include <QColor>
 #include <QDataStream>
@@ -226,3 +227,102 @@ private:
 
 	FamilyMementoUP m_memento;
 };
+
+struct MergeMemento : public StreamItemsMemento<int, int, QTextCharFormat>
+{
+	MergeMemento() = default;
+	MergeMemento(int begin, int end, QTextCharFormat const& fmt);
+
+	ActionType getActionType() const override;
+
+	friend struct FormatMerge;
+};
+
+using MergeMementoUP = std::unique_ptr<MergeMemento, std::default_delete<Memento>>;
+
+// Applies an accumulated format to a range in one step, see FormatCoalescer. Selects
+// exactly [begin, end) and merges once; outside of a word only the format for the
+// next typed text changes.
+struct FormatMerge : public Action
+{
+	FormatMerge(int begin, int end, QTextCharFormat const& fmt, QTextEdit* textEditor);
+
+	void execute() override;
+	const Memento* getMemento() const override;
+
+protected:
+	void setMemento(MementoUP memento) override;
+
+private:
+	friend struct GlobalMementoBuilder;
+
+	FormatMerge(QTextEdit* textEditor);
+
+	QTextEdit* m_editor;
+	MergeMementoUP m_memento;
+};
+
+struct StyleDefineMemento : public StreamItemsMemento<int, QString, int, QTextBlockFormat, QTextCharFormat>
+{
+	StyleDefineMemento() = default;
+	StyleDefineMemento(DocumentStyles::Style const& style);
+
+	ActionType getActionType() const override;
+
+	friend struct StyleDefine;
+};
+
+using StyleDefineMementoUP = std::unique_ptr<StyleDefineMemento, std::default_delete<Memento>>;
+
+// Adds or replaces a named style in the current document, see DocumentStyles
+struct StyleDefine : public Action
+{
+	StyleDefine(DocumentStyles::Style const& style, QTextEdit* textEditor);
+
+	void execute() override;
+	const Memento* getMemento() const override;
+
+protected:
+	void setMemento(MementoUP memento) override;
+
+private:
+	friend struct GlobalMementoBuilder;
+
+	StyleDefine(QTextEdit* textEditor);
+
+	QTextEdit* m_editor;
+	StyleDefineMementoUP m_memento;
+};
+
+struct StyleApplyMemento : public StreamItemsMemento<int, int, int>
+{
+	StyleApplyMemento() = default;
+	StyleApplyMemento(QTextCursor const& cursor, int styleId);
+
+	ActionType getActionType() const override;
+
+	friend struct StyleApply;
+};
+
+using StyleApplyMementoUP = std::unique_ptr<StyleApplyMemento, std::default_delete<Memento>>;
+
+// Paragraph styles replace the block format of every block in the range, character
+// styles are merged into the range like the other format actions
+struct StyleApply : public Action
+{
+	StyleApply(int styleId, QTextEdit* textEditor);
+
+	void execute() override;
+	const Memento* getMemento() const override;
+
+protected:
+	void setMemento(MementoUP memento) override;
+
+private:
+	friend struct GlobalMementoBuilder;
+
+	StyleApply(QTextEdit* textEditor);
+
+	QTextEdit* m_editor;
+	StyleApplyMementoUP m_memento;
+};
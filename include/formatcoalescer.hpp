@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <QTextEdit>
+#include <QTextLayout>
+#include <QTimer>
+#include <QVector>
+
+#include <utility>
+
+#include "editortabwidget.hpp"
+
+// Collects format changes made in quick succession on the same range, e.g. scrolling
+// through the font or size combo. Until the burst settles they are only previewed
+// through the block layouts' additional formats; then a single FormatMerge is applied
+// and sent to the session.
+struct FormatCoalescer : public QObject
+{
+    FormatCoalescer(EditorTabWidget* docsEditor, int delayMs = 300, QObject* parent = nullptr);
+    ~FormatCoalescer();
+
+    void merge(QTextCharFormat const& fmt);
+    void flush();
+    void discard();
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    Q_OBJECT
+
+    struct PreviewedBlock
+    {
+        QTextBlock block;
+        QVector<QTextLayout::FormatRange> formats;
+    };
+
+    auto selectionRange(QTextEdit* editor) const -> std::pair<int, int>;
+    auto showPreview() -> void;
+    auto clearPreview() -> void;
+    auto track(QTextEdit* editor) -> void;
+
+    EditorTabWidget* m_docsEditor;
+    QTimer m_timer;
+    QPointer<QTextEdit> m_editor;
+    QPointer<QTextDocument> m_document;
+    QTextCharFormat m_format;
+    int m_begin;
+    int m_end;
+    bool m_pending;
+    bool m_updatingPreview;
+    QVector<PreviewedBlock> m_previewed;
+};
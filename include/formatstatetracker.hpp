@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QAction>
+#include <QComboBox>
+#include <QObject>
+#include <QPointer>
+#include <QTextCharFormat>
+#include <QTextEdit>
+#include <QVariant>
+
+#include <functional>
+#include <vector>
+
+#include "editortabwidget.hpp"
+
+// Keeps toolbar items in sync with the format under the caret. The char format index
+// of the fragment under the caret is cached, so moving within a fragment or onto
+// another fragment with the same format does no work, and only items whose value
+// actually changed are touched.
+struct FormatStateTracker : public QObject
+{
+    using Extractor = std::function<QVariant(QTextCharFormat const& fmt, QTextDocument const* doc)>;
+    using Applier = std::function<void(QVariant const& value)>;
+
+    FormatStateTracker(QObject* parent = nullptr);
+
+    void attach(EditorTabWidget* docsEditor);
+
+    void track(Extractor extractor, Applier applier);
+    void trackCheckable(QAction* action, std::function<bool(QTextCharFormat const&)> extractor);
+    void trackComboText(QComboBox* combo, Extractor extractor);
+
+    // Applies the format under the caret to every item, for items tracked after attach
+    void refresh();
+
+private slots:
+    void onEditorChanged(QTextEdit* editor);
+    void onCursorPositionChanged();
+    void onCurrentCharFormatChanged(QTextCharFormat const& fmt);
+    void invalidate();
+
+private:
+    Q_OBJECT
+
+    struct Item
+    {
+        Extractor extractor;
+        Applier applier;
+        QVariant value;
+    };
+
+    auto apply(QTextCharFormat const& fmt) -> void;
+
+    std::vector<Item> m_items;
+    QPointer<QTextEdit> m_editor;
+    int m_formatIndex;
+    int m_fragmentBegin;
+    int m_fragmentEnd;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QDataStream>
+
+namespace tools
+{
+
+// Length-prefixed block on a seekable stream, wire compatible with `stream << QByteArray`
+qint64 beginBlock(QDataStream& stream);
+void endBlock(QDataStream& stream, qint64 blockStart);
+
+}
+
+struct FrameWriter
+{
+    FrameWriter(int capacity = 256);
+
+    QDataStream& begin();
+    qint64 beginBlock();
+    // An empty block is written like a null QByteArray
+    void endBlock(qint64 blockStart);
+    QByteArray const& data() const;
+
+private:
+    QByteArray m_data;
+    QBuffer m_device;
+    QDataStream m_stream;
+};
+
+struct FrameReader
+{
+    FrameReader();
+
+    QDataStream& open(QByteArray const& data);
+    void release();
+
+private:
+    QBuffer m_device;
+    QDataStream m_stream;
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tools
+{
+
+// A sequence with prefix sums, keyed by position instead of by value: inserting or
+// erasing elements in the middle costs O(log n) expected plus the number of elements,
+// as do point updates and prefix queries. T needs a T{} zero and operator+.
+// Nodes live in one vector and are reused after erase.
+template<typename T>
+struct ImplicitTreap
+{
+    ImplicitTreap()
+        : m_root{none}
+        , m_seed{0x9E3779B9u}
+    {   }
+
+    void assign(std::vector<T> const& values)
+    {
+        m_nodes.clear();
+        m_free.clear();
+        m_root = build(values);
+    }
+
+    void insert(std::size_t index, std::vector<T> const& values)
+    {
+        auto [left, right] = split(m_root, static_cast<int>(index));
+        m_root = merge(merge(left, build(values)), right);
+    }
+
+    void erase(std::size_t index, std::size_t count)
+    {
+        auto [left, rest] = split(m_root, static_cast<int>(index));
+        auto [removed, right] = split(rest, static_cast<int>(count));
+        release(removed);
+        m_root = merge(left, right);
+    }
+
+    void set(std::size_t index, T const& value)
+    {
+        m_path.clear();
+
+        auto node = m_root;
+        auto position = static_cast<int>(index);
+
+        while (node != none)
+        {
+            m_path.push_back(node);
+
+            auto leftSize = sizeOf(m_nodes[node].left);
+            if (position == leftSize)
+            {
+                break;
+            }
+
+            if (position < leftSize)
+            {
+                node = m_nodes[node].left;
+            }
+            else
+            {
+                position -= leftSize + 1;
+                node = m_nodes[node].right;
+            }
+        }
+
+        if (node == none)
+        {
+            return;
+        }
+
+        m_nodes[node].value = value;
+
+        for (auto it = m_path.rbegin(); it != m_path.rend(); ++it)
+        {
+            update(*it);
+        }
+    }
+
+    // Sum of the first `count` elements
+    T prefix(std::size_t count) const
+    {
+        T sum{};
+        auto node = m_root;
+        auto remaining = static_cast<int>(count);
+
+        while (node != none && remaining > 0)
+        {
+            auto const& current = m_nodes[node];
+            auto leftSize = sizeOf(current.left);
+
+            if (remaining <= leftSize)
+            {
+                node = current.left;
+                continue;
+            }
+
+            sum = sum + sumOf(current.left) + current.value;
+            remaining -= leftSize + 1;
+            node = current.right;
+        }
+
+        return sum;
+    }
+
+    T total() const
+    {
+        return sumOf(m_root);
+    }
+
+    std::size_t size() const
+    {
+        return static_cast<std::size_t>(sizeOf(m_root));
+    }
+
+private:
+    static constexpr int none = -1;
+
+    struct Node
+    {
+        T value;
+        T sum;
+        std::uint32_t priority;
+        int size;
+        int left;
+        int right;
+    };
+
+    auto sizeOf(int node) const -> int
+    {
+        return node == none ? 0 : m_nodes[node].size;
+    }
+
+    auto sumOf(int node) const -> T
+    {
+        return node == none ? T{} : m_nodes[node].sum;
+    }
+
+    auto update(int node) -> void
+    {
+        auto& current = m_nodes[node];
+        current.size = sizeOf(current.left) + 1 + sizeOf(current.right);
+        current.sum = sumOf(current.left) + current.value + sumOf(current.right);
+    }
+
+    // xorshift32, balance only needs the priorities to look random
+    auto nextPriority() -> std::uint32_t
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        return m_seed;
+    }
+
+    auto allocate(T const& value) -> int
+    {
+        Node node{ value, value, nextPriority(), 1, none, none };
+
+        if (!m_free.empty())
+        {
+            auto index = m_free.back();
+            m_free.pop_back();
+            m_nodes[index] = node;
+            return index;
+        }
+
+        m_nodes.push_back(node);
+        return static_cast<int>(m_nodes.size()) - 1;
+    }
+
+    auto release(int node) -> void
+    {
+        if (node == none)
+        {
+            return;
+        }
+
+        release(m_nodes[node].left);
+        release(m_nodes[node].right);
+        m_free.push_back(node);
+    }
+
+    // Builds the subtree of a run of values in O(n): a node pops every node with a lower
+    // priority off the right spine and takes them as its left subtree
+    auto build(std::vector<T> const& values) -> int
+    {
+        m_path.clear();
+
+        for (auto const& value : values)
+        {
+            auto node = allocate(value);
+            auto last = none;
+
+            while (!m_path.empty() && m_nodes[m_path.back()].priority < m_nodes[node].priority)
+            {
+                last = m_path.back();
+                m_path.pop_back();
+                update(last);
+            }
+
+            m_nodes[node].left = last;
+
+            if (!m_path.empty())
+            {
+                m_nodes[m_path.back()].right = node;
+            }
+
+            m_path.push_back(node);
+        }
+
+        auto root = m_path.empty() ? none : m_path.front();
+
+        for (auto it = m_path.rbegin(); it != m_path.rend(); ++it)
+        {
+            update(*it);
+        }
+
+        return root;
+    }
+
+    // The first `count` elements go left
+    auto split(int node, int count) -> std::pair<int, int>
+    {
+        if (node == none)
+        {
+            return { none, none };
+        }
+
+        auto leftSize = sizeOf(m_nodes[node].left);
+
+        if (count <= leftSize)
+        {
+            auto [left, right] = split(m_nodes[node].left, count);
+            m_nodes[node].left = right;
+            update(node);
+            return { left, node };
+        }
+
+        auto [left, right] = split(m_nodes[node].right, count - leftSize - 1);
+        m_nodes[node].right = left;
+        update(node);
+        return { node, right };
+    }
+
+    auto merge(int left, int right) -> int
+    {
+        if (left == none || right == none)
+        {
+            return left == none ? right : left;
+        }
+
+        if (m_nodes[left].priority > m_nodes[right].priority)
+        {
+            m_nodes[left].right = merge(m_nodes[left].right, right);
+            update(left);
+            return left;
+        }
+
+        m_nodes[right].left = merge(left, m_nodes[right].left);
+        update(right);
+        return right;
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<int> m_free;
+    std::vector<int> m_path;
+    int m_root;
+    std::uint32_t m_seed;
+};
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QAbstractScrollArea>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Read-only view of a plain text file too large for a QTextDocument. The file is
+// memory-mapped and a worker records where every 64th line starts, so any line is
+// found with one lookup and at most 63 newline scans. Very long lines are split into
+// rows, each of them counting as a line, so a scan is bounded too. Only the lines in
+// the viewport are decoded and drawn; the scroll range grows while indexing goes on.
+struct LargeFileViewer : public QAbstractScrollArea
+{
+    // FileOpenAction shows files from this size on in the viewer
+    static constexpr qint64 autoThreshold = 32 * 1024 * 1024;
+
+    LargeFileViewer(QWidget* parent = nullptr);
+    ~LargeFileViewer();
+
+    auto open(QString const& path) -> bool;
+    auto path() const -> QString;
+    auto lineCount() const -> qint64;
+    auto isIndexed() const -> bool;
+
+signals:
+    void indexingProgress(qint64 bytes, qint64 total);
+    void indexed(qint64 lines);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    Q_OBJECT
+
+    static constexpr int linesPerCheckpoint = 64;
+
+    auto index() -> void;
+    auto onIndexed(std::vector<qint64> const& checkpoints, qint64 lines, qint64 bytes, bool done) -> void;
+    auto lineOffset(qint64 line) const -> qint64;
+    auto lineEnd(qint64 offset) const -> qint64;
+    auto nextLine(qint64 end) const -> qint64;
+    auto gutterWidth() const -> int;
+    auto visibleLines() const -> int;
+    auto updateScrollBars() -> void;
+
+    QFile m_file;
+    uchar const* m_data;
+    qint64 m_size;
+    std::vector<qint64> m_checkpoints;
+    qint64 m_lineCount;
+    bool m_indexed;
+    int m_maxWidth;
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    QElapsedTimer m_elapsed;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <variant>
+
+// Records are queued without formatting and written by a background thread, so a
+// log call on the GUI thread never touches the file or stderr. A disabled level
+// costs one relaxed load and a branch; levels below RICHTEXT_LOG_MIN_LEVEL
+// aren't compiled at all.
+
+#if !defined(RICHTEXT_LOG_MIN_LEVEL)
+#define RICHTEXT_LOG_MIN_LEVEL 1
+#endif
+
+namespace logging
+{
+
+enum class Level : int
+{
+    Trace,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off,
+};
+
+constexpr Level compiledMinLevel = static_cast<Level>(RICHTEXT_LOG_MIN_LEVEL);
+
+inline std::atomic<int> runtimeLevel{ static_cast<int>(Level::Info) };
+
+inline bool enabled(Level level)
+{
+    return static_cast<int>(level) >= runtimeLevel.load(std::memory_order_relaxed);
+}
+
+void setLevel(Level level);
+Level parseLevel(QString const& name);
+
+using Value = std::variant<std::monostate, long long, double, bool, char const*, QString>;
+
+// `key` and char const* values must be string literals, everything else is copied
+struct Field
+{
+    template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    Field(char const* k, T v)
+        : key{k}
+        , value{static_cast<long long>(v)}
+    {   }
+
+    Field(char const* k, bool v);
+    Field(char const* k, double v);
+    Field(char const* k, char const* v);
+    Field(char const* k, QString v);
+
+    Field() = default;
+
+    char const* key{nullptr};
+    Value value;
+};
+
+void submit(Level level, char const* message, std::initializer_list<Field> fields = {});
+
+// Starts the writer thread. An empty path writes to stderr. Files rotate to
+// `path.1` ... `path.<maxFiles - 1>` once they reach maxBytes.
+void start(QString const& path = {}, std::int64_t maxBytes = 8 * 1024 * 1024, int maxFiles = 3);
+// Drains the queue and joins the writer thread
+void stop();
+
+}
+
+#define RTE_LOG(level, message, ...) \
+    do \
+    { \
+        if constexpr (level >= ::logging::compiledMinLevel) \
+        { \
+            if (::logging::enabled(level)) \
+            { \
+                ::logging::submit(level, message, { __VA_ARGS__ }); \
+            } \
+        } \
+    } while (false)
+
+#define RTE_LOG_TRACE(...) RTE_LOG(::logging::Level::Trace, __VA_ARGS__)
+#define RTE_LOG_DEBUG(...) RTE_LOG(::logging::Level::Debug, __VA_ARGS__)
+#define RTE_LOG_INFO(...) RTE_LOG(::logging::Level::Info, __VA_ARGS__)
+#define RTE_LOG_WARNING(...) RTE_LOG(::logging::Level::Warning, __VA_ARGS__)
+#define RTE_LOG_ERROR(...) RTE_LOG(::logging::Level::Error, __VA_ARGS__)
@@ -9,6 +9,8 @@
 #include <QMainWindow>
 
 #include <functional>
+#include <utility>
+#include <vector>
 
 using ExecuteAction = std::function<Action*(QAction*)>;
 
@@ -20,6 +22,9 @@ Action* defaultAction(QAction*)
 }
 }
 
+// Menus are added to the window by endBuild. Toolbars and icons given by path are
+// held back until completeDeferred, so the window can be shown before any icon is
+// decoded.
 struct MenuBarBuilder : public QObject
 {
     MenuBarBuilder(QMainWindow* win);
@@ -30,6 +35,7 @@ struct MenuBarBuilder : public QObject
     MenuBarBuilder* setActionPriority(QAction::Priority priority);
     MenuBarBuilder* setActionShortcut(QKeySequence shortcut);
     MenuBarBuilder* setActionIcon(QIcon&& icon);
+    MenuBarBuilder* setActionIcon(QString const& path);
     MenuBarBuilder* setCheckable(bool checkable);
     MenuBarBuilder* enableSepartorToMenu();
     MenuBarBuilder* disableForMenu();
@@ -37,11 +43,14 @@ struct MenuBarBuilder : public QObject
 
     QAction* createAction(QString const& name, ExecuteAction fn = ::defaultAction);
 
+    void completeDeferred();
+
 private:
     void reset();
 
     QMainWindow* m_win;
     QIcon m_icon;
+    QString m_iconPath;
     QToolBar* m_toolBar;
     QMenu* m_menu;
     QKeySequence m_shortcut;
@@ -50,4 +59,6 @@ private:
     bool m_disableForMenu;
     bool m_disableForBar;
     bool m_checkable;
+    std::vector<std::pair<QAction*, QString>> m_pendingIcons;
+    std::vector<QToolBar*> m_pendingToolBars;
 };
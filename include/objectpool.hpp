@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace tools
+{
+
+// Thread-local free lists bucketed by size class. Blocks released on a thread are
+// recycled by the next allocation of the same size class on that thread.
+struct SizeClassPool
+{
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t maxPooledSize = 256;
+    static constexpr std::size_t maxFreeBlocks = 1024;
+
+    static void* allocate(std::size_t size)
+    {
+        if (size == 0 || size > maxPooledSize || retired())
+        {
+            return ::operator new(size);
+        }
+
+        auto& lists = freeLists();
+        auto index = classIndex(size);
+
+        if (auto block = lists.heads[index])
+        {
+            lists.heads[index] = block->next;
+            --lists.counts[index];
+            return block;
+        }
+
+        return ::operator new(classSize(index));
+    }
+
+    static void deallocate(void* ptr, std::size_t size) noexcept
+    {
+        if (!ptr)
+        {
+            return;
+        }
+
+        if (size == 0 || size > maxPooledSize || retired())
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        auto& lists = freeLists();
+        auto index = classIndex(size);
+
+        if (lists.counts[index] >= maxFreeBlocks)
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = lists.heads[index];
+        lists.heads[index] = block;
+        ++lists.counts[index];
+    }
+
+private:
+    static constexpr std::size_t classCount = maxPooledSize / granularity;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct FreeLists
+    {
+        ~FreeLists()
+        {
+            for (auto head : heads)
+            {
+                while (head)
+                {
+                    auto next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+
+            retired() = true;
+        }
+
+        std::array<FreeBlock*, classCount> heads{};
+        std::array<std::size_t, classCount> counts{};
+    };
+
+    static constexpr std::size_t classIndex(std::size_t size)
+    {
+        return (size + granularity - 1) / granularity - 1;
+    }
+
+    static constexpr std::size_t classSize(std::size_t index)
+    {
+        return (index + 1) * granularity;
+    }
+
+    // Set once the thread's free lists are destroyed, so objects released by
+    // later thread_local destructors go straight back to the global heap.
+    static bool& retired()
+    {
+        thread_local bool value = false;
+        return value;
+    }
+
+    static FreeLists& freeLists()
+    {
+        thread_local FreeLists lists;
+        return lists;
+    }
+};
+
+// Base for polymorphic types that are created and destroyed at a high rate.
+// Deleting through a base pointer with a virtual destructor passes the size of
+// the dynamic type, so every derived class lands in its own size class.
+struct PoolAllocated
+{
+    static void* operator new(std::size_t size)
+    {
+        return SizeClassPool::allocate(size);
+    }
+
+    static void operator delete(void* ptr, std::size_t size) noexcept
+    {
+        SizeClassPool::deallocate(ptr, size);
+    }
+};
+
+}
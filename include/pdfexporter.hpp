@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QObject>
+#include <QPageLayout>
+#include <QTextDocument>
+#include <QThreadPool>
+
+#include <memory>
+
+// Exports a document to PDF off the GUI thread. The document is cloned once; every
+// worker clones that snapshot again, lays it out on its own and renders every n-th
+// page into a QPicture. A writer task streams the pages to QPdfWriter in order, and
+// workers stay at most a few pages ahead of it, so memory doesn't grow with the page count.
+struct PdfExporter : public QObject
+{
+    PdfExporter(QObject* parent = nullptr);
+    ~PdfExporter();
+
+    // Returns false when an export is already running
+    auto start(QTextDocument const* doc, QString const& path, QPageLayout const& layout = defaultLayout()) -> bool;
+    void cancel();
+    auto isRunning() const -> bool;
+
+    static auto defaultLayout() -> QPageLayout;
+
+signals:
+    void progress(int pages, int total);
+    void finished(bool ok, QString const& error);
+
+private:
+    Q_OBJECT
+
+    struct Job;
+
+    auto render(std::shared_ptr<Job> job, int worker) -> void;
+    auto write(std::shared_ptr<Job> job) -> void;
+    auto onFinished(Job const* job, bool ok, QString const& error) -> void;
+
+    QThreadPool m_pool;
+    std::shared_ptr<Job> m_job;
+    std::unique_ptr<QTextDocument> m_snapshot;
+};
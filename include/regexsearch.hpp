@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "blockchangetracker.hpp"
+
+// Regular expression search kept live while the document changes. Every block is
+// matched on its own (matches don't span paragraphs, as with QTextDocument::find) on
+// a worker pool. Each block entry gets a new stamp whenever it changes, and results
+// are only taken when the stamp still matches. Only changed blocks are scanned again.
+// Snapshots are taken a slice at a time so a large document doesn't stall the UI.
+struct RegexSearch : public QObject
+{
+    using Match = std::pair<int, int>;
+
+    RegexSearch(QObject* parent = nullptr);
+    ~RegexSearch();
+
+    void start(QTextDocument* doc, QRegularExpression const& regex);
+    void stop();
+
+    auto count() const -> int;
+    auto isComplete() const -> bool;
+
+    // Absolute {position, length} pairs, {-1, 0} when there's none
+    auto matchAfter(int pos) const -> Match;
+    auto matchBefore(int pos) const -> Match;
+    auto matchesIn(int begin, int end) const -> std::vector<Match>;
+
+    // Every match with its replacement text, \0 to \9 being expanded to the captured
+    // groups. Blocks not scanned yet have none, so wait for isComplete first.
+    auto replacements(QString const& replacement) const -> std::vector<std::tuple<int, int, QString>>;
+
+    static auto expand(QRegularExpressionMatch const& match, QString const& replacement) -> QString;
+
+signals:
+    void matchesChanged(int count, bool complete);
+
+private slots:
+    void onReset(int blockCount);
+    void onBlocksChanged(int first, int removed, int added);
+    void scheduleSlice();
+
+private:
+    Q_OBJECT
+
+    struct Scanned
+    {
+        int block;
+        quint64 stamp;
+        std::vector<std::pair<int, int>> matches;
+    };
+
+    static auto scan(QRegularExpression const& regex, QString const& text) -> std::vector<std::pair<int, int>>;
+
+    auto cancel() -> void;
+    auto accept(quint64 generation, std::vector<Scanned> const& results) -> void;
+
+    BlockChangeTracker m_tracker;
+    QThreadPool m_pool;
+    QTimer m_sliceTimer;
+    QRegularExpression m_regex;
+    blocktracking::Generation m_generation;
+    blocktracking::Entries<std::vector<std::pair<int, int>>> m_entries;
+    int m_scanFrom;
+    int m_unscanned;
+    int m_count;
+    bool m_active;
+};
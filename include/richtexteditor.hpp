@@ -1,17 +1,35 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QComboBox>
+#include <QDockWidget>
+#include <QLabel>
 #include <QTextEdit>
 
 #include "menubarbuilder.hpp"
 #include "editorobservers.hpp"
 #include "editortabwidget.hpp"
+#include "formatcoalescer.hpp"
+#include "formatstatetracker.hpp"
+#include "findpanel.hpp"
+#include "documentstatistics.hpp"
+#include "spellchecker.hpp"
+#include "pdfexporter.hpp"
+#include "filepreloader.hpp"
 
 struct RichTextEditor : public QMainWindow
 {
     RichTextEditor(QMainWindow* parent = nullptr);
 
     void buildUi();
+    void completeUi();
+    void openInViewer(QString const& path);
+    void openFiles(QStringList const& paths);
+
+private slots:
+    void refreshStyles();
+    void updateStatistics();
+    void onViewerChanged(LargeFileViewer* viewer);
 
 private:
     Q_OBJECT
@@ -19,12 +37,31 @@ private:
     void setupFileActions();
     void setupFormatActions();
     void setupEditActions();
+    void setupViewActions();
     void setupFontSelectorToolBar();
 
     void buildEditorAndObjects();
+    void applyStyle(int id);
+    void loadDictionary(QString const& path);
+    void exportPdf(QString path);
 
     EditorTabWidget* m_docsEditor;
     MenuBarBuilder* m_builder;
     TextChangeObserver* m_textObserver;
     DBusActionsObserver* m_actionsObserver;
+    FormatCoalescer* m_formatCoalescer;
+    FormatStateTracker* m_formatTracker;
+    QComboBox* m_styleSelector;
+    TextFinder* m_textFinder;
+    FindPanel* m_findPanel;
+    QDockWidget* m_findDock;
+    DocumentStatistics* m_statistics;
+    QLabel* m_statisticsLabel;
+    SpellChecker* m_spellChecker;
+    PdfExporter* m_pdfExporter;
+    FilePreloader* m_preloader;
+    QToolBar* m_fontToolBar;
+
+    // Act on the current document, so they're off while a viewer tab is current
+    QList<QAction*> m_documentActions;
 };
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Recorded session traffic. After a 16 byte header ("RTESLOG1", start time in ms
+// since the epoch) every frame is stored as varint(microseconds since the previous
+// frame << 1), varint(size) and the frame itself. Every 1024 frames or 1 MiB an index
+// entry follows: varint(1), then the offset of the previous index entry, the time of
+// the last frame and the number of frames so far, 64 bits each. A cleanly closed log
+// ends with the offset of the last index entry, the frame count and "RTESEND1", so a
+// reader finds every index entry by walking the chain back from the end.
+namespace sessionlog
+{
+
+struct Entry
+{
+    qint64 timeUs;
+    QByteArray frame;
+};
+
+// append() only queues, a thread encodes and writes. Frames are appended on the GUI
+// thread, where the session delivers them. Nothing is dropped: when the
+// writer falls behind the queue grows and a warning is logged.
+struct Writer
+{
+    Writer();
+    ~Writer();
+
+    auto open(QString const& path) -> bool;
+    auto errorString() const -> QString;
+
+    void append(QByteArray const& frame);
+
+    // Writes what's queued and the trailer
+    void close();
+
+private:
+    struct Queued
+    {
+        qint64 timeUs;
+        QByteArray frame;
+    };
+
+    void run();
+    void encode(Queued const& queued);
+    void writeIndex();
+    void flush();
+
+    QFile m_file;
+    // Set by open, so the GUI thread can log it while the writer thread uses m_file
+    QString m_path;
+    QString m_error;
+    std::chrono::steady_clock::time_point m_start;
+
+    // Shared with the writer thread
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::vector<Queued> m_queue;
+    qint64 m_queuedBytes;
+    qint64 m_maxQueuedBytes;
+    bool m_stopping;
+
+    // GUI thread only
+    std::chrono::steady_clock::time_point m_lastWarning;
+
+    // Writer thread only
+    QByteArray m_buffer;
+    qint64 m_offset;
+    qint64 m_lastTimeUs;
+    qint64 m_frames;
+    qint64 m_bytes;
+    qint64 m_lastIndexOffset;
+    qint64 m_framesSinceIndex;
+    qint64 m_bytesSinceIndex;
+    bool m_failed;
+
+    std::thread m_thread;
+};
+
+struct Reader
+{
+    Reader();
+
+    auto open(QString const& path) -> bool;
+    auto errorString() const -> QString;
+
+    auto startTime() const -> QDateTime;
+    // Without a trailer the log wasn't closed cleanly: frames read up to the first
+    // damaged one, frameCount() is -1 and seek() scans from the start
+    auto isComplete() const -> bool;
+    auto frameCount() const -> qint64;
+
+    // False at the end of the log or at damaged data
+    auto next(Entry& entry) -> bool;
+    // The next entry is the first one at or after timeUs
+    void seek(qint64 timeUs);
+
+private:
+    struct Index
+    {
+        qint64 offset;
+        qint64 timeUs;
+        qint64 frames;
+    };
+
+    auto readVarint(quint64& value) -> bool;
+    auto readIndex(qint64 offset, qint64& previous, Index& index) const -> bool;
+
+    QFile m_file;
+    QString m_error;
+    uchar const* m_data;
+    qint64 m_size;
+    qint64 m_end;
+    qint64 m_pos;
+    qint64 m_lastTimeUs;
+    qint64 m_frameCount;
+    QDateTime m_startTime;
+    std::vector<Index> m_index;
+};
+
+}
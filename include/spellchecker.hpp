@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "blockchangetracker.hpp"
+#include "editortabwidget.hpp"
+#include "spelldictionary.hpp"
+
+// Checks the current document against a SpellDictionary on a single worker thread.
+// Blocks reported by BlockChangeTracker are marked dirty and checked again after a
+// short pause in typing, those in the viewport first; the rest of the document
+// follows one slice at a time. Misspelled words are shown as extra selections in the
+// viewport, so char formats, and with them the format mementos, are left alone.
+struct SpellChecker : public QObject
+{
+    enum : int
+    {
+        UnderlineProperty = QTextFormat::UserProperty + 3,
+    };
+
+    SpellChecker(EditorTabWidget* docsEditor, QObject* parent = nullptr);
+    ~SpellChecker();
+
+    void setDictionary(std::shared_ptr<SpellDictionary const> dictionary);
+    auto hasDictionary() const -> bool;
+
+    void setEnabled(bool enabled);
+    auto isEnabled() const -> bool;
+
+    // Absolute {position, length} pairs of the misspelled words checked so far
+    auto misspelledIn(int begin, int end) const -> std::vector<std::pair<int, int>>;
+
+signals:
+    void dictionaryChanged(bool loaded);
+
+private slots:
+    void onEditorChanged(QTextEdit* editor);
+    void onDocumentChanged(QTextDocument* doc);
+    void onReset(int blockCount);
+    void onBlocksChanged(int first, int removed, int added);
+    void onScrolled();
+    void schedule();
+    void updateUnderlines();
+
+private:
+    Q_OBJECT
+
+    struct Checked
+    {
+        int block;
+        quint64 stamp;
+        std::vector<std::pair<int, int>> misspelled;
+    };
+
+    using Batch = std::vector<std::tuple<int, quint64, QString>>;
+
+    auto attach() -> void;
+    auto cancel() -> void;
+    auto visibleBlocks() const -> std::pair<int, int>;
+    auto enqueue(Batch& batch, int index, QTextBlock const& block) -> int;
+    auto submit(Batch batch, bool visible) -> void;
+    auto accept(quint64 generation, bool visible, std::vector<Checked> const& results) -> void;
+
+    EditorTabWidget* m_docsEditor;
+    QPointer<QTextEdit> m_editor;
+    QPointer<QTextDocument> m_document;
+    BlockChangeTracker m_tracker;
+    QThreadPool m_pool;
+    QTimer m_editTimer;
+    std::shared_ptr<SpellDictionary const> m_dictionary;
+    blocktracking::Generation m_generation;
+    blocktracking::Entries<std::vector<std::pair<int, int>>> m_entries;
+    int m_scanFrom;
+    int m_backgroundInFlight;
+    bool m_enabled;
+};
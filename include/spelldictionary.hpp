@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Word list read from a Hunspell dictionary (.dic plus the .aff next to it). Prefix
+// and suffix rules are expanded once at load time, so a lookup is a single hash probe
+// and the loaded dictionary is immutable and safe to share between threads.
+// Compounding, replacement tables and suggestions aren't supported.
+struct SpellDictionary
+{
+    SpellDictionary();
+
+    // Returns nullptr when the .dic file can't be read; a missing .aff only disables affixes
+    static auto load(QString const& dicPath) -> std::shared_ptr<SpellDictionary const>;
+
+    // Default locations of the dictionary for a locale name like "en_US"
+    static auto find(QString const& locale) -> QString;
+
+    auto contains(QStringView word) const -> bool;
+    auto size() const -> int;
+
+    // {offset, length} of the words in text that aren't in the dictionary. Words are runs
+    // of letters with inner apostrophes; runs touching a digit are skipped.
+    auto misspelled(QStringView text) const -> std::vector<std::pair<int, int>>;
+
+private:
+    struct Affix
+    {
+        QString strip;
+        QString append;
+        QRegularExpression condition;
+    };
+
+    struct AffixGroup
+    {
+        bool suffix;
+        bool cross;
+        std::vector<Affix> rules;
+    };
+
+    enum class FlagType
+    {
+        Char,
+        Long,
+        Number,
+    };
+
+    auto parseFlags(QString const& flags) const -> QStringList;
+    auto readAffixes(QString const& path) -> void;
+    auto readWords(QString const& path) -> bool;
+    auto addWord(QString const& word, QStringList const& flags) -> void;
+
+    static auto apply(AffixGroup const& group, QString const& word) -> QStringList;
+
+    QSet<QString> m_words;
+    QHash<QString, AffixGroup> m_affixes;
+    QByteArray m_encoding;
+    FlagType m_flagType;
+    QString m_needAffixFlag;
+    QString m_forbiddenFlag;
+};
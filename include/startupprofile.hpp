@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QWidget>
+
+#include <functional>
+
+// Timeline of the startup phases. Marks are always recorded, they're a clock read and
+// a push; with --profile-startup the timeline is printed to stderr once startup is
+// complete. With RICHTEXT_TRACING every phase is also recorded as a trace span.
+namespace startupprofile
+{
+
+// Zero of the timeline, call first thing in main
+void begin();
+void setEnabled(bool enabled);
+
+// `phase` must be a string literal
+void mark(char const* phase);
+auto elapsedMs() -> double;
+
+// Marks "first paint" when the widget is painted for the first time and then runs fn
+// from the event loop, so work queued there never delays the first frame. A window
+// that isn't painted within a second (started minimized) runs fn anyway.
+void afterFirstPaint(QWidget* widget, std::function<void()> fn);
+
+void report();
+
+}
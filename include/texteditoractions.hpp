@@ -3,13 +3,16 @@
 #include "actions.hpp"
 #include "tools.hpp"
 #include "editortabwidget.hpp"
+#include "framebuffer.hpp"
 
 #include <QTextCursor>
 #include <QTextCharFormat>
 #include <QTextEdit>
+#include <QDataStream>
 
 #include <type_traits>
 #include <tuple>
+#include <vector>
 
 template <typename... Items>
 struct StreamItemsMemento : public Memento
@@ -26,13 +29,7 @@ struct StreamItemsMemento : public Memento
 	{
 		QByteArray raw;
 		QDataStream rawStream{ &raw, QIODevice::WriteOnly };
-
-        //writeToStream(rawStream, m_items);
-        tools::tuple_for_each(m_items, [&rawStream](auto const& item)
-            {
-                rawStream << item;
-            }
-        );
+		writeRaw(rawStream);
 
 		return raw;
 	}
@@ -40,9 +37,23 @@ struct StreamItemsMemento : public Memento
 	void initFromRaw(QByteArray&& raw) override
 	{
 		QDataStream rawStream{ &raw, QIODevice::ReadOnly };
-        tools::tuple_for_each(m_items, [&rawStream](auto& item)
+		readRaw(rawStream);
+	}
+
+	void writeRaw(QDataStream& stream) const override
+	{
+        tools::tuple_for_each(m_items, [&stream](auto const& item)
             {
-                rawStream >> item;
+                stream << item;
+            }
+        );
+	}
+
+	void readRaw(QDataStream& stream) override
+	{
+        tools::tuple_for_each(m_items, [&stream](auto& item)
+            {
+                stream >> item;
             }
         );
 	}
@@ -60,29 +71,38 @@ struct EmptyMemento : public Memento
 
 	void initFromRaw(QByteArray&& raw) override
 	{	}
+
+	void writeRaw(QDataStream& stream) const override
+	{	}
+
+	void readRaw(QDataStream& stream) override
+	{	}
 };
 
 struct GlobalMementoBuilder : public MementoDeserializer
 {
 	bool actionIsSupported(ActionType action) const override;
 	ActionUP deserializeAction(QByteArray&& data, ActionType type) override;
+	ActionUP deserializeAction(QDataStream& stream, ActionType type) override;
 
     static void createInstance(EditorTabWidget* docsEditor);
     static GlobalMementoBuilder* instance();
 
 private:
+    friend struct ActionRegistry;
+
     static std::unique_ptr<GlobalMementoBuilder> _instance;
 
     GlobalMementoBuilder(EditorTabWidget* docsEditor);
 
 	template<typename ActionT, typename MementoT, typename... Args>
-	ActionUP build(QByteArray&& data, Args... actionArg) const
+	ActionUP build(QDataStream& stream, Args... actionArg) const
 	{
 		auto memento = std::make_unique<MementoT>();
-		memento->initFromRaw(std::move(data));
+		memento->readRaw(stream);
 		
 		auto action = std::unique_ptr<ActionT>{ new ActionT{std::forward<decltype(actionArg)>(actionArg)...} };
-		action->setMemento(std::move(memento));
+		action->m_memento.reset(memento.release());
 
 		return action;
 	}
@@ -335,6 +355,10 @@ private:
 	friend struct GlobalMementoBuilder;
 };
 
+// Opens the file read-only in a LargeFileViewer tab, as FileOpenAction does for files
+// of LargeFileViewer::autoThreshold and above
+void openInViewer(QString const& path, EditorTabWidget* docsEditor);
+
 struct DocNewMemento : public EmptyMemento
 {
     DocNewMemento() = default;
@@ -491,6 +515,8 @@ struct CommonAction : public Action
 	}
 
 protected:
+	friend struct GlobalMementoBuilder;
+
 	template<size_t Pos>
 	std::tuple_element_t<Pos, std::tuple<Types...>> getMementoItem()
 	{
@@ -651,3 +677,75 @@ private:
 
     friend struct GlobalMementoBuilder;
 };
+
+struct TextReplaceMemento : public StreamItemsMemento<int, int, QString>
+{
+    TextReplaceMemento() = default;
+    TextReplaceMemento(int pos, int length, QString const& text);
+
+    ActionType getActionType() const override;
+
+    friend struct TextReplaceAction;
+};
+
+using TextReplaceMementoUP = std::unique_ptr<TextReplaceMemento, std::default_delete<Memento>>;
+
+// Replaces `length` characters at `pos` with `text`
+struct TextReplaceAction : public Action
+{
+    TextReplaceAction(int pos, int length, QString const& text, QTextEdit* textEditor);
+
+    void execute() override;
+    const Memento* getMemento() const override;
+
+protected:
+    void setMemento(MementoUP memento) override;
+
+private:
+    friend struct GlobalMementoBuilder;
+
+    TextReplaceAction(QTextEdit* textEditor);
+
+    QTextEdit* m_editor;
+    TextReplaceMementoUP m_memento;
+};
+
+struct CompositeMemento : public Memento
+{
+    CompositeMemento() = default;
+    CompositeMemento(std::vector<ActionUP> children);
+
+    ActionType getActionType() const override;
+    QByteArray toRaw() const override;
+    void initFromRaw(QByteArray&& raw) override;
+    void writeRaw(QDataStream& stream) const override;
+    void readRaw(QDataStream& stream) override;
+
+private:
+    friend struct CompositeAction;
+
+    std::vector<ActionUP> m_children;
+};
+
+using CompositeMementoUP = std::unique_ptr<CompositeMemento, std::default_delete<Memento>>;
+
+// Children are executed in order inside one edit block and travel as one frame.
+// Their mementos are captured when they are constructed, so children that shift
+// text must be ordered so that later positions stay valid (e.g. back to front).
+struct CompositeAction : public Action
+{
+    CompositeAction(QTextEdit* textEditor);
+    CompositeAction(std::vector<ActionUP> children, QTextEdit* textEditor);
+
+    void execute() override;
+    const Memento* getMemento() const override;
+
+protected:
+    void setMemento(MementoUP memento) override;
+
+private:
+    friend struct GlobalMementoBuilder;
+
+    QTextEdit* m_editor;
+    CompositeMementoUP m_memento;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <vector>
+
+#include "blockchangetracker.hpp"
+#include "editortabwidget.hpp"
+#include "regexsearch.hpp"
+
+// Finds every occurrence of a string in the current document. A plain text snapshot
+// is split into textsearch::chunkSize chunks searched on a private pool; matches are
+// shown as they come in, but only those in the viewport become extra selections.
+// Any edit of the document restarts the search after a short delay. Regular
+// expressions go through RegexSearch instead, which rescans changed blocks only.
+// Replacing all matches reuses the finished search, plain or regex, so it waits for
+// the search when it's still running and reports through replaced.
+struct TextFinder : public QObject
+{
+    enum : int
+    {
+        HighlightProperty = QTextFormat::UserProperty + 2,
+    };
+
+    TextFinder(EditorTabWidget* docsEditor, QObject* parent = nullptr);
+    ~TextFinder();
+
+    void find(QString const& needle, bool caseSensitive, bool regex = false);
+    void clear();
+
+    auto count() const -> int;
+
+    auto next() -> bool;
+    auto previous() -> bool;
+    auto replaceCurrent(QString const& replacement) -> bool;
+    void replaceAll(QString const& replacement);
+
+signals:
+    void matchesChanged(int count, bool finished);
+    void finished(int count, qint64 elapsedMs);
+    void invalidPattern(QString const& error);
+    void replaced(int count);
+
+private slots:
+    void onEditorChanged(QTextEdit* editor);
+    void onDocumentChanged(QTextDocument* doc);
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void updateHighlights();
+    void onRegexMatchesChanged(int count, bool complete);
+
+private:
+    Q_OBJECT
+
+    using Match = RegexSearch::Match;
+
+    struct Chunk
+    {
+        std::vector<int> matches;
+        bool done;
+    };
+
+    auto restart() -> void;
+    auto cancel() -> void;
+    auto onChunkFound(quint64 generation, int index, std::vector<int> const& matches) -> void;
+    auto alignChunks() -> void;
+    auto replaceMatches(QString const& replacement) -> void;
+    auto matchAfter(int pos) const -> Match;
+    auto matchBefore(int pos) const -> Match;
+    auto matchesIn(int begin, int end) const -> std::vector<Match>;
+    auto select(Match match) -> void;
+
+    EditorTabWidget* m_docsEditor;
+    QPointer<QTextEdit> m_editor;
+    QPointer<QTextDocument> m_document;
+    QThreadPool m_pool;
+    blocktracking::Generation m_generation;
+    QTimer m_restartTimer;
+    QElapsedTimer m_elapsed;
+    QString m_needle;
+    bool m_caseSensitive;
+    bool m_regexMode;
+    QRegularExpression m_regex;
+    RegexSearch m_regexSearch;
+    int m_revision;
+    QString m_text;
+    std::vector<Chunk> m_chunks;
+    int m_pendingChunks;
+    int m_alignedChunks;
+    int m_alignedEnd;
+    int m_count;
+    bool m_replacePending;
+    QString m_replacement;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+
+#include <vector>
+
+// Plain substring search over UTF-16 text. Candidates are filtered with SSE2 or AVX2
+// (picked at runtime, scalar elsewhere) by comparing the first and last needle
+// characters of a whole vector of positions at once; only the survivors are compared
+// in full. Case-insensitive search folds the same way in every kernel (QChar's case
+// folding); the vector kernels are used only when the needle starts and ends with an
+// ASCII character. Matches are reported left to right without overlaps.
+namespace textsearch
+{
+
+auto kernelName() -> char const*;
+
+// Only matches starting in [begin, end) are reported, end < 0 meaning the end of the text
+auto findAll(QStringView text, QStringView needle, bool caseSensitive, int begin = 0, int end = -1) -> std::vector<int>;
+
+// Chunks searched on their own may disagree with one scan of the whole text when a match
+// runs over a chunk's end: makes matches of a chunk ending at end agree with a scan
+// whose last match before the chunk ended at from
+auto realign(QStringView text, QStringView needle, bool caseSensitive, int from, int end, std::vector<int>& matches) -> void;
+
+// Splits the text into chunks searched on QThreadPool::globalInstance()
+auto findAllParallel(QString const& text, QString const& needle, bool caseSensitive) -> std::vector<int>;
+
+// Chunk size used by findAllParallel and TextFinder
+constexpr int chunkSize = 1 << 20;
+
+}
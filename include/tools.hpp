@@ -1,5 +1,9 @@
 #pragma once
 
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <functional>
 #include <memory>
 #include <type_traits>
 #include <tuple>
@@ -56,6 +60,28 @@ inline int generate_random(int beg, int end = std::numeric_limits<int>::max())
 	return dstr(dev);
 }
 
+struct FunctionTask : public QRunnable
+{
+	FunctionTask(std::function<void()> fn)
+		: m_fn{std::move(fn)}
+	{	}
+
+	void run() override
+	{
+		m_fn();
+	}
+
+private:
+	std::function<void()> m_fn;
+};
+
+// Runs fn on the pool, without depending on QRunnable::create. Tasks with a higher
+// priority are taken from the queue first.
+inline auto startTask(QThreadPool* pool, std::function<void()> fn, int priority = 0) -> void
+{
+	pool->start(new FunctionTask{std::move(fn)}, priority);
+}
+
 template<size_t Ind = 0, typename... TItems, typename Func>
 void tuple_for_each(std::tuple<TItems...>& items, Func func)
 {
@@ -0,0 +1,56 @@
+#pragma once
+
+// Scoped spans recorded into per-thread ring buffers and exported as Chrome trace
+// JSON (chrome://tracing, ui.perfetto.dev). Built only with RICHTEXT_TRACING; otherwise
+// RTE_TRACE_SCOPE expands to nothing.
+
+#if defined(RICHTEXT_TRACING)
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdint>
+
+namespace tracing
+{
+
+// Nanoseconds on the steady clock
+std::int64_t now();
+
+// `name` must outlive the trace, string literals only
+void record(char const* name, std::int64_t beginNs, std::int64_t endNs);
+
+QByteArray dumpChromeTrace();
+void writeChromeTrace(QString const& path);
+
+struct Scope
+{
+    explicit Scope(char const* name)
+        : m_name{name}
+        , m_begin{now()}
+    {   }
+
+    ~Scope()
+    {
+        record(m_name, m_begin, now());
+    }
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+
+private:
+    char const* m_name;
+    std::int64_t m_begin;
+};
+
+}
+
+#define RTE_TRACE_CONCAT_INNER(a, b) a##b
+#define RTE_TRACE_CONCAT(a, b) RTE_TRACE_CONCAT_INNER(a, b)
+#define RTE_TRACE_SCOPE(name) ::tracing::Scope RTE_TRACE_CONCAT(rteTraceScope_, __LINE__){name}
+
+#else
+
+#define RTE_TRACE_SCOPE(name) static_cast<void>(0)
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <vector>
+
+#include <zlib.h>
+
+// Writes a zip archive front to back, so the device may be sequential. Deflated
+// entries are compressed as they're written and their CRC and sizes follow in a data
+// descriptor; stored entries are small and written whole. The central directory is
+// appended by finish(). No zip64, entries and the archive stay below 4 GB.
+struct ZipWriter
+{
+    ZipWriter(QIODevice* device);
+    ~ZipWriter();
+
+    // Written uncompressed with the sizes in the local header, as the ODF mimetype must be
+    auto addStored(QString const& name, QByteArray const& data) -> bool;
+
+    auto beginEntry(QString const& name) -> bool;
+    auto write(QByteArray const& data) -> bool;
+    auto endEntry() -> bool;
+
+    auto finish() -> bool;
+
+private:
+    struct Entry
+    {
+        QByteArray name;
+        quint16 method;
+        quint16 flags;
+        quint32 crc;
+        quint32 compressedSize;
+        quint32 size;
+        quint32 offset;
+    };
+
+    auto writeLocalHeader(Entry const& entry) -> bool;
+    auto deflateInto(int flush) -> bool;
+    auto put(QByteArray const& data) -> bool;
+
+    QIODevice* m_device;
+    std::vector<Entry> m_entries;
+    z_stream m_stream;
+    bool m_inEntry;
+    QByteArray m_buffer;
+    quint32 m_offset;
+    quint16 m_time;
+    quint16 m_date;
+};
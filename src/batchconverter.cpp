@@ -0,0 +1,187 @@
+#include "batchconverter.hpp"
+#include "documentwriters.hpp"
+#include "tools.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextDocument>
+#include <QThreadPool>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace batchconverter
+{
+
+namespace
+{
+
+auto convert(Job const& job) -> Result
+{
+    RTE_TRACE_SCOPE("convert.file");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result{ job, false, {}, 0 };
+
+    QTextDocument doc;
+    if (documentwriters::load(job.input, &doc, &result.error))
+    {
+        QDir{}.mkpath(QFileInfo{job.output}.absolutePath());
+        result.ok = documentwriters::save(&doc, job.output, &result.error);
+    }
+
+    result.ms = timer.nsecsElapsed() / 1e6;
+    return result;
+}
+
+}
+
+auto expand(QString const& inputGlob, QString const& outputPattern) -> std::vector<Job>
+{
+    QFileInfo glob{inputGlob};
+    QDir dir{glob.path()};
+
+    auto names = dir.entryList(QStringList{glob.fileName()}, QDir::Files, QDir::Name);
+    auto star = outputPattern.indexOf('*');
+
+    std::vector<Job> jobs;
+    jobs.reserve(names.size());
+
+    for (auto const& name : names)
+    {
+        auto output = outputPattern;
+        if (star >= 0)
+        {
+            output.replace(star, 1, QFileInfo{name}.completeBaseName());
+        }
+
+        jobs.push_back(Job{ dir.filePath(name), output });
+    }
+
+    return jobs;
+}
+
+auto collisions(std::vector<Job> const& jobs) -> QStringList
+{
+    std::map<QString, int> outputs;
+    QStringList result;
+
+    for (auto const& job : jobs)
+    {
+        auto path = QFileInfo{job.output}.absoluteFilePath();
+
+        if (++outputs[path] == 2)
+        {
+            result << path;
+        }
+    }
+
+    return result;
+}
+
+auto run(std::vector<Job> const& jobs, int threads, std::function<void(Result const&)> report) -> Summary
+{
+    RTE_TRACE_SCOPE("convert.run");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Summary summary{ 0, 0, 0 };
+    std::mutex mutex;
+
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        pool.setExpiryTimeout(-1);
+
+        for (auto const& job : jobs)
+        {
+            tools::startTask(&pool, [&, job]
+                {
+                    auto result = convert(job);
+
+                    std::lock_guard<std::mutex> lock{mutex};
+                    ++(result.ok ? summary.converted : summary.failed);
+                    report(result);
+                }
+            );
+        }
+
+        pool.waitForDone();
+    }
+
+    summary.ms = timer.nsecsElapsed() / 1e6;
+
+    RTE_LOG_INFO("batch conversion done",
+        {"converted", summary.converted},
+        {"failed", summary.failed},
+        {"threads", threads},
+        {"ms", summary.ms});
+
+    return summary;
+}
+
+auto convertAndReport(QString const& input, QString const& output, int threads) -> int
+{
+    auto jobs = expand(input, output);
+    if (jobs.empty())
+    {
+        std::cerr << "No files match " << input.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto clashes = collisions(jobs);
+    if (!clashes.isEmpty())
+    {
+        for (auto const& path : clashes)
+        {
+            std::cerr << "Several inputs would be written to " << path.toStdString() << std::endl;
+        }
+
+        return EXIT_FAILURE;
+    }
+
+    auto summary = run(jobs, threads, [](Result const& result)
+        {
+            if (result.ok)
+            {
+                std::cout << QString{"ok    %1 ms  %2 -> %3"}
+                        .arg(result.ms, 8, 'f', 1)
+                        .arg(result.job.input)
+                        .arg(result.job.output)
+                        .toStdString()
+                    << '\n';
+            }
+            else
+            {
+                std::cout << QString{"fail  %1 ms  %2 -> %3: %4"}
+                        .arg(result.ms, 8, 'f', 1)
+                        .arg(result.job.input)
+                        .arg(result.job.output)
+                        .arg(result.error)
+                        .toStdString()
+                    << '\n';
+            }
+        }
+    );
+
+    std::cout << QString{"%1 converted, %2 failed in %3 ms with %4 threads (%5 files/s)"}
+            .arg(summary.converted)
+            .arg(summary.failed)
+            .arg(summary.ms, 0, 'f', 1)
+            .arg(threads)
+            .arg(summary.ms > 0 ? jobs.size() * 1000.0 / summary.ms : 0.0, 0, 'f', 1)
+            .toStdString()
+        << std::endl;
+
+    return summary.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
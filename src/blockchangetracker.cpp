@@ -0,0 +1,103 @@
+#include "blockchangetracker.hpp"
+
+#include <QTextBlock>
+
+#include <algorithm>
+
+BlockChangeTracker::BlockChangeTracker(QObject* parent)
+    : QObject{parent}
+    , m_blockCount{0}
+{   }
+
+void BlockChangeTracker::setDocument(QTextDocument* doc)
+{
+    if (m_document)
+    {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &BlockChangeTracker::onContentsChange);
+    }
+
+    m_document = doc;
+    m_blockCount = m_document ? m_document->blockCount() : 0;
+
+    if (m_document)
+    {
+        connect(m_document, &QTextDocument::contentsChange, this, &BlockChangeTracker::onContentsChange);
+    }
+
+    emit reset(m_blockCount);
+}
+
+auto BlockChangeTracker::document() const -> QTextDocument*
+{
+    return m_document;
+}
+
+// contentsChange arrives once the edit is done, so the block count is already the new one
+void BlockChangeTracker::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    auto blockCount = m_document->blockCount();
+    auto previousCount = m_blockCount;
+    auto delta = blockCount - previousCount;
+    m_blockCount = blockCount;
+
+    auto firstBlock = m_document->findBlock(position);
+    auto lastBlock = m_document->findBlock(position + charsAdded);
+
+    auto first = firstBlock.isValid() ? firstBlock.blockNumber() : blockCount - 1;
+    auto last = lastBlock.isValid() ? lastBlock.blockNumber() : blockCount - 1;
+    auto added = last - first + 1;
+    auto removed = added - delta;
+
+    if (first < 0 || removed < 0 || first + removed > previousCount)
+    {
+        emit reset(blockCount);
+        return;
+    }
+
+    emit blocksChanged(first, removed, added);
+}
+
+namespace blocktracking
+{
+
+auto Generation::Token::isCancelled() const -> bool
+{
+    return current->load() != generation;
+}
+
+Generation::Generation()
+    : m_current{std::make_shared<std::atomic<quint64>>(0)}
+{   }
+
+auto Generation::token() const -> Token
+{
+    return Token{ m_current, m_current->load() };
+}
+
+auto Generation::isCurrent(quint64 generation) const -> bool
+{
+    return m_current->load() == generation;
+}
+
+auto Generation::cancel(QThreadPool& pool) -> void
+{
+    ++*m_current;
+    pool.clear();
+}
+
+auto otherSelections(QTextEdit* editor, int property) -> QList<QTextEdit::ExtraSelection>
+{
+    QList<QTextEdit::ExtraSelection> selections;
+
+    for (auto const& selection : editor->extraSelections())
+    {
+        if (!selection.format.hasProperty(property))
+        {
+            selections.append(selection);
+        }
+    }
+
+    return selections;
+}
+
+}
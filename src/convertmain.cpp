@@ -0,0 +1,54 @@
+#include "batchconverter.hpp"
+#include "logging.hpp"
+#include "config.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+// The editor's --convert without the window and the session: links only the core,
+// so it runs where there's no D-Bus and serves as the CLI build for profiling
+auto main(int argc, char* argv[]) -> int
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("richtext_convert");
+    QApplication::setApplicationVersion(PROJECT_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts editor HTML files into HTML, Markdown or ODT");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        {{"o", "output"}, "Output path, '*' stands for the input's base name and the extension picks the format (html, md, odt).", "pattern"},
+        {{"j", "jobs"}, "Number of conversion threads. Default is the number of cores.", "count"},
+        {"log-level", "Minimal level of log records: trace, debug, info, warning, error or off. Default is info.", "level"},
+        {"log-file", "Write log to file instead of stderr.", "path"},
+    });
+    parser.addPositionalArgument("input", "Glob of the HTML files to convert.", "INPUT_GLOB");
+    parser.process(app);
+
+    auto inputs = parser.positionalArguments();
+    if (inputs.size() != 1 || !parser.isSet("output"))
+    {
+        std::cerr << "Needs one input glob and --output" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (parser.isSet("log-level"))
+    {
+        logging::setLevel(logging::parseLevel(parser.value("log-level")));
+    }
+
+    auto threads = parser.isSet("jobs") ? std::max(1, parser.value("jobs").toInt()) : QThread::idealThreadCount();
+
+    logging::start(parser.value("log-file"));
+    auto code = batchconverter::convertAndReport(inputs.front(), parser.value("output"), threads);
+    logging::stop();
+
+    return code;
+}
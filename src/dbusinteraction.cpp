@@ -0,0 +1,406 @@
+#include "dbusinteraction.hpp"
+#include "tools.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
+
+#include <QCoreApplication>
+#include <QDBusMessage>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+
+constexpr int joinAttempts = 5;
+constexpr int joinTimeoutMs = 3000;
+constexpr int firstRetryDelayMs = 250;
+constexpr int maxRetryDelayMs = 4000;
+
+// A running instance answers right away, a longer wait is worse than a new process
+constexpr int forwardTimeoutMs = 1000;
+
+// Bus name elements are [A-Za-z0-9_-] and don't start with a digit
+auto instanceServiceName(QString const& session) -> QString
+{
+	QString element;
+	for (auto ch : session)
+	{
+		element += (ch.isLetterOrNumber() && ch.unicode() < 0x80) || ch == '_' || ch == '-' ? ch : QChar{'_'};
+	}
+
+	if (element.isEmpty() || element.front().isDigit())
+	{
+		element.prepend('_');
+	}
+
+	return SERVICE_NAME ".sessions." + element;
+}
+
+// Threads of their own, so a hung connect doesn't hold a thread of the global pool,
+// which search and QtConcurrent share. One per join attempt: an attempt stuck in the
+// bus mustn't keep the retries from starting. Never destroyed, a stuck attempt mustn't
+// hold up the exit either.
+auto joinPool() -> QThreadPool*
+{
+	static auto pool = []
+	{
+		auto pool = new QThreadPool;
+		pool->setMaxThreadCount(joinAttempts);
+		return pool;
+	}();
+
+	return pool;
+}
+
+// Forwarding to a running instance has its own thread, it can't delay a join
+auto forwardPool() -> QThreadPool*
+{
+	static auto pool = []
+	{
+		auto pool = new QThreadPool;
+		pool->setMaxThreadCount(1);
+		return pool;
+	}();
+
+	return pool;
+}
+
+}
+
+EnabledInteraction::EnabledInteraction(QObject* parent)
+	: Interaction{parent}
+	, m_server{ nullptr }
+	, m_client{ nullptr }
+	, m_connection{ QDBusConnection::sessionBus() }
+{	}
+
+EnabledInteraction::EnabledInteraction(QDBusConnection const& connection, QObject* parent)
+	: Interaction{parent}
+	, m_server{ nullptr }
+	, m_client{ nullptr }
+	, m_connection{ connection }
+{	}
+
+void EnabledInteraction::initInstance(QString const& session, bool serveInstance)
+{
+	if (!m_connection.isConnected())
+	{
+		throw std::runtime_error{"Can't connect to DBus daemon. Check daemon state"};
+	}
+
+	m_server = new DBusPublisher{ this };
+	m_client = new DBusSubscriber{ {}, "/sessions/" + session, m_connection, this };
+
+	connect(m_client, &DBusSubscriber::action, this, &EnabledInteraction::onAction);
+
+#if defined(RICHTEXT_TRACING)
+	new TraceAdaptor{ this };
+#endif
+
+	if (!m_connection.registerObject("/sessions/" + session, this))
+	{
+		auto error = "Can't register object... " + m_connection.lastError().message();
+		throw std::runtime_error{error.toStdString()};
+	}
+
+	if (!serveInstance)
+	{
+		return;
+	}
+
+	// Only the first process of the session gets the name, the others just take part
+	auto instance = new QObject{ this };
+	new InstanceAdaptor{ this, instance };
+
+	if (m_connection.registerObject(INSTANCE_PATH, instance) && m_connection.registerService(instanceServiceName(session)))
+	{
+		RTE_LOG_INFO("serving session instance", {"session", session});
+	}
+	else
+	{
+		m_connection.unregisterObject(INSTANCE_PATH);
+		delete instance;
+	}
+}
+
+void EnabledInteraction::sendMessage(QByteArray const& frame)
+{
+	emit action(QDBusVariant{ QVariant{frame} });
+}
+
+void EnabledInteraction::onAction(QDBusVariant const& action)
+{
+	emit messageReceived(action.variant().toByteArray());
+}
+
+DBusPublisher::DBusPublisher(QObject* parent)
+	: QDBusAbstractAdaptor(parent)
+{
+	setAutoRelaySignals(true);
+}
+
+
+DBusSubscriber::DBusSubscriber(const QString& service, const QString& path, const QDBusConnection& connection, QObject* parent)
+    : QDBusAbstractInterface(service, path, INTERFACE_NAME, connection, parent)
+{	}
+
+InstanceAdaptor::InstanceAdaptor(Interaction* interaction, QObject* parent)
+	: QDBusAbstractAdaptor(parent)
+	, m_interaction{ interaction }
+{	}
+
+bool InstanceAdaptor::openFiles(QStringList const& paths)
+{
+	RTE_LOG_INFO("files forwarded by another launch", {"files", paths.size()});
+
+	emit m_interaction->openFilesRequested(paths);
+	return true;
+}
+
+#if defined(RICHTEXT_TRACING)
+TraceAdaptor::TraceAdaptor(QObject* parent)
+	: QDBusAbstractAdaptor(parent)
+{	}
+
+QByteArray TraceAdaptor::chromeTrace()
+{
+	return tracing::dumpChromeTrace();
+}
+
+bool TraceAdaptor::writeChromeTrace(QString const& path)
+{
+	try
+	{
+		tracing::writeChromeTrace(path);
+		return true;
+	}
+	catch (std::exception const&)
+	{
+		return false;
+	}
+}
+#endif
+
+void DBusSession::createSession(QString const& session, bool serveInstance)
+{
+	if (_instance && !_instance->isPending())
+	{
+		throw std::logic_error{
+			QString{"%1: Attemption create exist instance"}
+				.arg(FUNC_SIGN)
+				.toStdString()
+		};
+	}
+
+	if (!_instance)
+	{
+		createPending();
+	}
+
+	auto joiner = new SessionJoiner{ session, serveInstance, _instance };
+	joiner->start();
+}
+
+// Paths are made absolute here, the running process has its own working directory.
+// Connecting waits for the daemon just like the call does, so both run on the forward
+// thread and the launch waits for them at most forwardTimeoutMs in all; a late answer
+// is dropped and the files open here.
+bool DBusSession::openInRunning(QString const& session, QStringList const& paths)
+{
+	RTE_TRACE_SCOPE("session.openInRunning");
+
+	QStringList absolute;
+	for (auto const& path : paths)
+	{
+		absolute << QFileInfo{ path }.absoluteFilePath();
+	}
+
+	struct Forward
+	{
+		QSemaphore done;
+		std::atomic<bool> opened{ false };
+	};
+
+	auto forward = std::make_shared<Forward>();
+
+	tools::startTask(forwardPool(), [forward, session, absolute]
+		{
+			auto const name = QStringLiteral("richtext-forward");
+			auto connection = QDBusConnection::connectToBus(QDBusConnection::SessionBus, name);
+
+			if (connection.isConnected())
+			{
+				auto call = QDBusMessage::createMethodCall(instanceServiceName(session), INSTANCE_PATH, INSTANCE_INTERFACE_NAME, "openFiles");
+				call.setAutoStartService(false);
+				call << absolute;
+
+				auto reply = connection.call(call, QDBus::Block, forwardTimeoutMs);
+				if (reply.type() == QDBusMessage::ReplyMessage)
+				{
+					forward->opened = reply.arguments().value(0).toBool();
+				}
+				else
+				{
+					RTE_LOG_DEBUG("no running instance", {"session", session}, {"error", reply.errorMessage()});
+				}
+			}
+
+			QDBusConnection::disconnectFromBus(name);
+			forward->done.release();
+		}
+	);
+
+	if (!forward->done.tryAcquire(1, forwardTimeoutMs))
+	{
+		RTE_LOG_WARNING("no answer from the bus, opening the files here", {"session", session}, {"ms", forwardTimeoutMs});
+		return false;
+	}
+
+	return forward->opened;
+}
+
+void DBusSession::createCommon()
+{
+	createSession("common");
+}
+
+void DBusSession::createDetached()
+{
+	createSession(QString{"session_%1"}.arg(tools::generate_random(0, 1000)));
+}
+
+SessionJoiner::SessionJoiner(QString const& session, bool serveInstance, QObject* parent)
+	: QObject{parent}
+	, m_session{ session }
+	, m_serveInstance{ serveInstance }
+	, m_attempts{ 0 }
+	, m_inFlight{ std::make_shared<std::atomic<int>>(0) }
+{
+	m_timeout.setSingleShot(true);
+	m_timeout.setInterval(joinTimeoutMs);
+
+	connect(&m_timeout, &QTimer::timeout, this, [this]
+		{
+			retry(QString{"No answer from the bus in %1 ms"}.arg(joinTimeoutMs));
+		}
+	);
+}
+
+SessionJoiner::~SessionJoiner()
+{
+	*m_inFlight = 0;
+}
+
+void SessionJoiner::start()
+{
+	attempt();
+}
+
+// Connecting waits for the daemon's reply to Hello and registering the instance name
+// for the reply to RequestName, so both run on a join thread. The interaction is
+// handed to the GUI thread before the task ends; one arriving after its attempt was
+// given up is deleted and its connection closed. An attempt given up before it got
+// to registering doesn't register at all, so it can't take the instance name.
+void SessionJoiner::attempt()
+{
+	auto attempt = ++m_attempts;
+	auto name = QString{"richtext-join-%1"}.arg(attempt);
+	QPointer<SessionJoiner> guard{ this };
+
+	*m_inFlight = attempt;
+	m_timeout.start();
+
+	RTE_LOG_DEBUG("joining session", {"session", m_session}, {"attempt", attempt});
+
+	tools::startTask(joinPool(), [guard, inFlight = m_inFlight, attempt, name, session = m_session, serveInstance = m_serveInstance]
+		{
+			RTE_TRACE_SCOPE("session.connect");
+
+			std::unique_ptr<EnabledInteraction> interaction;
+			QString error;
+
+			auto connection = QDBusConnection::connectToBus(QDBusConnection::SessionBus, name);
+			if (*inFlight != attempt)
+			{
+				error = QStringLiteral("Attempt given up");
+			}
+			else if (connection.isConnected())
+			{
+				try
+				{
+					interaction = std::make_unique<EnabledInteraction>(connection);
+					interaction->initInstance(session, serveInstance);
+					interaction->moveToThread(QCoreApplication::instance()->thread());
+				}
+				catch (std::exception const& excp)
+				{
+					interaction.reset();
+					error = QString::fromStdString(excp.what());
+				}
+			}
+			else
+			{
+				error = connection.lastError().message();
+			}
+
+			QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, attempt, name, joined = interaction.release(), error]
+				{
+					if (guard && *guard->m_inFlight == attempt)
+					{
+						guard->onConnected(attempt, name, joined, error);
+					}
+					else
+					{
+						delete joined;
+						QDBusConnection::disconnectFromBus(name);
+					}
+				},
+				Qt::QueuedConnection
+			);
+		}
+	);
+}
+
+void SessionJoiner::onConnected(int attempt, QString const& name, EnabledInteraction* interaction, QString const& error)
+{
+	m_timeout.stop();
+	*m_inFlight = 0;
+
+	if (!interaction)
+	{
+		QDBusConnection::disconnectFromBus(name);
+		retry(error);
+		return;
+	}
+
+	RTE_LOG_INFO("session joined", {"session", m_session}, {"attempts", attempt});
+
+	DBusSession::instance()->completeJoin(interaction);
+	deleteLater();
+}
+
+void SessionJoiner::retry(QString const& error)
+{
+	m_timeout.stop();
+	*m_inFlight = 0;
+
+	if (m_attempts >= joinAttempts)
+	{
+		RTE_LOG_ERROR("can't join session, working offline", {"session", m_session}, {"attempts", m_attempts}, {"error", error});
+
+		DBusSession::instance()->failJoin(error);
+		deleteLater();
+		return;
+	}
+
+	auto delay = std::min(firstRetryDelayMs << (m_attempts - 1), maxRetryDelayMs);
+	RTE_LOG_WARNING("session join failed, retrying", {"session", m_session}, {"attempt", m_attempts}, {"error", error}, {"delayMs", delay});
+
+	QTimer::singleShot(delay, this, &SessionJoiner::attempt);
+}
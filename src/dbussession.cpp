@@ -1,5 +1,7 @@
 #include "dbussession.hpp"
 #include "tools.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
 
 #include <QDebug>
 #include <QDataStream>
@@ -8,88 +10,108 @@ Interaction::Interaction(QObject* parent)
 	: QObject{parent}
 {	}
 
-EnabledInteraction::EnabledInteraction(QObject* parent)
-	: Interaction{parent}
-	, m_server{ nullptr }
-	, m_client{ nullptr }
-	, m_connection{ QDBusConnection::sessionBus() }
+InProcessBus::InProcessBus(QObject* parent)
+	: QObject{parent}
 {	}
 
-void EnabledInteraction::initInstance(QString const& session)
+void InProcessBus::publish(QByteArray const& frame)
 {
-	if (!m_connection.isConnected())
-	{
-		throw std::runtime_error{"Can't connect to DBus daemon. Check daemon state"};
-	}
-
-	m_server = new DBusPublisher{ this };
-	m_client = new DBusSubscriber{ {}, "/sessions/" + session, m_connection, this };
-
-	connect(m_client, &DBusSubscriber::action, this, &EnabledInteraction::messageReceived);
-
-	if (!m_connection.registerObject("/sessions/" + session, this))
-	{
-		auto error = "Can't register object... " + m_connection.lastError().message();
-		throw std::runtime_error{error.toStdString()};
-	}
+	emit message(frame);
 }
 
-void EnabledInteraction::sendMessage(QDBusVariant const& msg)
+InProcessInteraction::InProcessInteraction(InProcessBus* bus, QObject* parent)
+	: Interaction{parent}
+	, m_bus{bus}
 {
-	emit action(msg);
+	connect(m_bus, &InProcessBus::message, this, &InProcessInteraction::messageReceived);
 }
 
-DBusPublisher::DBusPublisher(QObject* parent)
-	: QDBusAbstractAdaptor(parent)
+void InProcessInteraction::sendMessage(QByteArray const& frame)
 {
-	setAutoRelaySignals(true);
+	m_bus->publish(frame);
 }
 
+namespace
+{
 
-DBusSubscriber::DBusSubscriber(const QString& service, const QString& path, const QDBusConnection& connection, QObject* parent)
-    : QDBusAbstractInterface(service, path, INTERFACE_NAME, connection, parent)
-{	}
+// Frames sent while joining past this are still kept, but worth a warning
+constexpr qint64 largeBacklogBytes = 16 * 1024 * 1024;
+
+}
 
 DBusSession* DBusSession::_instance{nullptr};
 
 DBusSession::DBusSession()
 	: QObject{nullptr}
 	, m_interaction{nullptr}
+	, m_pending{false}
 	, m_appId{tools::generate_random(0, 1000)}
-{	}
+	, m_backlogBytes{0}
+	, m_backlogWarned{false}
+{
+	m_payload.reserve(256);
+}
+
+DBusSession* DBusSession::create(Interaction* interaction)
+{
+	auto session = new DBusSession{};
+	interaction->setParent(session);
+	session->m_interaction = interaction;
+	connect(interaction, &Interaction::messageReceived, session, &DBusSession::parseMessage);
+	connect(interaction, &Interaction::openFilesRequested, session, &DBusSession::openFilesRequested);
+
+	return session;
+}
+
+void DBusSession::createDisabled()
+{
+	_instance = create(new DisabledInteraction{});
+}
+
+void DBusSession::createPending()
+{
+	_instance = create(new DisabledInteraction{});
+	_instance->m_pending = true;
+}
 
-void DBusSession::createSession(QString const& session)
+void DBusSession::join(Interaction* interaction)
 {
-	if (_instance)
+	delete m_interaction;
+
+	interaction->setParent(this);
+	m_interaction = interaction;
+	m_pending = false;
+	connect(interaction, &Interaction::messageReceived, this, &DBusSession::parseMessage);
+	connect(interaction, &Interaction::openFilesRequested, this, &DBusSession::openFilesRequested);
+
+	RTE_LOG_DEBUG("flushing session backlog", {"frames", m_backlog.size()}, {"bytes", m_backlogBytes});
+
+	for (auto const& frame : m_backlog)
 	{
-		throw std::logic_error{
-			QString{"%1: Attemption create exist instance"}
-				.arg(FUNC_SIGN)
-				.toStdString()
-		};
+		m_interaction->sendMessage(frame);
 	}
 
-    _instance = new DBusSession{};
-	auto interaction = new EnabledInteraction{ _instance };
-    interaction->initInstance(session);
-	_instance->m_interaction = interaction;
-	connect(_instance->m_interaction, &EnabledInteraction::messageReceived, _instance, &DBusSession::parseMessage);
+	m_backlog.clear();
+	m_backlog.shrink_to_fit();
+	m_backlogBytes = 0;
+	m_backlogWarned = false;
 }
 
-void DBusSession::createCommon()
+void DBusSession::completeJoin(Interaction* interaction)
 {
-	createSession("common");
+	join(interaction);
+	emit joined();
 }
 
-void DBusSession::createDisabled()
+void DBusSession::failJoin(QString const& error)
 {
-	_instance = new DBusSession{};
-	_instance->m_interaction = new DisabledInteraction{};
+	join(new DisabledInteraction{});
+	emit joinFailed(error);
 }
 
-void DBusSession::createDetached()
+bool DBusSession::isPending() const
 {
-	createSession("session_" + tools::generate_random(0, 1000));
+	return m_pending;
 }
 
 DBusSession* DBusSession::instance()
@@ -99,45 +121,86 @@ DBusSession* DBusSession::instance()
 
 void DBusSession::sendString(QString const& ev)
 {
-	m_interaction->sendMessage(packPackage(ev.toUtf8(), m_appId, 100));
+	send(packPackage(ev.toUtf8(), m_appId, 100));
 }
 
 void DBusSession::sendAction(ActionUP act)
 {
+	RTE_TRACE_SCOPE("session.sendAction");
+
 	auto memento = act->getMemento();
-	auto data = memento->toRaw();
-	auto type = static_cast<quint16>(memento->getActionType());
-	m_interaction->sendMessage(packPackage(data, m_appId, type));
+	auto type = static_cast<int>(memento->getActionType());
+
+	auto& stream = m_writer.begin();
+	stream << m_appId << type;
+	auto payload = m_writer.beginBlock();
+	memento->writeRaw(stream);
+	m_writer.endBlock(payload);
+
+	send(m_writer.data());
+}
+
+// The copy in the backlog shares the writer's buffer, which detaches on the next frame
+void DBusSession::send(QByteArray const& frame)
+{
+	if (!m_pending)
+	{
+		m_interaction->sendMessage(frame);
+		return;
+	}
+
+	// Every frame is kept: later edits depend on earlier ones, so replaying only part
+	// of the backlog would leave peers with different documents
+	m_backlog.push_back(frame);
+	m_backlogBytes += frame.size();
+
+	if (m_backlogBytes > largeBacklogBytes && !m_backlogWarned)
+	{
+		RTE_LOG_WARNING("session backlog is large, still joining", {"bytes", m_backlogBytes}, {"frames", m_backlog.size()});
+		m_backlogWarned = true;
+	}
 }
 
-QDBusVariant DBusSession::packPackage(QByteArray const& data, int appId, int actionType)
+QByteArray DBusSession::packPackage(QByteArray const& data, int appId, int actionType)
 {
-	QByteArray package;
-	QDataStream stream{ &package, QIODevice::WriteOnly };
+	RTE_TRACE_SCOPE("session.packPackage");
+
+	auto& stream = m_writer.begin();
 	stream << appId << actionType << data;
 
-	return QDBusVariant{ QVariant{package} };
+	return m_writer.data();
 }
 
-void DBusSession::parseMessage(QDBusVariant const& msg)
+void DBusSession::parseMessage(QByteArray const& frame)
 {
-	auto variant = msg.variant();
-	auto data = variant.toByteArray();
-	int appId{ -1 };
+	RTE_TRACE_SCOPE("session.parseMessage");
+
+	emit frameReceived(frame);
 
-	QByteArray raw;
+	int appId{ -1 };
 	int type{ -1 };
+	quint32 length{ 0 };
 
-	QDataStream stream{ &data, QIODevice::ReadOnly };
-	stream >> appId;
+	auto& stream = m_reader.open(frame);
+	stream >> appId >> type >> length;
 
-	if (appId == m_appId)
+	if (length == 0xFFFFFFFF)
 	{
-		return;
+		length = 0;
+	}
+
+	auto valid = appId != m_appId && length <= static_cast<quint32>(frame.size());
+	if (valid)
+	{
+		m_payload.resize(static_cast<int>(length));
+		valid = stream.readRawData(m_payload.data(), static_cast<int>(length)) == static_cast<int>(length);
 	}
-	
-	stream >> type;
-	stream >> raw;
 
-	emit actionReceived(static_cast<ActionType>(type), raw);
+	// drop the reference to the sender's buffer so it can be reused without detaching
+	m_reader.release();
+
+	if (valid)
+	{
+		emit actionReceived(static_cast<ActionType>(type), m_payload);
+	}
 }
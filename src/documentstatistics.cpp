@@ -0,0 +1,111 @@
+#include "documentstatistics.hpp"
+#include "tracing.hpp"
+
+#include <QTextBlock>
+
+#include <algorithm>
+#include <vector>
+
+DocumentStatistics::DocumentStatistics(QObject* parent)
+    : QObject{parent}
+{
+    connect(&m_tracker, &BlockChangeTracker::reset, this, &DocumentStatistics::onReset);
+    connect(&m_tracker, &BlockChangeTracker::blocksChanged, this, &DocumentStatistics::onBlocksChanged);
+}
+
+void DocumentStatistics::setDocument(QTextDocument* doc)
+{
+    m_tracker.setDocument(doc);
+}
+
+auto DocumentStatistics::totals() const -> Counts
+{
+    auto total = m_blocks.total();
+    return Counts{ total.words, total.characters, total.paragraphs };
+}
+
+auto DocumentStatistics::wordsBefore(QTextCursor const& cursor) const -> int
+{
+    auto block = cursor.block();
+    if (!block.isValid())
+    {
+        return 0;
+    }
+
+    auto text = block.text();
+    return m_blocks.prefix(block.blockNumber()).words + countWords(QStringView{text}.left(cursor.positionInBlock()));
+}
+
+// A word is a run of characters that aren't white space
+auto DocumentStatistics::countWords(QStringView text) -> int
+{
+    auto words = 0;
+    auto inWord = false;
+
+    for (auto chr : text)
+    {
+        auto space = chr.isSpace();
+        words += (!space && !inWord) ? 1 : 0;
+        inWord = !space;
+    }
+
+    return words;
+}
+
+void DocumentStatistics::onReset(int blockCount)
+{
+    RTE_TRACE_SCOPE("statistics.reset");
+
+    std::vector<BlockCounts> counts;
+    counts.reserve(blockCount);
+
+    if (auto doc = m_tracker.document())
+    {
+        for (auto block = doc->begin(); block.isValid(); block = block.next())
+        {
+            counts.push_back(countBlock(block));
+        }
+    }
+
+    m_blocks.assign(counts);
+    emit changed();
+}
+
+void DocumentStatistics::onBlocksChanged(int first, int removed, int added)
+{
+    RTE_TRACE_SCOPE("statistics.update");
+
+    auto block = m_tracker.document()->findBlockByNumber(first);
+    auto kept = std::min(removed, added);
+
+    for (auto i = first; i < first + kept; ++i, block = block.next())
+    {
+        m_blocks.set(i, countBlock(block));
+    }
+
+    if (removed > kept)
+    {
+        m_blocks.erase(first + kept, removed - kept);
+    }
+
+    if (added > kept)
+    {
+        std::vector<BlockCounts> counts;
+        counts.reserve(added - kept);
+
+        for (auto i = kept; i < added; ++i, block = block.next())
+        {
+            counts.push_back(countBlock(block));
+        }
+
+        m_blocks.insert(first + kept, counts);
+    }
+
+    emit changed();
+}
+
+auto DocumentStatistics::countBlock(QTextBlock const& block) const -> BlockCounts
+{
+    auto text = block.text();
+    return BlockCounts{ countWords(text), text.size(), text.isEmpty() ? 0 : 1 };
+}
@@ -0,0 +1,303 @@
+#include "documentstyles.hpp"
+#include "dbussession.hpp"
+#include "tools.hpp"
+
+#include <QDataStream>
+#include <QFont>
+#include <QTextBlock>
+#include <QTextCursor>
+
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+
+constexpr quint32 savedVersion = 1;
+
+}
+
+DocumentStyles::DocumentStyles(QTextDocument* doc)
+    : QObject{doc}
+{
+    setObjectName("documentStyles");
+    defineBuiltIns();
+}
+
+auto DocumentStyles::of(QTextDocument* doc) -> DocumentStyles*
+{
+    if (auto styles = doc->findChild<DocumentStyles*>("documentStyles", Qt::FindDirectChildrenOnly))
+    {
+        return styles;
+    }
+
+    return new DocumentStyles{doc};
+}
+
+auto DocumentStyles::find(QTextDocument const* doc) -> DocumentStyles const*
+{
+    return doc->findChild<DocumentStyles const*>("documentStyles", Qt::FindDirectChildrenOnly);
+}
+
+// Random rather than derived from the name: two names can't share an id here, and
+// peers defining styles at the same time are unlikely to pick the same one
+auto DocumentStyles::allocateId(QString const& name) const -> int
+{
+    for (auto const& style : m_styles)
+    {
+        if (style.name == name && style.id >= FirstUserId)
+        {
+            return style.id;
+        }
+    }
+
+    auto id = 0;
+    do
+    {
+        id = tools::generate_random(FirstUserId);
+    }
+    while (m_styles.contains(id));
+
+    return id;
+}
+
+// Built-ins aren't written, every peer has them. Paragraph styles are found by block,
+// character styles by fragment; a paragraph style also marks its block's text, so
+// runs carry both kinds.
+auto DocumentStyles::save(QTextDocument const* doc) -> QByteArray
+{
+    auto styles = find(doc);
+    if (!styles)
+    {
+        return {};
+    }
+
+    QVector<Style> definitions;
+    for (auto const& style : styles->styles())
+    {
+        if (style.id >= FirstUserId)
+        {
+            definitions.push_back(style);
+        }
+    }
+
+    QVector<QPair<int, int>> blocks;
+    QVector<std::tuple<int, int, int>> runs;
+
+    for (auto block = doc->begin(); block.isValid(); block = block.next())
+    {
+        auto fmt = block.blockFormat();
+        if (fmt.hasProperty(StyleIdProperty))
+        {
+            blocks.push_back({ block.blockNumber(), fmt.intProperty(StyleIdProperty) });
+        }
+
+        for (auto it = block.begin(); !it.atEnd(); ++it)
+        {
+            auto fragment = it.fragment();
+            auto charFmt = fragment.charFormat();
+
+            if (!charFmt.hasProperty(StyleIdProperty))
+            {
+                continue;
+            }
+
+            auto id = charFmt.intProperty(StyleIdProperty);
+            if (!runs.isEmpty() && std::get<2>(runs.back()) == id && std::get<0>(runs.back()) + std::get<1>(runs.back()) == fragment.position())
+            {
+                std::get<1>(runs.back()) += fragment.length();
+            }
+            else
+            {
+                runs.push_back({ fragment.position(), fragment.length(), id });
+            }
+        }
+    }
+
+    if (definitions.isEmpty() && blocks.isEmpty() && runs.isEmpty())
+    {
+        return {};
+    }
+
+    QByteArray data;
+    QDataStream stream{&data, QIODevice::WriteOnly};
+
+    stream << savedVersion << static_cast<quint32>(definitions.size());
+    for (auto const& style : definitions)
+    {
+        stream << style.id << style.name << static_cast<int>(style.kind) << style.blockFormat << style.charFormat;
+    }
+
+    stream << static_cast<quint32>(blocks.size());
+    for (auto [number, id] : blocks)
+    {
+        stream << number << id;
+    }
+
+    stream << static_cast<quint32>(runs.size());
+    for (auto [position, length, id] : runs)
+    {
+        stream << position << length << id;
+    }
+
+    return data;
+}
+
+// Only the id property is merged back, the saved file already has everything visible
+auto DocumentStyles::restore(QTextDocument* doc, QByteArray const& data) -> bool
+{
+    QDataStream stream{data};
+
+    quint32 version{0};
+    quint32 count{0};
+    stream >> version >> count;
+
+    if (version != savedVersion)
+    {
+        return false;
+    }
+
+    auto styles = of(doc);
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        int id{0};
+        QString name;
+        int kind{0};
+        QTextBlockFormat blockFmt;
+        QTextCharFormat charFmt;
+        stream >> id >> name >> kind >> blockFmt >> charFmt;
+
+        if (stream.status() == QDataStream::Ok && id >= FirstUserId)
+        {
+            styles->define(Style{ id, name, static_cast<Kind>(kind), blockFmt, charFmt });
+        }
+    }
+
+    QTextCursor cursor{doc};
+
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        int number{0};
+        int id{0};
+        stream >> number >> id;
+
+        auto block = doc->findBlockByNumber(number);
+        if (stream.status() == QDataStream::Ok && block.isValid())
+        {
+            QTextBlockFormat fmt;
+            fmt.setProperty(StyleIdProperty, id);
+            cursor.setPosition(block.position());
+            cursor.mergeBlockFormat(fmt);
+        }
+    }
+
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        int position{0};
+        int length{0};
+        int id{0};
+        stream >> position >> length >> id;
+
+        if (stream.status() == QDataStream::Ok && position >= 0 && length > 0 && position + length < doc->characterCount())
+        {
+            QTextCharFormat fmt;
+            fmt.setProperty(StyleIdProperty, id);
+            cursor.setPosition(position);
+            cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+            cursor.mergeCharFormat(fmt);
+        }
+    }
+
+    doc->clearUndoRedoStacks();
+    return stream.status() == QDataStream::Ok;
+}
+
+auto DocumentStyles::define(Style style) -> void
+{
+    style.blockFormat.setProperty(StyleIdProperty, style.id);
+    style.charFormat.setProperty(StyleIdProperty, style.id);
+
+    m_styles.insert(style.id, std::move(style));
+    emit stylesChanged();
+}
+
+auto DocumentStyles::style(int id) const -> Style const*
+{
+    auto it = m_styles.constFind(id);
+    return it != m_styles.cend() ? &it.value() : nullptr;
+}
+
+auto DocumentStyles::styles() const -> QVector<Style>
+{
+    QVector<Style> styles;
+    styles.reserve(m_styles.size());
+
+    for (auto const& style : m_styles)
+    {
+        styles.push_back(style);
+    }
+
+    std::sort(styles.begin(), styles.end(), [](Style const& lhs, Style const& rhs)
+        {
+            return lhs.id < rhs.id;
+        }
+    );
+
+    return styles;
+}
+
+// A definition only has to reach the current session once; joining another session
+// starts over.
+auto DocumentStyles::isSynced(int id) const -> bool
+{
+    return id < FirstUserId || (m_session == DBusSession::instance() && m_synced.contains(id));
+}
+
+auto DocumentStyles::markSynced(int id) -> void
+{
+    if (m_session != DBusSession::instance())
+    {
+        m_session = DBusSession::instance();
+        m_synced.clear();
+    }
+
+    m_synced.insert(id);
+}
+
+// Absolute sizes and margins, the same on every peer whatever its default font
+auto DocumentStyles::defineBuiltIns() -> void
+{
+    auto paragraph = [&](int id, QString const& name, int level, qreal pointSize, qreal margin)
+    {
+        QTextBlockFormat blockFmt;
+        blockFmt.setHeadingLevel(level);
+        blockFmt.setTopMargin(margin);
+        blockFmt.setBottomMargin(margin / 2);
+
+        QTextCharFormat charFmt;
+        if (pointSize > 0)
+        {
+            charFmt.setFontPointSize(pointSize);
+        }
+        charFmt.setFontWeight(level > 0 ? QFont::Bold : QFont::Normal);
+
+        define(Style{ id, name, Kind::Paragraph, blockFmt, charFmt });
+    };
+
+    paragraph(Normal, tr("Normal"), 0, 0, 0);
+    paragraph(Heading1, tr("Heading 1"), 1, 24, 12);
+    paragraph(Heading2, tr("Heading 2"), 2, 18, 10);
+    paragraph(Heading3, tr("Heading 3"), 3, 14, 8);
+
+    QTextCharFormat emphasis;
+    emphasis.setFontItalic(true);
+    define(Style{ Emphasis, tr("Emphasis"), Kind::Character, QTextBlockFormat{}, emphasis });
+
+    QTextCharFormat code;
+    code.setFontFixedPitch(true);
+    code.setFontFamily("monospace");
+    define(Style{ Code, tr("Code"), Kind::Character, QTextBlockFormat{}, code });
+}
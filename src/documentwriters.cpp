@@ -0,0 +1,708 @@
+#include "documentwriters.hpp"
+#include "documentstyles.hpp"
+#include "zipwriter.hpp"
+#include "tracing.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QTextBlock>
+#include <QTextCodec>
+#include <QTextList>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+
+constexpr int chunkChars = 64 * 1024;
+
+// Collects output and passes it on as UTF-8 once a chunk is full
+struct Sink
+{
+    Sink(std::function<bool(QByteArray const&)> out)
+        : m_out{std::move(out)}
+        , m_ok{true}
+    {
+        m_buffer.reserve(chunkChars + 1024);
+    }
+
+    Sink& operator<<(QString const& text)
+    {
+        m_buffer += text;
+
+        if (m_buffer.size() >= chunkChars)
+        {
+            flush();
+        }
+
+        return *this;
+    }
+
+    auto flush() -> bool
+    {
+        if (m_ok && !m_buffer.isEmpty())
+        {
+            m_ok = m_out(m_buffer.toUtf8());
+        }
+
+        m_buffer.clear();
+        return m_ok;
+    }
+
+private:
+    std::function<bool(QByteArray const&)> m_out;
+    QString m_buffer;
+    bool m_ok;
+};
+
+auto isOrdered(QTextListFormat::Style style) -> bool
+{
+    return style <= QTextListFormat::ListDecimal;
+}
+
+auto escapeMarkdown(QString const& text, bool blockStart) -> QString
+{
+    QString result;
+    result.reserve(text.size() + 8);
+
+    for (int i = 0; i < text.size(); ++i)
+    {
+        auto chr = text[i];
+
+        if (QStringLiteral("\\`*_[]<>").contains(chr))
+        {
+            result += '\\';
+        }
+        else if (blockStart && i == 0 && QStringLiteral("#+->").contains(chr))
+        {
+            result += '\\';
+        }
+
+        result += chr;
+    }
+
+    return result;
+}
+
+// Spaces around the text stay outside of emphasis markers, which don't allow them inside
+auto wrap(QString const& text, QString const& marker) -> QString
+{
+    auto begin = 0;
+    auto end = text.size();
+
+    while (begin < end && text[begin].isSpace())
+    {
+        ++begin;
+    }
+
+    while (end > begin && text[end - 1].isSpace())
+    {
+        --end;
+    }
+
+    if (begin == end)
+    {
+        return text;
+    }
+
+    return text.left(begin) + marker + text.mid(begin, end - begin) + marker + text.mid(end);
+}
+
+auto markdownFragment(QTextFragment const& fragment, bool blockStart) -> QString
+{
+    auto fmt = fragment.charFormat();
+    auto text = fragment.text();
+
+    if (fmt.isImageFormat())
+    {
+        return QString{"![](%1)"}.arg(fmt.toImageFormat().name());
+    }
+
+    text.remove(QChar::ObjectReplacementCharacter);
+
+    if (fmt.fontFixedPitch())
+    {
+        text.replace(QChar::LineSeparator, ' ');
+
+        // The fence has to be longer than any run of backticks inside
+        auto longest = 0;
+        auto run = 0;
+        for (auto chr : text)
+        {
+            run = chr == '`' ? run + 1 : 0;
+            longest = std::max(longest, run);
+        }
+
+        QString fence(longest + 1, '`');
+        auto pad = text.startsWith('`') || text.endsWith('`') ? QStringLiteral(" ") : QString{};
+        return fence + pad + text + pad + fence;
+    }
+
+    auto result = escapeMarkdown(text, blockStart);
+    result.replace(QChar::LineSeparator, QStringLiteral("\\\n"));
+
+    if (fmt.fontStrikeOut())
+    {
+        result = wrap(result, "~~");
+    }
+
+    if (fmt.fontItalic())
+    {
+        result = wrap(result, "*");
+    }
+
+    if (fmt.fontWeight() >= QFont::Bold)
+    {
+        result = wrap(result, "**");
+    }
+
+    if (fmt.isAnchor() && !fmt.anchorHref().isEmpty())
+    {
+        result = QString{"[%1](%2)"}.arg(result, fmt.anchorHref());
+    }
+
+    return result;
+}
+
+auto escapeXml(QString const& text) -> QString
+{
+    return text.toHtmlEscaped();
+}
+
+// ODF collapses white space, so runs of spaces, tabs and line breaks are elements
+auto odfText(QString const& text) -> QString
+{
+    QString result;
+    result.reserve(text.size() + 16);
+
+    auto spaces = 0;
+    auto flushSpaces = [&]
+    {
+        if (spaces > 0)
+        {
+            result += QString{"<text:s text:c=\"%1\"/>"}.arg(spaces);
+            spaces = 0;
+        }
+    };
+
+    for (int i = 0; i < text.size(); ++i)
+    {
+        auto chr = text[i];
+
+        if (chr == ' ' && i > 0 && text[i - 1] == ' ')
+        {
+            ++spaces;
+            continue;
+        }
+
+        flushSpaces();
+
+        if (chr == '\t')
+        {
+            result += QStringLiteral("<text:tab/>");
+        }
+        else if (chr == QChar::LineSeparator)
+        {
+            result += QStringLiteral("<text:line-break/>");
+        }
+        else if (chr == '&')
+        {
+            result += QStringLiteral("&amp;");
+        }
+        else if (chr == '<')
+        {
+            result += QStringLiteral("&lt;");
+        }
+        else if (chr == '>')
+        {
+            result += QStringLiteral("&gt;");
+        }
+        else if (chr.unicode() >= 0x20 && chr != QChar::ObjectReplacementCharacter)
+        {
+            result += chr;
+        }
+    }
+
+    flushSpaces();
+    return result;
+}
+
+auto colorAttribute(char const* name, QBrush const& brush) -> QString
+{
+    return brush.style() == Qt::NoBrush ? QString{} : QString{" %1=\"%2\""}.arg(name, brush.color().name());
+}
+
+auto textProperties(QTextCharFormat const& fmt) -> QString
+{
+    QString props;
+
+    if (fmt.hasProperty(QTextFormat::FontWeight))
+    {
+        props += fmt.fontWeight() >= QFont::Bold ? " fo:font-weight=\"bold\"" : " fo:font-weight=\"normal\"";
+    }
+
+    if (fmt.hasProperty(QTextFormat::FontItalic))
+    {
+        props += fmt.fontItalic() ? " fo:font-style=\"italic\"" : " fo:font-style=\"normal\"";
+    }
+
+    if (fmt.fontUnderline())
+    {
+        props += " style:text-underline-style=\"solid\" style:text-underline-width=\"auto\" style:text-underline-color=\"font-color\"";
+    }
+
+    if (fmt.fontStrikeOut())
+    {
+        props += " style:text-line-through-style=\"solid\"";
+    }
+
+    if (fmt.fontPointSize() > 0)
+    {
+        props += QString{" fo:font-size=\"%1pt\""}.arg(fmt.fontPointSize());
+    }
+
+    if (!fmt.fontFamily().isEmpty())
+    {
+        props += QString{" fo:font-family=\"%1\""}.arg(escapeXml(fmt.fontFamily()));
+    }
+
+    if (fmt.verticalAlignment() == QTextCharFormat::AlignSuperScript)
+    {
+        props += " style:text-position=\"super 58%\"";
+    }
+    else if (fmt.verticalAlignment() == QTextCharFormat::AlignSubScript)
+    {
+        props += " style:text-position=\"sub 58%\"";
+    }
+
+    props += colorAttribute("fo:color", fmt.foreground());
+    props += colorAttribute("fo:background-color", fmt.background());
+
+    return props;
+}
+
+auto paragraphProperties(QTextBlockFormat const& fmt) -> QString
+{
+    QString props;
+
+    if (fmt.hasProperty(QTextFormat::BlockAlignment))
+    {
+        auto alignment = fmt.alignment();
+        auto value = alignment & Qt::AlignHCenter ? "center"
+            : alignment & Qt::AlignJustify ? "justify"
+            : alignment & Qt::AlignRight ? "end"
+            : "start";
+
+        props += QString{" fo:text-align=\"%1\""}.arg(value);
+    }
+
+    auto length = [&](char const* name, qreal px)
+    {
+        if (px != 0)
+        {
+            props += QString{" %1=\"%2px\""}.arg(name).arg(px);
+        }
+    };
+
+    // Qt indents by 40 pixels per level
+    length("fo:margin-left", fmt.leftMargin() + fmt.indent() * 40);
+    length("fo:margin-right", fmt.rightMargin());
+    length("fo:margin-top", fmt.topMargin());
+    length("fo:margin-bottom", fmt.bottomMargin());
+    length("fo:text-indent", fmt.textIndent());
+
+    props += colorAttribute("fo:background-color", fmt.background());
+
+    return props;
+}
+
+// Every char and block format of the document becomes an automatic style named after
+// its index, so fragments reference them without a pass over the text
+auto automaticStyles(QTextDocument const* doc) -> QString
+{
+    QString styles;
+    auto formats = doc->allFormats();
+
+    for (int i = 0; i < formats.size(); ++i)
+    {
+        auto const& fmt = formats[i];
+
+        if (fmt.isBlockFormat())
+        {
+            styles += QString{"<style:style style:name=\"P%1\" style:family=\"paragraph\"><style:paragraph-properties%2/></style:style>"}
+                .arg(i).arg(paragraphProperties(fmt.toBlockFormat()));
+        }
+        else if (fmt.isCharFormat())
+        {
+            styles += QString{"<style:style style:name=\"T%1\" style:family=\"text\"><style:text-properties%2/></style:style>"}
+                .arg(i).arg(textProperties(fmt.toCharFormat()));
+        }
+    }
+
+    return styles;
+}
+
+// One list style per QTextListFormat::Style, named after it, with every level alike
+auto listStyles() -> QString
+{
+    QString styles;
+
+    for (auto style = QTextListFormat::ListDisc; style >= QTextListFormat::ListUpperRoman; style = QTextListFormat::Style(style - 1))
+    {
+        styles += QString{"<text:list-style style:name=\"L%1\">"}.arg(-style);
+
+        for (int level = 1; level <= 10; ++level)
+        {
+            auto properties = QString{"<style:list-level-properties text:space-before=\"%1in\" text:min-label-width=\"0.25in\"/>"}
+                .arg((level - 1) * 0.25);
+
+            if (isOrdered(style))
+            {
+                auto numbering = style == QTextListFormat::ListLowerAlpha ? "a"
+                    : style == QTextListFormat::ListUpperAlpha ? "A"
+                    : style == QTextListFormat::ListLowerRoman ? "i"
+                    : style == QTextListFormat::ListUpperRoman ? "I"
+                    : "1";
+
+                styles += QString{"<text:list-level-style-number text:level=\"%1\" style:num-suffix=\".\" style:num-format=\"%2\">%3</text:list-level-style-number>"}
+                    .arg(level).arg(numbering).arg(properties);
+            }
+            else
+            {
+                auto bullet = style == QTextListFormat::ListCircle ? QChar{0x25E6}
+                    : style == QTextListFormat::ListSquare ? QChar{0x25AA}
+                    : QChar{0x2022};
+
+                styles += QString{"<text:list-level-style-bullet text:level=\"%1\" text:bullet-char=\"%2\">%3</text:list-level-style-bullet>"}
+                    .arg(level).arg(bullet).arg(properties);
+            }
+        }
+
+        styles += QStringLiteral("</text:list-style>");
+    }
+
+    return styles;
+}
+
+// Keeps text:list elements open across blocks: Qt's lists are flat, one QTextList per
+// indent level, while ODF nests a list inside an item of the list one level up
+struct OdtLists
+{
+    auto enter(QTextList* list, Sink& sink) -> void
+    {
+        auto depth = list ? std::max(1, list->format().indent()) : 0;
+
+        while (static_cast<int>(m_open.size()) > depth
+            || (depth > 0 && static_cast<int>(m_open.size()) == depth && m_open.back() != list))
+        {
+            sink << QStringLiteral("</text:list-item></text:list>");
+            m_open.pop_back();
+        }
+
+        if (depth > 0 && static_cast<int>(m_open.size()) == depth)
+        {
+            sink << QStringLiteral("</text:list-item><text:list-item>");
+            return;
+        }
+
+        while (static_cast<int>(m_open.size()) < depth)
+        {
+            auto own = static_cast<int>(m_open.size()) == depth - 1;
+            m_open.push_back(own ? list : nullptr);
+
+            sink << (own ? QString{"<text:list text:style-name=\"L%1\">"}.arg(-list->format().style()) : QStringLiteral("<text:list>"))
+                << QStringLiteral("<text:list-item>");
+        }
+    }
+
+    auto close(Sink& sink) -> void
+    {
+        enter(nullptr, sink);
+    }
+
+private:
+    std::vector<QTextList*> m_open;
+};
+
+char const* const odtMimeType = "application/vnd.oasis.opendocument.text";
+
+char const* const odtManifest =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<manifest:manifest xmlns:manifest=\"urn:oasis:names:tc:opendocument:xmlns:manifest:1.0\" manifest:version=\"1.2\">\n"
+    " <manifest:file-entry manifest:full-path=\"/\" manifest:version=\"1.2\" manifest:media-type=\"application/vnd.oasis.opendocument.text\"/>\n"
+    " <manifest:file-entry manifest:full-path=\"content.xml\" manifest:media-type=\"text/xml\"/>\n"
+    "</manifest:manifest>\n";
+
+char const* const odtContentHeader =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<office:document-content"
+    " xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\""
+    " xmlns:style=\"urn:oasis:names:tc:opendocument:xmlns:style:1.0\""
+    " xmlns:text=\"urn:oasis:names:tc:opendocument:xmlns:text:1.0\""
+    " xmlns:fo=\"urn:oasis:names:tc:opendocument:xmlns:xsl-fo-compatible:1.0\""
+    " xmlns:xlink=\"http://www.w3.org/1999/xlink\""
+    " office:version=\"1.2\">";
+
+// Qt's HTML drops the style ids, they're kept in a meta tag of their own
+auto stylesMeta() -> QRegularExpression const&
+{
+    static QRegularExpression const meta{QStringLiteral("<meta name=\"richtext-styles\" content=\"([A-Za-z0-9+/=]*)\" />")};
+    return meta;
+}
+
+auto html(QTextDocument const* doc) -> QString
+{
+    auto content = doc->toHtml();
+    auto styles = DocumentStyles::save(doc);
+
+    if (!styles.isEmpty())
+    {
+        auto head = content.indexOf(QLatin1String("<head>"));
+        if (head >= 0)
+        {
+            content.insert(head + 6, QString{"<meta name=\"richtext-styles\" content=\"%1\" />"}.arg(QString::fromLatin1(styles.toBase64())));
+        }
+    }
+
+    return content;
+}
+
+}
+
+namespace documentwriters
+{
+
+auto formatFor(QString const& path) -> Format
+{
+    auto suffix = QFileInfo{path}.suffix().toLower();
+
+    if (suffix == "md" || suffix == "markdown")
+    {
+        return Format::Markdown;
+    }
+
+    if (suffix == "odt")
+    {
+        return Format::Odt;
+    }
+
+    return Format::Html;
+}
+
+auto isLossless(Format format) -> bool
+{
+    return format == Format::Html;
+}
+
+auto save(QTextDocument const* doc, QString const& path, QString* error) -> bool
+{
+    RTE_TRACE_SCOPE("file.write");
+
+    QSaveFile file{path};
+    auto ok = file.open(QIODevice::WriteOnly);
+
+    if (ok)
+    {
+        switch (formatFor(path))
+        {
+        case Format::Markdown:
+            ok = writeMarkdown(doc, &file);
+            break;
+
+        case Format::Odt:
+            ok = writeOdt(doc, &file);
+            break;
+
+        case Format::Html:
+            ok = file.write(html(doc).toUtf8()) >= 0;
+            break;
+        }
+    }
+
+    if (!ok || !file.commit())
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+auto load(QString const& path, QTextDocument* doc, QString* error) -> bool
+{
+    RTE_TRACE_SCOPE("file.read");
+
+    auto format = formatFor(path);
+    if (format == Format::Odt)
+    {
+        if (error)
+        {
+            *error = QStringLiteral("ODT files can only be exported");
+        }
+
+        return false;
+    }
+
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+
+        return false;
+    }
+
+    auto data = file.readAll();
+
+    if (format == Format::Markdown)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        doc->setMarkdown(QString::fromUtf8(data));
+#else
+        doc->setPlainText(QString::fromUtf8(data));
+#endif
+        return true;
+    }
+
+    auto codec = QTextCodec::codecForHtml(data, QTextCodec::codecForName("UTF-8"));
+    auto content = codec->toUnicode(data);
+    doc->setHtml(content);
+
+    auto styles = stylesMeta().match(content);
+    if (styles.hasMatch())
+    {
+        DocumentStyles::restore(doc, QByteArray::fromBase64(styles.captured(1).toLatin1()));
+    }
+
+    return true;
+}
+
+// Consecutive list items stay together, everything else is separated by a blank line
+auto writeMarkdown(QTextDocument const* doc, QIODevice* device) -> bool
+{
+    RTE_TRACE_SCOPE("file.markdown");
+
+    Sink sink{[device](QByteArray const& data)
+        {
+            return device->write(data) == data.size();
+        }
+    };
+
+    auto previousInList = false;
+
+    for (auto block = doc->begin(); block.isValid(); block = block.next())
+    {
+        auto list = block.textList();
+
+        if (block != doc->begin() && !(list && previousInList))
+        {
+            sink << QStringLiteral("\n");
+        }
+
+        previousInList = list != nullptr;
+
+        QString prefix;
+        auto level = block.blockFormat().headingLevel();
+
+        if (list)
+        {
+            auto indent = std::max(0, list->format().indent() - 1);
+            auto marker = isOrdered(list->format().style())
+                ? QString::number(list->itemNumber(block) + 1) + ". "
+                : QStringLiteral("- ");
+
+            prefix = QString(indent * 4, ' ') + marker;
+        }
+        else if (level > 0)
+        {
+            prefix = QString(level, '#') + ' ';
+        }
+
+        sink << prefix;
+
+        auto blockStart = prefix.isEmpty();
+        for (auto it = block.begin(); !it.atEnd(); ++it)
+        {
+            sink << markdownFragment(it.fragment(), blockStart);
+            blockStart = false;
+        }
+
+        sink << QStringLiteral("\n");
+    }
+
+    return sink.flush();
+}
+
+auto writeOdt(QTextDocument const* doc, QIODevice* device) -> bool
+{
+    RTE_TRACE_SCOPE("file.odt");
+
+    ZipWriter zip{device};
+
+    // The mimetype must be the first entry, stored, for type detection by offset
+    if (!zip.addStored("mimetype", odtMimeType)
+        || !zip.beginEntry("META-INF/manifest.xml")
+        || !zip.write(odtManifest)
+        || !zip.endEntry()
+        || !zip.beginEntry("content.xml"))
+    {
+        return false;
+    }
+
+    Sink sink{[&zip](QByteArray const& data)
+        {
+            return zip.write(data);
+        }
+    };
+
+    sink << odtContentHeader
+        << QStringLiteral("<office:automatic-styles>") << automaticStyles(doc) << listStyles() << QStringLiteral("</office:automatic-styles>")
+        << QStringLiteral("<office:body><office:text>");
+
+    OdtLists lists;
+
+    for (auto block = doc->begin(); block.isValid(); block = block.next())
+    {
+        lists.enter(block.textList(), sink);
+
+        auto level = block.blockFormat().headingLevel();
+
+        auto element = level > 0 ? QStringLiteral("text:h") : QStringLiteral("text:p");
+        auto outline = level > 0 ? QString{" text:outline-level=\"%1\""}.arg(level) : QString{};
+
+        sink << QString{"<%1 text:style-name=\"P%2\"%3>"}.arg(element).arg(block.blockFormatIndex()).arg(outline);
+
+        for (auto it = block.begin(); !it.atEnd(); ++it)
+        {
+            auto fragment = it.fragment();
+            auto fmt = fragment.charFormat();
+            auto span = QString{"<text:span text:style-name=\"T%1\">%2</text:span>"}
+                .arg(fragment.charFormatIndex()).arg(odfText(fragment.text()));
+
+            if (fmt.isAnchor() && !fmt.anchorHref().isEmpty())
+            {
+                span = QString{"<text:a xlink:type=\"simple\" xlink:href=\"%1\">%2</text:a>"}.arg(escapeXml(fmt.anchorHref()), span);
+            }
+
+            sink << span;
+        }
+
+        sink << QString{"</%1>"}.arg(element);
+    }
+
+    lists.close(sink);
+    sink << QStringLiteral("</office:text></office:body></office:document-content>\n");
+
+    return sink.flush() && zip.endEntry() && zip.finish();
+}
+
+}
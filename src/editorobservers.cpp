@@ -2,8 +2,9 @@
 #include "tools.hpp"
 #include "dbussession.hpp"
 #include "texteditoractions.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
 
-#include <QDebug>
 #include <QKeyEvent>
 
 QChar AdditionalEmiterTextEditor::nextChar()
@@ -34,6 +35,18 @@ void AdditionalEmiterTextEditor::keyReleaseEvent(QKeyEvent* event)
 	QTextEdit::keyReleaseEvent(event);
 }
 
+void AdditionalEmiterTextEditor::paintEvent(QPaintEvent* event)
+{
+	RTE_TRACE_SCOPE("editor.paint");
+	QTextEdit::paintEvent(event);
+}
+
+void AdditionalEmiterTextEditor::resizeEvent(QResizeEvent* event)
+{
+	RTE_TRACE_SCOPE("editor.resize");
+	QTextEdit::resizeEvent(event);
+}
+
 void AdditionalEmiterTextEditor::keyPressEvent(QKeyEvent* event)
 {
 	event->accept();
@@ -53,9 +66,10 @@ void AdditionalEmiterTextEditor::keyPressEvent(QKeyEvent* event)
 	QTextEdit::keyPressEvent(event);
 }
 
-TextChangeObserver::TextChangeObserver(AdditionalEmiterTextEditor* textEditor, size_t buffSize)
+TextChangeObserver::TextChangeObserver(AdditionalEmiterTextEditor* textEditor, size_t buffSize, DBusSession* session)
 	: QObject{textEditor}
 	, m_editor{textEditor}
+	, m_session{session ? session : DBusSession::instance()}
 {
 	connect(m_editor, &AdditionalEmiterTextEditor::symAdded, this, &TextChangeObserver::onSymAdded);
     connect(m_editor, &AdditionalEmiterTextEditor::symRemoved, this, &TextChangeObserver::onSymRemoved);
@@ -63,38 +77,53 @@ TextChangeObserver::TextChangeObserver(AdditionalEmiterTextEditor* textEditor, s
 
 void TextChangeObserver::onSymAdded(QChar const& sym)
 {
-    auto dbusSession = DBusSession::instance();
     auto action = std::unique_ptr<Action>{
         new TextChangeAction_1{TextChangeType::Added, sym, m_editor }
     };
-    dbusSession->sendAction(std::move(action));
+    m_session->sendAction(std::move(action));
 }
 
 void TextChangeObserver::onSymRemoved(QChar const& sym)
 {
-    auto dbusSession = DBusSession::instance();
     auto action = std::unique_ptr<Action>{
         new TextChangeAction_1{TextChangeType::Removed, sym, m_editor}
     };
-    dbusSession->sendAction(std::move(action));
+    m_session->sendAction(std::move(action));
 }
 
-DBusActionsObserver::DBusActionsObserver(QTextEdit* textEditor, QObject* parent)
+DBusActionsObserver::DBusActionsObserver(QTextEdit* textEditor, QObject* parent, DBusSession* session)
 	: QObject{parent}
 	, m_editor{textEditor}
 {
-	connect(DBusSession::instance(), &DBusSession::actionReceived, this, &DBusActionsObserver::onDataReceived);
+	auto source = session ? session : DBusSession::instance();
+	connect(source, &DBusSession::actionReceived, this, &DBusActionsObserver::onDataReceived);
+}
+
+auto DBusActionsObserver::editor() const -> QTextEdit*
+{
+	return m_editor;
+}
+
+auto DBusActionsObserver::setEditor(QTextEdit* textEditor) -> void
+{
+	m_editor = textEditor;
 }
 
 void DBusActionsObserver::onDataReceived(ActionType type, QByteArray const& raw)
 {
-	qDebug() << FUNC_SIGN;
-    auto data = raw;
+	RTE_LOG_DEBUG("remote action received", {"type", static_cast<int>(type)}, {"bytes", raw.size()});
 
     auto builder = GlobalMementoBuilder::instance();
     if (builder->actionIsSupported(type))
     {
-        auto action = builder->deserializeAction(std::move(data), type);
+        ActionUP action;
+        {
+            RTE_TRACE_SCOPE("action.deserialize");
+            action = builder->deserializeAction(m_reader.open(raw), type);
+            m_reader.release();
+        }
+
+        RTE_TRACE_SCOPE("action.execute");
         action->execute();
     }
 }
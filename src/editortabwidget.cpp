@@ -1,44 +1,121 @@
 #include "editortabwidget.hpp"
 
 #include <QLayout>
+#include <QEvent>
 
-EditorTabWidget::EditorTabWidget(QTextEdit* textEditor, QWidget* parent)
+EditorTabWidget::EditorTabWidget(AdditionalEmiterTextEditor* textEditor, QWidget* parent)
     : QWidget{parent}
     , m_textEditor{textEditor}
+    , m_splitter{new QSplitter}
+    , m_stack{new QStackedWidget}
     , m_tabs{new QTabBar}
 {
     connect(m_tabs, &QTabBar::currentChanged, this, &EditorTabWidget::onCurrentChanged);
 
     auto layout = new QVBoxLayout{this};
     layout->addWidget(m_tabs);
-    layout->addWidget(m_textEditor);
+    layout->addWidget(m_stack);
+
+    m_stack->addWidget(m_splitter);
+
+    m_splitter->setChildrenCollapsible(false);
+    m_splitter->addWidget(m_textEditor);
+    attachView(m_textEditor);
     m_textEditor->setDisabled(true);
 }
 
-auto EditorTabWidget::addDocument(QString const& title, QTextDocument* doc, bool overwrite) -> void
+auto EditorTabWidget::addDocument(QString const& title, QTextDocument* doc, bool overwrite, bool makeCurrent) -> void
 {
-    m_textEditor->setEnabled(true);
-    auto oldDoc = m_docs.value(title);
+    for (auto view : m_views)
+    {
+        view->setEnabled(true);
+    }
 
-    if (oldDoc && overwrite)
+    // A file shown in a viewer stays there, a title is never in two tabs
+    if (m_viewers.contains(title))
     {
         delete doc;
+
+        if (makeCurrent)
+        {
+            m_tabs->setCurrentIndex(tabIndex(title));
+        }
+        return;
     }
-    else if (oldDoc)
+
+    auto oldDoc = m_docs.value(title);
+
+    if (oldDoc)
     {
+        auto index = tabIndex(title);
+
+        if (!overwrite)
+        {
+            delete doc;
+
+            if (makeCurrent)
+            {
+                m_tabs->setCurrentIndex(index);
+            }
+            return;
+        }
+
+        m_docs.insert(title, doc);
+
+        if (m_tabs->currentIndex() == index)
+        {
+            onCurrentChanged(index);
+        }
+        else
+        {
+            m_tabs->setCurrentIndex(index);
+        }
+
+        delete oldDoc;
         return;
     }
 
     m_docs.insert(title, doc);
     m_tabs->addTab(title);
-    m_textEditor->setDocument(doc);
-    m_textEditor->setDocumentTitle(title);
+
+    // The first tab becomes current by itself
+    if (!makeCurrent)
+    {
+        return;
+    }
+
+    for (auto view : m_views)
+    {
+        view->setDocument(doc);
+        view->setDocumentTitle(title);
+    }
+
     m_tabs->setCurrentIndex(m_tabs->count() - 1);
+}
 
+// Viewers live next to the editor splitter in the stack and are shown instead of it
+auto EditorTabWidget::addViewer(QString const& title, LargeFileViewer* viewer) -> void
+{
+    if (m_viewers.contains(title) || m_docs.contains(title))
+    {
+        delete viewer;
+        m_tabs->setCurrentIndex(tabIndex(title));
+        return;
+    }
+
+    m_viewers.insert(title, viewer);
+    m_stack->addWidget(viewer);
+    m_tabs->addTab(title);
+    m_tabs->setCurrentIndex(m_tabs->count() - 1);
 }
 
 auto EditorTabWidget::changeCurrentTitle(QString const& newTitle) -> void
 {
+    if (currentViewer())
+    {
+        return;
+    }
+
     auto pos = m_tabs->currentIndex();
     auto title = m_tabs->tabText(pos);
     auto doc = m_docs.value(title);
@@ -46,7 +123,11 @@ auto EditorTabWidget::changeCurrentTitle(QString const& newTitle) -> void
     m_docs.remove(title);
     m_docs.insert(newTitle, doc);
     m_tabs->setTabText(pos, newTitle);
-    m_textEditor->setDocumentTitle(newTitle);
+
+    for (auto view : m_views)
+    {
+        view->setDocumentTitle(newTitle);
+    }
 }
 
 auto EditorTabWidget::getCurrentDocument() const -> QTextDocument*
@@ -59,11 +140,140 @@ auto EditorTabWidget::getEditor() const -> QTextEdit*
     return m_textEditor;
 }
 
+auto EditorTabWidget::getViews() const -> QVector<AdditionalEmiterTextEditor*>
+{
+    return m_views;
+}
+
+auto EditorTabWidget::currentViewer() const -> LargeFileViewer*
+{
+    return m_viewers.value(m_tabs->tabText(m_tabs->currentIndex()));
+}
+
+auto EditorTabWidget::splitView(Qt::Orientation orientation) -> void
+{
+    auto view = new AdditionalEmiterTextEditor;
+    view->setDocument(m_textEditor->document());
+    view->setDocumentTitle(m_textEditor->documentTitle());
+    view->setEnabled(m_textEditor->isEnabled());
+    view->setTextCursor(m_textEditor->textCursor());
+
+    auto parent = qobject_cast<QSplitter*>(m_textEditor->parentWidget());
+    auto index = parent->indexOf(m_textEditor);
+
+    if (parent->count() > 1 && parent->orientation() != orientation)
+    {
+        auto nested = new QSplitter{orientation};
+        nested->setChildrenCollapsible(false);
+        parent->replaceWidget(index, nested);
+        nested->addWidget(m_textEditor);
+        nested->addWidget(view);
+        m_textEditor->show();
+    }
+    else
+    {
+        parent->setOrientation(orientation);
+        parent->insertWidget(index + 1, view);
+    }
+
+    attachView(view);
+    emit viewAdded(view);
+
+    view->setFocus();
+}
+
+auto EditorTabWidget::closeView() -> void
+{
+    if (m_views.size() < 2)
+    {
+        return;
+    }
+
+    auto closed = m_textEditor;
+    auto parent = qobject_cast<QSplitter*>(closed->parentWidget());
+
+    m_views.removeOne(closed);
+    closed->removeEventFilter(this);
+    closed->hide();
+    closed->setParent(nullptr);
+    closed->deleteLater();
+
+    if (parent != m_splitter && parent->count() == 1)
+    {
+        auto grandParent = qobject_cast<QSplitter*>(parent->parentWidget());
+        auto remaining = parent->widget(0);
+        grandParent->replaceWidget(grandParent->indexOf(parent), remaining);
+        remaining->show();
+        parent->deleteLater();
+    }
+
+    setActiveView(m_views.last());
+    m_textEditor->setFocus();
+
+    emit viewClosed(closed);
+}
+
+bool EditorTabWidget::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() == QEvent::FocusIn)
+    {
+        setActiveView(static_cast<AdditionalEmiterTextEditor*>(watched));
+    }
+
+    return QWidget::eventFilter(watched, event);
+}
+
 void EditorTabWidget::onCurrentChanged(int index)
 {
     auto title = m_tabs->tabText(index);
+
+    if (auto viewer = m_viewers.value(title))
+    {
+        m_stack->setCurrentWidget(viewer);
+        viewer->setFocus();
+        emit currentViewerChanged(viewer);
+        return;
+    }
+
+    m_stack->setCurrentWidget(m_splitter);
+    emit currentViewerChanged(nullptr);
     auto doc = m_docs.value(title);
 
-    m_textEditor->setDocument(doc);
-    m_textEditor->setDocumentTitle(title);
+    for (auto view : m_views)
+    {
+        view->setDocument(doc);
+        view->setDocumentTitle(title);
+    }
+
+    emit currentDocumentChanged(doc);
+}
+
+auto EditorTabWidget::tabIndex(QString const& title) const -> int
+{
+    for (int i = 0; i < m_tabs->count(); ++i)
+    {
+        if (m_tabs->tabText(i) == title)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+auto EditorTabWidget::attachView(AdditionalEmiterTextEditor* view) -> void
+{
+    m_views.append(view);
+    view->installEventFilter(this);
+}
+
+auto EditorTabWidget::setActiveView(AdditionalEmiterTextEditor* view) -> void
+{
+    if (m_textEditor == view)
+    {
+        return;
+    }
+
+    m_textEditor = view;
+    emit currentEditorChanged(view);
 }
@@ -0,0 +1,144 @@
+#include "filepreloader.hpp"
+#include "documentwriters.hpp"
+#include "largefileviewer.hpp"
+#include "tools.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QThread>
+
+FilePreloader::FilePreloader(QObject* parent)
+    : QObject{parent}
+    , m_cancelled{std::make_shared<std::atomic<bool>>(false)}
+    , m_nextSequence{0}
+    , m_nextDelivery{0}
+    , m_batch{0}
+    , m_shownBatch{-1}
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+FilePreloader::~FilePreloader()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void FilePreloader::start(QStringList const& paths)
+{
+    if (paths.isEmpty())
+    {
+        return;
+    }
+
+    auto batch = ++m_batch;
+    auto cancelled = m_cancelled;
+
+    RTE_LOG_INFO("preloading files", {"files", paths.size()}, {"threads", m_pool.maxThreadCount()});
+
+    for (auto const& path : paths)
+    {
+        auto sequence = m_nextSequence++;
+
+        tools::startTask(&m_pool, [this, cancelled, sequence, path, batch]
+            {
+                if (*cancelled)
+                {
+                    return;
+                }
+
+                auto result = load(path);
+                result.batch = batch;
+
+                QMetaObject::invokeMethod(this, [this, sequence, result]
+                    {
+                        onLoaded(sequence, result);
+                    },
+                    Qt::QueuedConnection
+                );
+            }
+        );
+    }
+}
+
+// Tasks already running still report, their documents are dropped in onLoaded
+void FilePreloader::cancel()
+{
+    *m_cancelled = true;
+    m_pool.clear();
+
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_nextDelivery = m_nextSequence;
+
+    for (auto& [sequence, result] : m_ready)
+    {
+        delete result.doc;
+    }
+    m_ready.clear();
+}
+
+// Runs on the pool. The document is created here and handed to the GUI thread
+// before it leaves, QObjects can only be pushed away from their own thread.
+auto FilePreloader::load(QString const& path) -> Result
+{
+    RTE_TRACE_SCOPE("file.preload");
+
+    Result result{ path, nullptr, {}, false, 0 };
+
+    if (QFileInfo{path}.size() >= LargeFileViewer::autoThreshold)
+    {
+        result.large = true;
+        return result;
+    }
+
+    auto doc = std::make_unique<QTextDocument>();
+    QString error;
+
+    if (!documentwriters::load(path, doc.get(), &error))
+    {
+        result.error = QString{"Can't open file{%1}. Error{%2}"}.arg(path).arg(error);
+        return result;
+    }
+
+    doc->moveToThread(QCoreApplication::instance()->thread());
+
+    result.doc = doc.release();
+    return result;
+}
+
+auto FilePreloader::onLoaded(int sequence, Result result) -> void
+{
+    if (sequence < m_nextDelivery)
+    {
+        delete result.doc;
+        return;
+    }
+
+    m_ready.emplace(sequence, std::move(result));
+
+    for (auto it = m_ready.find(m_nextDelivery); it != m_ready.end(); it = m_ready.find(m_nextDelivery))
+    {
+        auto ready = std::move(it->second);
+        m_ready.erase(it);
+        ++m_nextDelivery;
+
+        if (ready.large)
+        {
+            emit viewRequested(ready.path);
+        }
+        else if (ready.doc)
+        {
+            auto first = ready.batch != m_shownBatch;
+            m_shownBatch = ready.batch;
+
+            emit loaded(ready.path, ready.doc, first);
+        }
+        else
+        {
+            RTE_LOG_WARNING("can't preload file", {"path", ready.path}, {"error", ready.error});
+            emit failed(ready.path, ready.error);
+        }
+    }
+}
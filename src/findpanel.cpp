@@ -0,0 +1,106 @@
+#include "findpanel.hpp"
+
+#include <QGridLayout>
+#include <QKeyEvent>
+#include <QPushButton>
+#include <QSignalBlocker>
+
+FindPanel::FindPanel(TextFinder* finder, QWidget* parent)
+    : QWidget{parent}
+    , m_finder{finder}
+    , m_needle{new QLineEdit}
+    , m_replacement{new QLineEdit}
+    , m_caseSensitive{new QCheckBox{tr("Match case")}}
+    , m_regex{new QCheckBox{tr("Regular expression")}}
+    , m_status{new QLabel}
+{
+    m_needle->setPlaceholderText(tr("Find"));
+    m_needle->setClearButtonEnabled(true);
+    m_replacement->setPlaceholderText(tr("Replace with"));
+
+    auto previous = new QPushButton{tr("Previous")};
+    auto next = new QPushButton{tr("Next")};
+    auto replace = new QPushButton{tr("Replace")};
+    auto replaceAll = new QPushButton{tr("Replace all")};
+
+    auto layout = new QGridLayout{this};
+    layout->addWidget(m_needle, 0, 0);
+    layout->addWidget(previous, 0, 1);
+    layout->addWidget(next, 0, 2);
+    layout->addWidget(m_caseSensitive, 0, 3);
+    layout->addWidget(m_regex, 0, 4);
+    layout->addWidget(m_replacement, 1, 0);
+    layout->addWidget(replace, 1, 1);
+    layout->addWidget(replaceAll, 1, 2);
+    layout->addWidget(m_status, 1, 3, 1, 2);
+    layout->setColumnStretch(0, 1);
+
+    connect(m_needle, &QLineEdit::textChanged, this, &FindPanel::onNeedleChanged);
+    connect(m_caseSensitive, &QCheckBox::toggled, this, &FindPanel::onNeedleChanged);
+    connect(m_regex, &QCheckBox::toggled, this, &FindPanel::onNeedleChanged);
+    connect(m_needle, &QLineEdit::returnPressed, m_finder, &TextFinder::next);
+    connect(previous, &QPushButton::clicked, m_finder, &TextFinder::previous);
+    connect(next, &QPushButton::clicked, m_finder, &TextFinder::next);
+    connect(m_finder, &TextFinder::matchesChanged, this, &FindPanel::onMatchesChanged);
+    connect(m_finder, &TextFinder::invalidPattern, m_status, &QLabel::setText);
+
+    connect(replace, &QPushButton::clicked, this, [this]
+        {
+            m_finder->replaceCurrent(m_replacement->text());
+        }
+    );
+
+    connect(replaceAll, &QPushButton::clicked, this, [this]
+        {
+            m_finder->replaceAll(m_replacement->text());
+        }
+    );
+
+    connect(m_finder, &TextFinder::replaced, this, [this](int count)
+        {
+            m_status->setText(tr("%n replaced", "", count));
+        }
+    );
+}
+
+void FindPanel::activate(QString const& needle)
+{
+    if (!needle.isEmpty())
+    {
+        QSignalBlocker blocker{m_needle};
+        m_needle->setText(needle);
+    }
+
+    // Closing the panel stops the search, so it starts over even for the same needle
+    onNeedleChanged();
+
+    m_needle->selectAll();
+    m_needle->setFocus();
+}
+
+void FindPanel::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Escape)
+    {
+        emit closeRequested();
+        return;
+    }
+
+    QWidget::keyPressEvent(event);
+}
+
+void FindPanel::onNeedleChanged()
+{
+    m_finder->find(m_needle->text(), m_caseSensitive->isChecked(), m_regex->isChecked());
+}
+
+void FindPanel::onMatchesChanged(int count, bool finished)
+{
+    if (m_needle->text().isEmpty())
+    {
+        m_status->clear();
+        return;
+    }
+
+    m_status->setText(finished ? tr("%n match(es)", "", count) : tr("%n match(es)...", "", count));
+}
@@ -0,0 +1,112 @@
+#include "fontfamilyloader.hpp"
+#include "logging.hpp"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+FontFamilyLoader::FontFamilyLoader(QObject* parent)
+    : QObject{parent}
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &FontFamilyLoader::onFinished);
+}
+
+void FontFamilyLoader::start()
+{
+    m_watcher.setFuture(QtConcurrent::run(&FontFamilyLoader::load));
+}
+
+void FontFamilyLoader::onFinished()
+{
+    auto result = m_watcher.result();
+
+    RTE_LOG_INFO("font families loaded",
+        {"families", result.families.size()},
+        {"cached", result.fromCache},
+        {"ms", result.elapsedMs});
+
+    emit loaded(result.families);
+}
+
+auto FontFamilyLoader::load() -> Result
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto key = cacheKey();
+    auto path = cachePath();
+
+    if (key >= 0)
+    {
+        QFile cache{path};
+        if (cache.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            QTextStream stream{&cache};
+            stream.setCodec("UTF-8");
+
+            if (stream.readLine() == QString::number(key))
+            {
+                QStringList families;
+                while (!stream.atEnd())
+                {
+                    families << stream.readLine();
+                }
+
+                return Result{ families, true, timer.elapsed() };
+            }
+        }
+    }
+
+    auto families = QFontDatabase{}.families();
+
+    if (key >= 0 && QDir{}.mkpath(QFileInfo{path}.absolutePath()))
+    {
+        QSaveFile cache{path};
+        if (cache.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            QTextStream stream{&cache};
+            stream.setCodec("UTF-8");
+            stream << key << '\n';
+            for (auto const& family : families)
+            {
+                stream << family << '\n';
+            }
+            stream.flush();
+            cache.commit();
+        }
+    }
+
+    return Result{ families, false, timer.elapsed() };
+}
+
+auto FontFamilyLoader::cachePath() -> QString
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/fontfamilies.txt";
+}
+
+// fontconfig rewrites its cache directories whenever installed fonts change. Returns -1
+// where there is no fontconfig cache, which disables the disk cache.
+auto FontFamilyLoader::cacheKey() -> qint64
+{
+    auto userCache = qEnvironmentVariable("XDG_CACHE_HOME", QDir::homePath() + "/.cache") + "/fontconfig";
+
+    qint64 key = -1;
+    for (auto const& dir : { userCache, QString{"/var/cache/fontconfig"} })
+    {
+        QFileInfo info{dir};
+        if (info.isDir())
+        {
+            key = std::max(key, info.lastModified().toMSecsSinceEpoch());
+        }
+    }
+
+    return key;
+}
@@ -1,9 +1,12 @@
 #include "formatactions.hpp"
 
 #include "tools.hpp"
+#include "logging.hpp"
 
 #include <QDebug>
 
+#include <algorithm>
+
 BoldMemento::BoldMemento(QTextCursor const& cursor, bool isBold)
     : StreamItemsMemento{ cursor.selectionStart(), cursor.selectionEnd(), isBold }
 {   }
@@ -380,3 +383,201 @@ void FormatFamily::setMemento(MementoUP memento)
 
 	throwInvalidMemento(casted);
 }
+
+MergeMemento::MergeMemento(int begin, int end, QTextCharFormat const& fmt)
+    : StreamItemsMemento{begin, end, fmt}
+{	}
+
+ActionType MergeMemento::getActionType() const
+{
+	return ActionType::FormatMerge;
+}
+
+FormatMerge::FormatMerge(QTextEdit* textEditor)
+	: m_editor{textEditor}
+	, m_memento{nullptr}
+{	}
+
+FormatMerge::FormatMerge(int begin, int end, QTextCharFormat const& fmt, QTextEdit* textEditor)
+	: m_editor{textEditor}
+	, m_memento{std::make_unique<MergeMemento>(begin, end, fmt)}
+{	}
+
+void FormatMerge::execute()
+{
+    auto [begin, end, fmt] = m_memento->m_items;
+
+    auto cursor = m_editor->textCursor();
+
+    if (begin == end)
+    {
+        cursor.select(QTextCursor::WordUnderCursor);
+    }
+    else
+    {
+        cursor.setPosition(begin);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+    }
+
+    if (cursor.hasSelection())
+    {
+        cursor.mergeCharFormat(fmt);
+    }
+    else
+    {
+        m_editor->mergeCurrentCharFormat(fmt);
+    }
+}
+
+const Memento* FormatMerge::getMemento() const
+{
+	return m_memento.get();
+}
+
+void FormatMerge::setMemento(MementoUP memento)
+{
+	auto casted = tools::unique_dyn_cast<MergeMemento>(std::move(memento));
+
+	if (casted)
+	{
+		m_memento = std::move(casted);
+		return;
+	}
+
+	throwInvalidMemento(memento);
+}
+
+StyleDefineMemento::StyleDefineMemento(DocumentStyles::Style const& style)
+    : StreamItemsMemento{style.id, style.name, static_cast<int>(style.kind), style.blockFormat, style.charFormat}
+{	}
+
+ActionType StyleDefineMemento::getActionType() const
+{
+	return ActionType::StyleDefine;
+}
+
+StyleDefine::StyleDefine(QTextEdit* textEditor)
+	: m_editor{textEditor}
+	, m_memento{nullptr}
+{	}
+
+StyleDefine::StyleDefine(DocumentStyles::Style const& style, QTextEdit* textEditor)
+	: m_editor{textEditor}
+	, m_memento{std::make_unique<StyleDefineMemento>(style)}
+{	}
+
+// Whether defined here or received, every peer of the session knows the style now
+void StyleDefine::execute()
+{
+	auto const& [id, name, kind, blockFmt, charFmt] = m_memento->m_items;
+
+	auto styles = DocumentStyles::of(m_editor->document());
+	styles->define(DocumentStyles::Style{ id, name, static_cast<DocumentStyles::Kind>(kind), blockFmt, charFmt });
+	styles->markSynced(id);
+}
+
+const Memento* StyleDefine::getMemento() const
+{
+	return m_memento.get();
+}
+
+void StyleDefine::setMemento(MementoUP memento)
+{
+	auto casted = tools::unique_dyn_cast<StyleDefineMemento>(std::move(memento));
+
+	if (casted)
+	{
+		m_memento = std::move(casted);
+		return;
+	}
+
+	throwInvalidMemento(memento);
+}
+
+StyleApplyMemento::StyleApplyMemento(QTextCursor const& cursor, int styleId)
+    : StreamItemsMemento{cursor.selectionStart(), cursor.selectionEnd(), styleId}
+{	}
+
+ActionType StyleApplyMemento::getActionType() const
+{
+	return ActionType::StyleApply;
+}
+
+StyleApply::StyleApply(QTextEdit* textEditor)
+	: m_editor{textEditor}
+	, m_memento{nullptr}
+{	}
+
+StyleApply::StyleApply(int styleId, QTextEdit* textEditor)
+	: m_editor{textEditor}
+	, m_memento{std::make_unique<StyleApplyMemento>(textEditor->textCursor(), styleId)}
+{	}
+
+void StyleApply::execute()
+{
+	auto [begin, end, id] = m_memento->m_items;
+
+	auto doc = m_editor->document();
+	auto style = DocumentStyles::of(doc)->style(id);
+
+	if (!style)
+	{
+		RTE_LOG_WARNING("style applied before it was defined", {"id", id});
+		return;
+	}
+
+	auto last = std::min(end, doc->characterCount() - 1);
+	auto cursor = m_editor->textCursor();
+	cursor.beginEditBlock();
+
+	if (style->kind == DocumentStyles::Kind::Paragraph)
+	{
+		for (auto block = doc->findBlock(begin); block.isValid() && block.position() <= last; block = block.next())
+		{
+			cursor.setPosition(block.position());
+			cursor.setBlockFormat(style->blockFormat);
+			cursor.setBlockCharFormat(style->charFormat);
+			cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+			cursor.mergeCharFormat(style->charFormat);
+		}
+	}
+	else
+	{
+		cursor.setPosition(begin);
+		cursor.setPosition(last, QTextCursor::KeepAnchor);
+
+		if (begin == end)
+		{
+			cursor.select(QTextCursor::WordUnderCursor);
+		}
+
+		if (cursor.hasSelection())
+		{
+			cursor.mergeCharFormat(style->charFormat);
+		}
+		else
+		{
+			m_editor->mergeCurrentCharFormat(style->charFormat);
+		}
+	}
+
+	cursor.endEditBlock();
+}
+
+const Memento* StyleApply::getMemento() const
+{
+	return m_memento.get();
+}
+
+void StyleApply::setMemento(MementoUP memento)
+{
+	auto casted = tools::unique_dyn_cast<StyleApplyMemento>(std::move(memento));
+
+	if (casted)
+	{
+		m_memento = std::move(casted);
+		return;
+	}
+
+	throwInvalidMemento(memento);
+}
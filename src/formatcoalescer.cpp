@@ -0,0 +1,220 @@
+#include "formatcoalescer.hpp"
+#include "formatactions.hpp"
+#include "dbussession.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <climits>
+
+FormatCoalescer::FormatCoalescer(EditorTabWidget* docsEditor, int delayMs, QObject* parent)
+    : QObject{parent}
+    , m_docsEditor{docsEditor}
+    , m_begin{0}
+    , m_end{0}
+    , m_pending{false}
+    , m_updatingPreview{false}
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(delayMs);
+
+    connect(&m_timer, &QTimer::timeout, this, &FormatCoalescer::flush);
+    connect(m_docsEditor, &EditorTabWidget::currentDocumentChanged, this, &FormatCoalescer::flush);
+    connect(m_docsEditor, &EditorTabWidget::currentEditorChanged, this, &FormatCoalescer::flush);
+}
+
+FormatCoalescer::~FormatCoalescer()
+{
+    discard();
+}
+
+void FormatCoalescer::merge(QTextCharFormat const& fmt)
+{
+    auto editor = m_docsEditor->getEditor();
+    auto [begin, end] = selectionRange(editor);
+
+    if (m_pending && (editor->document() != m_document || begin != m_begin || end != m_end))
+    {
+        flush();
+    }
+
+    if (!m_pending)
+    {
+        m_pending = true;
+        m_format = QTextCharFormat{};
+        m_begin = begin;
+        m_end = end;
+        track(editor);
+    }
+
+    m_format.merge(fmt);
+    showPreview();
+    m_timer.start();
+}
+
+void FormatCoalescer::flush()
+{
+    RTE_TRACE_SCOPE("format.flush");
+
+    m_timer.stop();
+
+    if (!m_pending)
+    {
+        return;
+    }
+
+    clearPreview();
+    m_pending = false;
+
+    if (m_document)
+    {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &FormatCoalescer::onContentsChange);
+    }
+
+    // The tab was switched before the burst settled: the range belongs to a document
+    // that isn't shown any more, and actions always apply to the current one.
+    auto editor = m_docsEditor->getEditor();
+    if (!m_document || editor->document() != m_document)
+    {
+        return;
+    }
+
+    auto action = std::make_unique<FormatMerge>(m_begin, m_end, m_format, editor);
+    action->execute();
+    DBusSession::instance()->sendAction(std::move(action));
+}
+
+void FormatCoalescer::discard()
+{
+    m_timer.stop();
+    clearPreview();
+
+    if (m_pending && m_document)
+    {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &FormatCoalescer::onContentsChange);
+    }
+
+    m_pending = false;
+}
+
+void FormatCoalescer::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (m_updatingPreview || !m_pending)
+    {
+        return;
+    }
+
+    // Typing during a burst: keep the range on the same text, then apply right away
+    auto delta = charsAdded - charsRemoved;
+    if (position + charsRemoved <= m_begin)
+    {
+        m_begin += delta;
+        m_end += delta;
+    }
+    else if (position < m_end)
+    {
+        m_end = std::max(m_begin, m_end + delta);
+    }
+
+    flush();
+}
+
+auto FormatCoalescer::selectionRange(QTextEdit* editor) const -> std::pair<int, int>
+{
+    auto cursor = editor->textCursor();
+
+    if (!cursor.hasSelection())
+    {
+        cursor.select(QTextCursor::WordUnderCursor);
+    }
+
+    return { cursor.selectionStart(), cursor.selectionEnd() };
+}
+
+// Only the visible part of the range is previewed, so a wheel step over a large
+// selection costs a relayout of what's on screen and nothing else.
+auto FormatCoalescer::showPreview() -> void
+{
+    clearPreview();
+
+    if (m_begin == m_end || !m_editor)
+    {
+        return;
+    }
+
+    auto viewport = m_editor->viewport()->rect();
+    auto visibleBegin = m_editor->cursorForPosition(viewport.topLeft()).position();
+    auto visibleEnd = m_editor->cursorForPosition(viewport.bottomRight()).position();
+
+    auto begin = std::max(m_begin, visibleBegin);
+    auto end = std::min(m_end, visibleEnd + 1);
+
+    if (begin >= end)
+    {
+        return;
+    }
+
+    for (auto block = m_document->findBlock(begin); block.isValid() && block.position() < end; block = block.next())
+    {
+        auto layout = block.layout();
+        auto formats = layout->formats();
+        m_previewed.append(PreviewedBlock{ block, formats });
+
+        auto blockBegin = std::max(begin, block.position());
+        auto blockEnd = std::min(end, block.position() + block.length() - 1);
+
+        QTextLayout::FormatRange range;
+        range.start = blockBegin - block.position();
+        range.length = blockEnd - blockBegin;
+        range.format = m_format;
+
+        formats.append(range);
+        layout->setFormats(formats);
+    }
+
+    m_updatingPreview = true;
+    m_document->markContentsDirty(begin, end - begin);
+    m_updatingPreview = false;
+}
+
+auto FormatCoalescer::clearPreview() -> void
+{
+    if (m_previewed.isEmpty())
+    {
+        return;
+    }
+
+    if (m_document)
+    {
+        auto from = INT_MAX;
+        auto to = 0;
+
+        for (auto const& previewed : m_previewed)
+        {
+            if (!previewed.block.isValid())
+            {
+                continue;
+            }
+
+            previewed.block.layout()->setFormats(previewed.formats);
+            from = std::min(from, previewed.block.position());
+            to = std::max(to, previewed.block.position() + previewed.block.length());
+        }
+
+        if (from < to)
+        {
+            m_updatingPreview = true;
+            m_document->markContentsDirty(from, to - from);
+            m_updatingPreview = false;
+        }
+    }
+
+    m_previewed.clear();
+}
+
+auto FormatCoalescer::track(QTextEdit* editor) -> void
+{
+    m_editor = editor;
+    m_document = editor->document();
+
+    connect(m_document, &QTextDocument::contentsChange, this, &FormatCoalescer::onContentsChange);
+}
@@ -0,0 +1,172 @@
+#include "formatstatetracker.hpp"
+#include "tracing.hpp"
+
+#include <QSignalBlocker>
+#include <QTextBlock>
+#include <QTextDocument>
+
+FormatStateTracker::FormatStateTracker(QObject* parent)
+    : QObject{parent}
+    , m_formatIndex{-1}
+    , m_fragmentBegin{0}
+    , m_fragmentEnd{0}
+{   }
+
+void FormatStateTracker::attach(EditorTabWidget* docsEditor)
+{
+    connect(docsEditor, &EditorTabWidget::currentEditorChanged, this, &FormatStateTracker::onEditorChanged);
+    connect(docsEditor, &EditorTabWidget::currentDocumentChanged, this, [this]
+        {
+            invalidate();
+            onCursorPositionChanged();
+        }
+    );
+
+    onEditorChanged(docsEditor->getEditor());
+}
+
+void FormatStateTracker::track(Extractor extractor, Applier applier)
+{
+    m_items.push_back(Item{ std::move(extractor), std::move(applier), QVariant{} });
+    invalidate();
+}
+
+void FormatStateTracker::refresh()
+{
+    invalidate();
+    onCursorPositionChanged();
+}
+
+// QAction::setChecked only emits toggled/changed, never triggered, so this doesn't
+// create a format action
+void FormatStateTracker::trackCheckable(QAction* action, std::function<bool(QTextCharFormat const&)> extractor)
+{
+    track(
+        [extractor](QTextCharFormat const& fmt, QTextDocument const*)
+        {
+            return QVariant{ extractor(fmt) };
+        },
+        [action](QVariant const& value)
+        {
+            action->setChecked(value.toBool());
+        }
+    );
+}
+
+void FormatStateTracker::trackComboText(QComboBox* combo, Extractor extractor)
+{
+    track(std::move(extractor), [combo](QVariant const& value)
+        {
+            QSignalBlocker blocker{combo};
+            auto text = value.toString();
+            auto index = combo->findText(text);
+
+            if (index >= 0)
+            {
+                combo->setCurrentIndex(index);
+            }
+            else if (combo->isEditable())
+            {
+                combo->setEditText(text);
+            }
+        }
+    );
+}
+
+void FormatStateTracker::onEditorChanged(QTextEdit* editor)
+{
+    if (m_editor)
+    {
+        disconnect(m_editor, nullptr, this, nullptr);
+    }
+
+    m_editor = editor;
+
+    connect(m_editor, &QTextEdit::cursorPositionChanged, this, &FormatStateTracker::onCursorPositionChanged);
+    connect(m_editor, &QTextEdit::currentCharFormatChanged, this, &FormatStateTracker::onCurrentCharFormatChanged);
+    connect(m_editor, &QTextEdit::textChanged, this, &FormatStateTracker::invalidate);
+
+    invalidate();
+    onCursorPositionChanged();
+}
+
+// Resolves the fragment QTextCursor::charFormat() would read: the character before
+// the caret, or the first one of the block when the caret is at its start.
+void FormatStateTracker::onCursorPositionChanged()
+{
+    RTE_TRACE_SCOPE("format.track");
+
+    if (!m_editor)
+    {
+        return;
+    }
+
+    auto cursor = m_editor->textCursor();
+    auto block = cursor.block();
+    auto position = cursor.position();
+    auto pos = (position == block.position() && block.length() > 1) ? position : position - 1;
+
+    if (pos >= m_fragmentBegin && pos < m_fragmentEnd)
+    {
+        return;
+    }
+
+    auto index = block.charFormatIndex();
+    m_fragmentBegin = m_fragmentEnd = 0;
+
+    for (auto it = block.begin(); !it.atEnd(); ++it)
+    {
+        auto fragment = it.fragment();
+        auto begin = fragment.position();
+        auto end = begin + fragment.length();
+
+        if (pos >= begin && pos < end)
+        {
+            index = fragment.charFormatIndex();
+            m_fragmentBegin = begin;
+            m_fragmentEnd = end;
+            break;
+        }
+    }
+
+    if (index == m_formatIndex)
+    {
+        return;
+    }
+
+    m_formatIndex = index;
+    apply(cursor.charFormat());
+}
+
+// Format set at the caret without moving it, e.g. Bold toggled with nothing selected
+void FormatStateTracker::onCurrentCharFormatChanged(QTextCharFormat const& fmt)
+{
+    apply(fmt);
+}
+
+void FormatStateTracker::invalidate()
+{
+    m_formatIndex = -1;
+    m_fragmentBegin = m_fragmentEnd = 0;
+}
+
+auto FormatStateTracker::apply(QTextCharFormat const& fmt) -> void
+{
+    if (!m_editor)
+    {
+        return;
+    }
+
+    auto doc = m_editor->document();
+
+    for (auto& item : m_items)
+    {
+        auto value = item.extractor(fmt, doc);
+
+        if (value != item.value)
+        {
+            item.value = value;
+            item.applier(value);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#include "framebuffer.hpp"
+
+qint64 tools::beginBlock(QDataStream& stream)
+{
+    auto blockStart = stream.device()->pos();
+    stream << quint32{0};
+
+    return blockStart;
+}
+
+void tools::endBlock(QDataStream& stream, qint64 blockStart)
+{
+    auto device = stream.device();
+    auto blockEnd = device->pos();
+    auto length = static_cast<quint32>(blockEnd - blockStart - sizeof(quint32));
+
+    device->seek(blockStart);
+    stream << length;
+    device->seek(blockEnd);
+}
+
+FrameWriter::FrameWriter(int capacity)
+    : m_data{}
+    , m_device{}
+    , m_stream{}
+{
+    // reserve() marks the capacity as reserved, so resize(0) keeps the allocation
+    m_data.reserve(capacity);
+    m_device.setBuffer(&m_data);
+    m_device.open(QIODevice::ReadWrite);
+    m_stream.setDevice(&m_device);
+}
+
+QDataStream& FrameWriter::begin()
+{
+    m_data.resize(0);
+    m_device.seek(0);
+    m_stream.resetStatus();
+
+    return m_stream;
+}
+
+qint64 FrameWriter::beginBlock()
+{
+    return tools::beginBlock(m_stream);
+}
+
+// Before frames were streamed the payload went out as `stream << memento->toRaw()`, and
+// EmptyMemento's toRaw() is a null QByteArray, written as length 0xFFFFFFFF
+void FrameWriter::endBlock(qint64 blockStart)
+{
+    if (m_device.pos() == blockStart + static_cast<qint64>(sizeof(quint32)))
+    {
+        m_device.seek(blockStart);
+        m_stream << quint32{0xFFFFFFFF};
+        return;
+    }
+
+    tools::endBlock(m_stream, blockStart);
+}
+
+QByteArray const& FrameWriter::data() const
+{
+    return m_data;
+}
+
+FrameReader::FrameReader()
+    : m_device{}
+    , m_stream{}
+{
+    m_stream.setDevice(&m_device);
+}
+
+QDataStream& FrameReader::open(QByteArray const& data)
+{
+    m_device.close();
+    m_device.setData(data);
+    m_device.open(QIODevice::ReadOnly);
+    m_stream.resetStatus();
+
+    return m_stream;
+}
+
+void FrameReader::release()
+{
+    m_device.close();
+    m_device.setData(QByteArray{});
+}
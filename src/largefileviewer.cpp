@@ -0,0 +1,308 @@
+#include "largefileviewer.hpp"
+#include "tools.hpp"
+#include "logging.hpp"
+#include "tracing.hpp"
+
+#include <QFontDatabase>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+
+// Bytes indexed between two updates of the scroll range
+constexpr qint64 batchBytes = 64 * 1024 * 1024;
+
+// Longer lines are split into rows of at most this size, so no newline scan, when
+// indexing or painting, goes further than that
+constexpr qint64 maxLineBytes = 16 * 1024;
+
+constexpr int tabWidth = 8;
+constexpr int margin = 4;
+
+}
+
+LargeFileViewer::LargeFileViewer(QWidget* parent)
+    : QAbstractScrollArea{parent}
+    , m_data{nullptr}
+    , m_size{0}
+    , m_lineCount{0}
+    , m_indexed{false}
+    , m_maxWidth{0}
+    , m_cancelled{std::make_shared<std::atomic<bool>>(false)}
+{
+    m_pool.setMaxThreadCount(1);
+
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    viewport()->setAutoFillBackground(true);
+    viewport()->setBackgroundRole(QPalette::Base);
+}
+
+LargeFileViewer::~LargeFileViewer()
+{
+    *m_cancelled = true;
+    m_pool.waitForDone();
+}
+
+// Mapping doesn't read anything, so this returns right away whatever the size
+auto LargeFileViewer::open(QString const& path) -> bool
+{
+    RTE_TRACE_SCOPE("viewer.open");
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        RTE_LOG_WARNING("can't open file for viewing", {"path", path}, {"error", m_file.errorString()});
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+
+    if (m_size > 0 && !m_data)
+    {
+        RTE_LOG_WARNING("can't map file", {"path", path}, {"error", m_file.errorString()});
+        return false;
+    }
+
+    m_checkpoints.assign(1, 0);
+    m_lineCount = 1;
+    m_elapsed.start();
+
+    tools::startTask(&m_pool, [this]
+        {
+            index();
+        }
+    );
+
+    updateScrollBars();
+    return true;
+}
+
+auto LargeFileViewer::path() const -> QString
+{
+    return m_file.fileName();
+}
+
+auto LargeFileViewer::lineCount() const -> qint64
+{
+    return m_lineCount;
+}
+
+auto LargeFileViewer::isIndexed() const -> bool
+{
+    return m_indexed;
+}
+
+void LargeFileViewer::paintEvent(QPaintEvent* event)
+{
+    RTE_TRACE_SCOPE("viewer.paint");
+
+    QPainter painter{viewport()};
+    auto metrics = painter.fontMetrics();
+    auto lineHeight = metrics.height();
+
+    auto first = static_cast<qint64>(verticalScrollBar()->value());
+    auto last = std::min(m_lineCount, first + visibleLines() + 1);
+
+    auto gutter = gutterWidth();
+    auto x = gutter - horizontalScrollBar()->value();
+    auto y = metrics.ascent();
+
+    painter.fillRect(0, 0, gutter - margin, viewport()->height(), palette().window());
+
+    auto maxWidth = m_maxWidth;
+    auto offset = lineOffset(first);
+
+    for (auto line = first; line < last && offset >= 0 && offset <= m_size; ++line)
+    {
+        auto end = lineEnd(offset);
+
+        auto text = QString::fromUtf8(reinterpret_cast<char const*>(m_data + offset), static_cast<int>(end - offset));
+        if (text.endsWith('\r'))
+        {
+            text.chop(1);
+        }
+
+        text.replace('\t', QString(tabWidth, ' '));
+
+        painter.setClipRect(gutter, 0, viewport()->width() - gutter, viewport()->height());
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText(x, y, text);
+
+        painter.setClipping(false);
+        painter.setPen(palette().color(QPalette::PlaceholderText));
+        painter.drawText(margin, y, QString::number(line + 1));
+
+        maxWidth = std::max(maxWidth, metrics.horizontalAdvance(text));
+
+        offset = nextLine(end);
+        y += lineHeight;
+    }
+
+    if (maxWidth != m_maxWidth)
+    {
+        m_maxWidth = maxWidth;
+        updateScrollBars();
+    }
+}
+
+void LargeFileViewer::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+// Runs on the pool. Checkpoints are handed over a batch at a time, so the view can
+// scroll through what's indexed while the rest is still being read.
+auto LargeFileViewer::index() -> void
+{
+    RTE_TRACE_SCOPE("viewer.index");
+
+    auto data = reinterpret_cast<char const*>(m_data);
+    auto cancelled = m_cancelled;
+    qint64 pos = 0;
+    qint64 breaks = 0;
+
+    // At least one round, so an empty file is reported as indexed too
+    do
+    {
+        std::vector<qint64> checkpoints;
+        auto end = std::min(m_size, pos + batchBytes);
+
+        while (pos < end)
+        {
+            auto next = nextLine(lineEnd(pos));
+            if (next > m_size)
+            {
+                pos = m_size;
+                break;
+            }
+
+            pos = next;
+            ++breaks;
+
+            if (breaks % linesPerCheckpoint == 0)
+            {
+                checkpoints.push_back(pos);
+            }
+        }
+
+        auto done = pos >= m_size;
+
+        // The line after the last newline only counts when it has text
+        auto lines = breaks + ((done && m_size > 0 && data[m_size - 1] == '\n') ? 0 : 1);
+
+        QMetaObject::invokeMethod(this, [this, checkpoints = std::move(checkpoints), lines, pos, done]
+            {
+                onIndexed(checkpoints, lines, pos, done);
+            },
+            Qt::QueuedConnection
+        );
+    }
+    while (pos < m_size && !*cancelled);
+}
+
+auto LargeFileViewer::onIndexed(std::vector<qint64> const& checkpoints, qint64 lines, qint64 bytes, bool done) -> void
+{
+    m_checkpoints.insert(m_checkpoints.end(), checkpoints.begin(), checkpoints.end());
+    m_lineCount = std::max<qint64>(lines, 1);
+    m_indexed = done;
+
+    updateScrollBars();
+    viewport()->update();
+
+    emit indexingProgress(bytes, m_size);
+
+    if (done)
+    {
+        RTE_LOG_INFO("file indexed", {"path", m_file.fileName()}, {"lines", m_lineCount}, {"bytes", m_size}, {"ms", m_elapsed.elapsed()});
+        emit indexed(m_lineCount);
+    }
+}
+
+// -1 when the line isn't indexed yet
+auto LargeFileViewer::lineOffset(qint64 line) const -> qint64
+{
+    auto checkpoint = line / linesPerCheckpoint;
+    if (checkpoint >= static_cast<qint64>(m_checkpoints.size()))
+    {
+        return -1;
+    }
+
+    auto offset = m_checkpoints[checkpoint];
+
+    for (auto skip = line % linesPerCheckpoint; skip > 0 && offset <= m_size; --skip)
+    {
+        offset = nextLine(lineEnd(offset));
+    }
+
+    return offset;
+}
+
+// Offset of the newline ending the line at offset, the file size for the last one, or
+// where the row is split when there's no newline within maxLineBytes. A split doesn't
+// cut a UTF-8 sequence; the indexer and the paint both come here, so rows agree.
+auto LargeFileViewer::lineEnd(qint64 offset) const -> qint64
+{
+    if (offset >= m_size)
+    {
+        return m_size;
+    }
+
+    auto data = reinterpret_cast<char const*>(m_data);
+    auto found = static_cast<char const*>(std::memchr(data + offset, '\n', std::min(m_size - offset, maxLineBytes + 1)));
+    if (found)
+    {
+        return found - data;
+    }
+
+    auto split = offset + maxLineBytes;
+    if (split >= m_size)
+    {
+        return m_size;
+    }
+
+    for (auto back = 0; back < 3 && split > offset + 1 && (m_data[split] & 0xC0) == 0x80; ++back)
+    {
+        --split;
+    }
+
+    return split;
+}
+
+// Start of the row after the one ending at end: past the newline, or right at a split.
+// Past the file size after the last line.
+auto LargeFileViewer::nextLine(qint64 end) const -> qint64
+{
+    return end < m_size && m_data[end] != '\n' ? end : end + 1;
+}
+
+auto LargeFileViewer::gutterWidth() const -> int
+{
+    return fontMetrics().horizontalAdvance(QString::number(m_lineCount)) + 3 * margin;
+}
+
+auto LargeFileViewer::visibleLines() const -> int
+{
+    return std::max(1, viewport()->height() / fontMetrics().height());
+}
+
+// Scroll bars count lines and pixels, both clamped to int
+auto LargeFileViewer::updateScrollBars() -> void
+{
+    auto lines = static_cast<int>(std::min<qint64>(m_lineCount, INT_MAX));
+    auto page = visibleLines();
+
+    verticalScrollBar()->setRange(0, std::max(0, lines - page));
+    verticalScrollBar()->setPageStep(page);
+    verticalScrollBar()->setSingleStep(1);
+
+    horizontalScrollBar()->setRange(0, std::max(0, m_maxWidth + gutterWidth() + margin - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth() * tabWidth);
+}
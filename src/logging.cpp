@@ -0,0 +1,465 @@
+#include "logging.hpp"
+
+#include <QDateTime>
+#include <QFile>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace logging
+{
+
+namespace
+{
+
+constexpr std::size_t maxFields = 8;
+constexpr std::size_t queueCapacity = 4096;
+
+struct Record
+{
+    Level level{Level::Info};
+    std::int64_t timestampMs{0};
+    int thread{0};
+    char const* message{nullptr};
+    std::array<Field, maxFields> fields;
+    std::size_t fieldCount{0};
+};
+
+// Bounded MPSC queue (Vyukov). Producers never wait: a full queue drops the record.
+struct RecordQueue
+{
+    RecordQueue()
+    {
+        for (std::size_t i = 0; i < queueCapacity; ++i)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename Fill>
+    bool tryPush(Fill&& fill)
+    {
+        auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto& cell = m_cells[pos % queueCapacity];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    fill(cell.record);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only. The cell is cleared here so field strings are released on the
+    // writer thread rather than by the next producer.
+    bool tryPop(Record& out)
+    {
+        auto& cell = m_cells[m_dequeuePos % queueCapacity];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(m_dequeuePos + 1) < 0)
+        {
+            return false;
+        }
+
+        out = std::move(cell.record);
+        cell.record = Record{};
+        cell.sequence.store(m_dequeuePos + queueCapacity, std::memory_order_release);
+        ++m_dequeuePos;
+
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        Record record;
+    };
+
+    std::array<Cell, queueCapacity> m_cells;
+    alignas(64) std::atomic<std::size_t> m_enqueuePos{0};
+    alignas(64) std::size_t m_dequeuePos{0};
+};
+
+struct RotatingFile
+{
+    RotatingFile(QString const& path, std::int64_t maxBytes, int maxFiles)
+        : m_path{path}
+        , m_file{nullptr}
+        , m_size{0}
+        , m_maxBytes{maxBytes}
+        , m_maxFiles{maxFiles}
+    {
+        if (!m_path.isEmpty())
+        {
+            open();
+        }
+    }
+
+    ~RotatingFile()
+    {
+        if (m_file)
+        {
+            std::fclose(m_file);
+        }
+    }
+
+    RotatingFile(RotatingFile const&) = delete;
+    RotatingFile& operator=(RotatingFile const&) = delete;
+
+    void write(QByteArray const& line)
+    {
+        if (!m_file)
+        {
+            std::fwrite(line.constData(), 1, static_cast<std::size_t>(line.size()), stderr);
+            return;
+        }
+
+        if (m_size > 0 && m_size + line.size() > m_maxBytes)
+        {
+            rotate();
+        }
+
+        m_size += static_cast<std::int64_t>(std::fwrite(line.constData(), 1, static_cast<std::size_t>(line.size()), m_file));
+    }
+
+    void flush()
+    {
+        std::fflush(m_file ? m_file : stderr);
+    }
+
+private:
+    void open()
+    {
+        m_file = std::fopen(QFile::encodeName(m_path).constData(), "ab");
+        if (!m_file)
+        {
+            throw std::runtime_error{
+                QString{"Can't open log file{%1}. Error{%2}"}
+                    .arg(m_path)
+                    .arg(std::strerror(errno))
+                    .toStdString()
+            };
+        }
+
+        std::fseek(m_file, 0, SEEK_END);
+        m_size = std::ftell(m_file);
+    }
+
+    void rotate()
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+
+        for (int i = m_maxFiles - 1; i > 0; --i)
+        {
+            auto from = i == 1 ? m_path : QString{"%1.%2"}.arg(m_path).arg(i - 1);
+            auto to = QString{"%1.%2"}.arg(m_path).arg(i);
+
+            QFile::remove(to);
+            QFile::rename(from, to);
+        }
+
+        if (m_maxFiles <= 1)
+        {
+            QFile::remove(m_path);
+        }
+
+        open();
+    }
+
+    QString m_path;
+    std::FILE* m_file;
+    std::int64_t m_size;
+    std::int64_t m_maxBytes;
+    int m_maxFiles;
+};
+
+char const* levelName(Level level)
+{
+    switch (level)
+    {
+    case Level::Trace: return "TRACE";
+    case Level::Debug: return "DEBUG";
+    case Level::Info: return "INFO";
+    case Level::Warning: return "WARN";
+    case Level::Error: return "ERROR";
+    case Level::Off: break;
+    }
+
+    return "";
+}
+
+void appendValue(QByteArray& line, Value const& value)
+{
+    std::visit([&](auto const& v)
+        {
+            using T = std::decay_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<T, long long>)
+            {
+                line += QByteArray::number(v);
+            }
+            else if constexpr (std::is_same_v<T, double>)
+            {
+                line += QByteArray::number(v, 'g', 9);
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                line += v ? "true" : "false";
+            }
+            else if constexpr (std::is_same_v<T, char const*>)
+            {
+                line += '"';
+                line += v;
+                line += '"';
+            }
+            else if constexpr (std::is_same_v<T, QString>)
+            {
+                line += '"';
+                line += v.toUtf8();
+                line += '"';
+            }
+        }, value);
+}
+
+void format(QByteArray& line, Record const& record)
+{
+    line.resize(0);
+    line += QDateTime::fromMSecsSinceEpoch(record.timestampMs).toString(Qt::ISODateWithMs).toUtf8();
+    line += ' ';
+    line += levelName(record.level);
+    line += " [";
+    line += QByteArray::number(record.thread);
+    line += "] ";
+    line += record.message;
+
+    for (std::size_t i = 0; i < record.fieldCount; ++i)
+    {
+        line += ' ';
+        line += record.fields[i].key;
+        line += '=';
+        appendValue(line, record.fields[i].value);
+    }
+
+    line += '\n';
+}
+
+struct Writer
+{
+    RecordQueue queue;
+    std::atomic<long long> dropped{0};
+    std::atomic<bool> running{false};
+    std::atomic<bool> sleeping{false};
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::thread thread;
+
+    ~Writer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (!running.exchange(false, std::memory_order_acq_rel))
+        {
+            return;
+        }
+
+        wakeup.notify_one();
+        thread.join();
+    }
+
+    void run(std::unique_ptr<RotatingFile> file)
+    {
+        Record record;
+        QByteArray line;
+        line.reserve(256);
+
+        for (;;)
+        {
+            auto drained = false;
+
+            while (queue.tryPop(record))
+            {
+                format(line, record);
+                file->write(line);
+                drained = true;
+            }
+
+            if (auto lost = dropped.exchange(0, std::memory_order_relaxed))
+            {
+                line = QByteArray{"log queue overflow, records dropped: "} + QByteArray::number(lost) + '\n';
+                file->write(line);
+                drained = true;
+            }
+
+            if (drained)
+            {
+                file->flush();
+                continue;
+            }
+
+            if (!running.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            std::unique_lock lock{mutex};
+            sleeping.store(true, std::memory_order_seq_cst);
+            wakeup.wait_for(lock, std::chrono::milliseconds{50});
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+
+Writer& writer()
+{
+    static Writer instance;
+    return instance;
+}
+
+int threadNumber()
+{
+    static std::atomic<int> counter{0};
+    thread_local int number = counter.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+}
+
+Field::Field(char const* k, bool v)
+    : key{k}
+    , value{v}
+{   }
+
+Field::Field(char const* k, double v)
+    : key{k}
+    , value{v}
+{   }
+
+Field::Field(char const* k, char const* v)
+    : key{k}
+    , value{v}
+{   }
+
+Field::Field(char const* k, QString v)
+    : key{k}
+    , value{std::move(v)}
+{   }
+
+void setLevel(Level level)
+{
+    runtimeLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Level parseLevel(QString const& name)
+{
+    static std::array<std::pair<char const*, Level>, 6> const names{{
+        {"trace", Level::Trace},
+        {"debug", Level::Debug},
+        {"info", Level::Info},
+        {"warning", Level::Warning},
+        {"error", Level::Error},
+        {"off", Level::Off},
+    }};
+
+    for (auto const& [text, level] : names)
+    {
+        if (name.compare(text, Qt::CaseInsensitive) == 0)
+        {
+            return level;
+        }
+    }
+
+    throw std::invalid_argument{
+        QString{"Unknown log level{%1}. Expected trace, debug, info, warning, error or off"}
+            .arg(name)
+            .toStdString()
+    };
+}
+
+void submit(Level level, char const* message, std::initializer_list<Field> fields)
+{
+    auto& w = writer();
+    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto thread = threadNumber();
+
+    auto pushed = w.queue.tryPush([&](Record& record)
+        {
+            record.level = level;
+            record.timestampMs = timestamp;
+            record.thread = thread;
+            record.message = message;
+            record.fieldCount = std::min(fields.size(), maxFields);
+            std::copy_n(fields.begin(), record.fieldCount, record.fields.begin());
+        }
+    );
+
+    if (!pushed)
+    {
+        w.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (w.sleeping.load(std::memory_order_seq_cst))
+    {
+        w.wakeup.notify_one();
+    }
+}
+
+void start(QString const& path, std::int64_t maxBytes, int maxFiles)
+{
+    auto& w = writer();
+    if (w.running.exchange(true))
+    {
+        throw std::logic_error{"Log writer is already running"};
+    }
+
+    try
+    {
+        auto file = std::make_unique<RotatingFile>(path, maxBytes, maxFiles);
+        w.thread = std::thread{&Writer::run, &w, std::move(file)};
+    }
+    catch (...)
+    {
+        w.running.store(false);
+        throw;
+    }
+}
+
+void stop()
+{
+    writer().stop();
+}
+
+}
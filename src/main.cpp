@@ -1,53 +1,113 @@
 #include "richtexteditor.hpp"
+#include "cliapplication.hpp"
 #include "dbussession.hpp"
 #include "tools.hpp"
+#include "logging.hpp"
+#include "startupprofile.hpp"
+#include "batchconverter.hpp"
+#include "sessionlog.hpp"
 #include "config.h"
 
 #include <QApplication>
-#include <QCommandLineParser>
 #include <QDebug>
+#include <QThread>
+#include <QTimer>
 
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstring>
 #include <functional>
-#include <vector>
-#include <deque>
-#include <unordered_map>
 #include <iostream>
 
-struct CLIApplication
+namespace
 {
-    using Handler = std::function<void(std::string_view value)>;
-    using Execution = std::function<void(QCommandLineParser const& parser)>;
 
-    CLIApplication(QApplication& app);
+std::atomic<bool> stopRequested{false};
 
-    auto setApplicationName(std::string_view name) -> CLIApplication&;
-    auto setApplicationDescription(std::string_view description) -> CLIApplication&;
-    auto setApplicationVersion(std::string_view version) -> CLIApplication&;
-    auto addOption(QCommandLineOption& option, bool required, Handler hndl) -> CLIApplication&;
-    auto setupConflictedOptions(std::vector<std::reference_wrapper<QCommandLineOption>> const& conflictedOptions) -> CLIApplication&;
-    auto setupExecutionAfterProcessing(Execution exec) -> CLIApplication&;
-
-    auto process() -> void;
-
-private:
+// Joins like any peer but never sends and doesn't claim the single-instance name.
+// Runs until SIGINT or SIGTERM, or until the join fails for good.
+auto recordSession(QApplication& app, QString const& session, QString const& path) -> int
+{
+    sessionlog::Writer writer;
+    if (!writer.open(path))
+    {
+        std::cerr << "Can't open " << path.toStdString() << ": " << writer.errorString().toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    struct Option
+    auto handler = [](int)
     {
-        QCommandLineOption& option;
-        Handler handler;
-        std::vector<std::string> conflicted;
-        bool required;
+        stopRequested = true;
     };
+    std::signal(SIGINT, handler);
+    std::signal(SIGTERM, handler);
 
-    std::vector<Option> m_options;
-    QApplication& m_app;
-    QCommandLineParser m_parser;
-    Execution m_executeAfterProcessing;
-};
+    QTimer stopPoll;
+    QObject::connect(&stopPoll, &QTimer::timeout, &app, [&]
+        {
+            if (stopRequested)
+            {
+                app.quit();
+            }
+        }
+    );
+    stopPoll.start(200);
+
+    DBusSession::createSession(session, false);
+
+    auto recorder = DBusSession::instance();
+    QObject::connect(recorder, &DBusSession::frameReceived, &app, [&](QByteArray const& frame)
+        {
+            writer.append(frame);
+        }
+    );
+
+    QObject::connect(recorder, &DBusSession::joined, &app, [&]
+        {
+            RTE_LOG_INFO("recording session", {"session", session}, {"path", path});
+        }
+    );
+
+    QObject::connect(recorder, &DBusSession::joinFailed, &app, [&](QString const& error)
+        {
+            std::cerr << "Can't join session " << session.toStdString() << ": " << error.toStdString() << std::endl;
+            app.exit(EXIT_FAILURE);
+        }
+    );
+
+    auto code = app.exec();
+    writer.close();
+
+    return code;
+}
+
+}
 
 auto main(int argc, char* argv[]) -> int
 {
+    startupprofile::begin();
+
+    // Has to be decided before QApplication exists: conversion needs fonts but no screen
+    auto headless = std::any_of(argv + 1, argv + argc, [](char const* arg)
+        {
+            auto isOption = [arg](char const* name)
+            {
+                auto length = std::strlen(name);
+                return std::strncmp(arg, name, length) == 0 && (arg[length] == '\0' || arg[length] == '=');
+            };
+
+            return isOption("--convert") || isOption("--record");
+        }
+    );
+
+    if (headless)
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication app(argc, argv);
+    startupprofile::mark("application created");
 
     try
     {
@@ -69,25 +129,143 @@ auto main(int argc, char* argv[]) -> int
             QApplication::tr("disabled"),
             QApplication::tr("Disable interaction between app instances througth DBus"),
         };
+        QCommandLineOption logLevel{
+            QApplication::tr("log-level"),
+            QApplication::tr("Minimal level of log records: trace, debug, info, warning, error or off. Default is info."),
+            QApplication::tr("LEVEL")
+        };
+        QCommandLineOption logFile{
+            QApplication::tr("log-file"),
+            QApplication::tr("Write log to file instead of stderr. The file is rotated when it grows over 8 MiB."),
+            QApplication::tr("PATH")
+        };
+
+        QCommandLineOption view{
+            QApplication::tr("view"),
+            QApplication::tr("Open a large plain text file read-only, without loading it into an editable document."),
+            QApplication::tr("PATH")
+        };
+        QCommandLineOption profileStartup{
+            QApplication::tr("profile-startup"),
+            QApplication::tr("Print a timeline of the startup phases to stderr once startup is complete.")
+        };
+        QCommandLineOption newInstance{
+            QApplication::tr("new-instance"),
+            QApplication::tr("Open the files in a new window even if the session already runs one.")
+        };
+        QCommandLineOption convert{
+            QApplication::tr("convert"),
+            QApplication::tr("Convert the HTML files matching the glob without opening a window, then exit. Needs --output."),
+            QApplication::tr("INPUT_GLOB")
+        };
+        QCommandLineOption output{
+            QApplication::tr("output"),
+            QApplication::tr("Output path for --convert, '*' stands for the input's base name and the extension picks the format (html, md, odt)."),
+            QApplication::tr("PATTERN")
+        };
+        QCommandLineOption record{
+            QApplication::tr("record"),
+            QApplication::tr("Record the session's traffic into the log file given as the only file argument, without opening a window. Stops on SIGINT or SIGTERM."),
+            QApplication::tr("SESSION")
+        };
+        QCommandLineOption jobs{
+            QApplication::tr("jobs"),
+            QApplication::tr("Number of conversion threads. Default is the number of cores."),
+            QApplication::tr("N")
+        };
+
+        QString logPath;
+        QString viewPath;
+        QString sessionName{"common"};
+        bool forceNewInstance{false};
+        QString convertInput;
+        QString convertOutput;
+        int convertThreads{QThread::idealThreadCount()};
+        QString recordName;
 
-        cliApp.addOption(detached, false, [](auto value)
+        // Joining goes on in the background, started once the window is on screen
+        std::function<void()> joinSession;
+
+        cliApp.addOption(detached, false, [&](auto value)
             {
-                DBusSession::createDetached();
+                sessionName.clear();
+                joinSession = &DBusSession::createDetached;
             }
         );
 
-        cliApp.addOption(session, false, [](auto value)
+        cliApp.addOption(session, false, [&](auto value)
             {
-                DBusSession::createSession(value.data());
+                sessionName = QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+                joinSession = [name = sessionName]
+                {
+                    DBusSession::createSession(name);
+                };
             }
         );
 
-        cliApp.addOption(disabled, false, [](auto value)
+        cliApp.addOption(disabled, false, [&](auto value)
             {
+                sessionName.clear();
                 DBusSession::createDisabled();
             }
         );
 
+        cliApp.addOption(logLevel, false, [](auto value)
+            {
+                logging::setLevel(logging::parseLevel(QString::fromUtf8(value.data(), static_cast<int>(value.size()))));
+            }
+        );
+
+        cliApp.addOption(logFile, false, [&](auto value)
+            {
+                logPath = QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+            }
+        );
+
+        cliApp.addOption(view, false, [&](auto value)
+            {
+                viewPath = QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+            }
+        );
+
+        cliApp.addOption(profileStartup, false, [](auto value)
+            {
+                startupprofile::setEnabled(true);
+            }
+        );
+
+        cliApp.addOption(newInstance, false, [&](auto value)
+            {
+                forceNewInstance = true;
+            }
+        );
+
+        cliApp.addOption(convert, false, [&](auto value)
+            {
+                convertInput = QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+            }
+        );
+
+        cliApp.addOption(output, false, [&](auto value)
+            {
+                convertOutput = QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+            }
+        );
+
+        cliApp.addOption(record, false, [&](auto value)
+            {
+                recordName = QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+            }
+        );
+
+        cliApp.addOption(jobs, false, [&](auto value)
+            {
+                convertThreads = std::max(1, QString::fromUtf8(value.data(), static_cast<int>(value.size())).toInt());
+            }
+        );
+
+        cliApp.addPositionalArgument(QApplication::tr("files"), QApplication::tr("Files to open."), QApplication::tr("[files...]"));
+
         cliApp.setupConflictedOptions(
             {
                 std::ref(detached),
@@ -106,237 +284,110 @@ auto main(int argc, char* argv[]) -> int
                     }
                 }
 
-                DBusSession::createCommon();
+                joinSession = &DBusSession::createCommon;
             }
         );
 
         cliApp.process();
+        logging::start(logPath);
+        startupprofile::mark("options processed");
 
-        RichTextEditor win;
-        win.buildUi();
-        win.show();
-
-        return app.exec();
-    }
-    catch(std::exception const& excp)
-    {
-        std::cerr << excp.what() << std::endl;
-        app.exit(EXIT_FAILURE);
-    }
-}
-
-CLIApplication::CLIApplication(QApplication& app)
-    : m_app{app}
-    , m_parser{}
-{
-    m_parser.addHelpOption();
-}
-
-auto CLIApplication::setApplicationDescription(std::string_view description) -> CLIApplication&
-{
-    m_parser.setApplicationDescription(description.data());
-
-    return *this;
-}
-
-auto CLIApplication::setApplicationName(std::string_view name) -> CLIApplication&
-{
-    m_app.setApplicationName(name.data());
-
-    return *this;
-}
-
-auto CLIApplication::setApplicationVersion(std::string_view version) -> CLIApplication&
-{
-    m_app.setApplicationVersion(version.data());
-    m_parser.addVersionOption();
-
-    return *this;
-}
-
-auto CLIApplication::addOption(QCommandLineOption& option, bool required, Handler hndl) -> CLIApplication&
-{
-    auto opt = Option
-    {
-        option,
-        hndl,
-        std::vector<std::string>{},
-        required,
-    };
-
-    m_options.emplace_back(std::move(opt));
-    
-    return *this;
-}
-
-struct QCommandLineOptionHasher
-{
-    size_t operator()(std::reference_wrapper<QCommandLineOption> val) const
-    {
-        return operator()(val.get());
-    }
-
-    size_t operator()(QCommandLineOption const& val) const
-    {
-        auto hasher = std::hash<std::string>{};
-        std::size_t hsh{0};
-
-        for (auto const& name : val.names())
+        // Headless: no window and no session, whatever else was given
+        if (!convertInput.isEmpty())
         {
-            hsh ^= hasher(name.toStdString()) << 1;
-        }
-
-        return hsh;
-    }
-};
-
-struct QCommandLineOptionComparator
-{
-    bool operator()(std::reference_wrapper<QCommandLineOption> lhs, std::reference_wrapper<QCommandLineOption> rhs) const
-    {
-        return operator()(lhs.get(), rhs.get());
-    }
-
-    bool operator()(QCommandLineOption const& lhs, QCommandLineOption const& rhs) const
-    {
-        return lhs.names() == rhs.names();
-    }
-};
-
-auto CLIApplication::setupConflictedOptions(std::vector<std::reference_wrapper<QCommandLineOption>> const& conflictedOptions) -> CLIApplication&
-{
-    std::unordered_multimap<
-        std::reference_wrapper<QCommandLineOption>, std::string,
-        QCommandLineOptionHasher, QCommandLineOptionComparator>
-    conflicts;
-
-    for (auto const& opt : conflictedOptions)
-    {
-        auto pos = std::find_if(std::begin(m_options), std::end(m_options), [&](Option const& inner_opt)
+            if (convertOutput.isEmpty())
             {
-                auto comparator = QCommandLineOptionComparator{};
-                return comparator(inner_opt.option, opt.get());
+                std::cerr << "--convert needs --output" << std::endl;
+                logging::stop();
+                return EXIT_FAILURE;
             }
-        );
 
-        if (pos == std::end(m_options))
-        {
-            throw std::invalid_argument{"Option{" + opt.get().names().first().toStdString() + "} don't exist in inner options. You need add it before"};
+            auto code = batchconverter::convertAndReport(convertInput, convertOutput, convertThreads);
+            logging::stop();
+
+            return code;
         }
 
-        for(auto const& oth_opt : conflictedOptions)
+        if (!recordName.isEmpty())
         {
-            auto comparator = QCommandLineOptionComparator{};
-            if (comparator(opt, oth_opt))
+            auto logFiles = cliApp.positionalArguments();
+            if (logFiles.size() != 1)
             {
-                continue;
+                std::cerr << "--record needs exactly one log file" << std::endl;
+                logging::stop();
+                return EXIT_FAILURE;
             }
 
-            for (auto const& name : opt.get().names())
-            {
-                auto inner_name = name.toStdString();
-                conflicts.insert(std::make_pair(oth_opt, inner_name));
-            }
-        }        
-    }
+            auto code = recordSession(app, recordName, logFiles.front());
+            logging::stop();
 
-    for (auto const& val : conflicts)
-    {
-        auto opt = val.first;
-        auto name = val.second;
-
-        auto inner_opt = std::find_if(std::begin(m_options), std::end(m_options), [&](Option const& inner_opt)
-            {
-                auto comparator = QCommandLineOptionComparator{};
-                return comparator(inner_opt.option, opt.get());
-            }
-        );
-
-        inner_opt->conflicted.emplace_back(std::move(name));
-    }
+            return code;
+        }
 
-    return *this;
-}
+        // Single-instance mode: a launch with files for a session that already has a
+        // window hands them over and leaves before any window is built
+        auto files = cliApp.positionalArguments();
+        if (!files.isEmpty() && !sessionName.isEmpty() && !forceNewInstance && DBusSession::openInRunning(sessionName, files))
+        {
+            startupprofile::mark("files forwarded");
+            startupprofile::report();
+            logging::stop();
 
-auto CLIApplication::process() -> void
-{
-    std::vector<std::reference_wrapper<QCommandLineOption>> options;
-    options.reserve(m_options.size());
+            return EXIT_SUCCESS;
+        }
 
-    std::transform(std::begin(m_options), std::end(m_options), std::back_inserter(options), [](auto& option)
+        if (joinSession)
         {
-            return std::ref(option.option);
+            DBusSession::createPending();
         }
-    );
-
-    for (auto const& option : options)
-    {
-        m_parser.addOption(option.get());
-    }
-
 
-    m_parser.process(m_app);
+        RichTextEditor win;
+        win.openFiles(files);
+        win.buildUi();
+        startupprofile::mark("window built");
 
-    std::vector<std::reference_wrapper<Option>> exist_options;
+        win.show();
+        startupprofile::mark("window shown");
 
-    for (auto& inner_option: m_options)
-    {
-        if (!m_parser.isSet(inner_option.option))
+        if (!viewPath.isEmpty())
         {
-            continue;
+            win.openInViewer(viewPath);
         }
 
-        for (auto const& name : inner_option.option.names())
-        {
-            auto inner_name = name.toStdString();
-            auto pos = std::find_if(std::begin(exist_options), std::end(exist_options), [&](std::reference_wrapper<Option> option)
+        QObject::connect(DBusSession::instance(), &DBusSession::openFilesRequested, &win, &RichTextEditor::openFiles);
+
+        RTE_LOG_INFO("window shown", {"ms", startupprofile::elapsedMs()});
+
+        startupprofile::afterFirstPaint(&win, [&]
+            {
+                win.completeUi();
+                startupprofile::mark("ui completed");
+
+                if (joinSession)
                 {
-                    auto ref = option.get();
-                    auto count = std::count(std::begin(ref.conflicted), std::end(ref.conflicted), inner_name);
-                    return count > 0;
+                    try
+                    {
+                        joinSession();
+                        startupprofile::mark("session join started");
+                    }
+                    catch (std::exception const& excp)
+                    {
+                        RTE_LOG_ERROR("can't start joining session", {"error", QString::fromStdString(excp.what())});
+                    }
                 }
-            );
-            
-            if (pos != std::end(exist_options))
-            {
-                std::cerr << QString{"Conflict option{%1} with option{%2}"}
-                        .arg(name)
-                        .arg(pos->get().option.names().first())
-                        .toStdString()
-                    << std::endl;
 
-                m_parser.showHelp(EXIT_FAILURE);
+                startupprofile::report();
             }
+        );
 
-            exist_options.emplace_back(std::ref(inner_option));
-        }
-    }
+        auto code = app.exec();
+        logging::stop();
 
-    for (auto const& inner_opt : m_options)
+        return code;
+    }
+    catch(std::exception const& excp)
     {
-        if (inner_opt.required && !m_parser.isSet(inner_opt.option))
-        {
-            std::cerr << QString{"Option {%1} with value name{%2} is required"}
-                    .arg(inner_opt.option.names().first())
-                    .arg(inner_opt.option.valueName())
-                    .toStdString()
-                << std::endl;
-
-            m_parser.showHelp(EXIT_FAILURE);
-        }
-
-        if (m_parser.isSet(inner_opt.option))
-        {
-            auto fn = inner_opt.handler;
-            fn(m_parser.value(inner_opt.option).toUtf8().data());
-        }
+        std::cerr << excp.what() << std::endl;
+        app.exit(EXIT_FAILURE);
     }
-
-    m_executeAfterProcessing(m_parser);
-}
-
-auto CLIApplication::setupExecutionAfterProcessing(Execution exec) -> CLIApplication&
-{
-    m_executeAfterProcessing = exec;
-    return *this;
 }
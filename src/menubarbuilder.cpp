@@ -1,9 +1,10 @@
 #include "menubarbuilder.hpp"
 #include "tools.hpp"
 #include "dbussession.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
 
 #include <QMenuBar>
-#include <QDebug>
 
 MenuBarBuilder::MenuBarBuilder(QMainWindow* win)
     : QObject{win}
@@ -24,7 +25,15 @@ MenuBarBuilder* MenuBarBuilder::startBuild(QString const& barName, QString const
 
 void MenuBarBuilder::endBuild()
 {
-    m_win->addToolBar(m_toolBar);
+    if (m_toolBar->actions().isEmpty())
+    {
+        delete m_toolBar;
+    }
+    else
+    {
+        m_pendingToolBars.push_back(m_toolBar);
+    }
+
     m_win->menuBar()->addMenu(m_menu);
 
     m_toolBar = nullptr;
@@ -49,6 +58,12 @@ MenuBarBuilder* MenuBarBuilder::setActionIcon(QIcon&& icon)
     return this;
 }
 
+MenuBarBuilder* MenuBarBuilder::setActionIcon(QString const& path)
+{
+    m_iconPath = path;
+    return this;
+}
+
 MenuBarBuilder* MenuBarBuilder::enableSepartorToMenu()
 {
     m_enableSeparator = true;
@@ -82,10 +97,22 @@ QAction* MenuBarBuilder::createAction(QString const& name, ExecuteAction fn)
 
     QObject::connect(action, &QAction::triggered, m_win, [=]
     {
-        qDebug() << FUNC_SIGN << ": action" << name << "triggered";
-        if (auto actionObject = fn(action))
+        RTE_LOG_DEBUG("menu action triggered", {"name", name});
+        RTE_TRACE_SCOPE("action.triggered");
+
+        Action* actionObject = nullptr;
         {
-            actionObject->execute();
+            RTE_TRACE_SCOPE("action.create");
+            actionObject = fn(action);
+        }
+
+        if (actionObject)
+        {
+            {
+                RTE_TRACE_SCOPE("action.execute");
+                actionObject->execute();
+            }
+
             std::unique_ptr<Action> action{actionObject};
             DBusSession::instance()->sendAction(std::move(action));
         }
@@ -96,6 +123,11 @@ QAction* MenuBarBuilder::createAction(QString const& name, ExecuteAction fn)
         action->setIcon(m_icon);
     }
 
+    if (!m_iconPath.isEmpty())
+    {
+        m_pendingIcons.emplace_back(action, m_iconPath);
+    }
+
     if (m_enableSeparator)
     {
         m_menu->addSeparator();
@@ -116,9 +148,29 @@ QAction* MenuBarBuilder::createAction(QString const& name, ExecuteAction fn)
     return action;
 }
 
+// Icons go first, so the toolbars come up with them
+void MenuBarBuilder::completeDeferred()
+{
+    RTE_TRACE_SCOPE("ui.completeDeferred");
+
+    for (auto const& [action, path] : m_pendingIcons)
+    {
+        action->setIcon(QIcon{path});
+    }
+
+    for (auto toolBar : m_pendingToolBars)
+    {
+        m_win->addToolBar(toolBar);
+    }
+
+    m_pendingIcons.clear();
+    m_pendingToolBars.clear();
+}
+
 void MenuBarBuilder::reset()
 {
     m_icon = QIcon{};
+    m_iconPath.clear();
     m_enableSeparator = false;
     m_shortcut = QKeySequence::UnknownKey;
     m_priority = QAction::NormalPriority;
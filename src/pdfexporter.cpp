@@ -0,0 +1,303 @@
+#include "pdfexporter.hpp"
+#include "tools.hpp"
+#include "logging.hpp"
+#include "tracing.hpp"
+
+#include <QAbstractTextDocumentLayout>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPicture>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+namespace
+{
+
+// A worker per this many characters, so short documents aren't laid out several times
+constexpr int charsPerWorker = 20000;
+
+// How many pages workers may render ahead of the writer, per worker
+constexpr int pagesAhead = 2;
+
+}
+
+struct PdfExporter::Job
+{
+    QTextDocument* snapshot;
+    QString path;
+    QString title;
+    QPageLayout layout;
+    int dpi;
+    int workers;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<int, QPicture> pages;
+    int total;
+    int written;
+    int running;
+    std::atomic<bool> cancelled;
+    QElapsedTimer elapsed;
+};
+
+PdfExporter::PdfExporter(QObject* parent)
+    : QObject{parent}
+{   }
+
+PdfExporter::~PdfExporter()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+auto PdfExporter::start(QTextDocument const* doc, QString const& path, QPageLayout const& layout) -> bool
+{
+    RTE_TRACE_SCOPE("pdf.start");
+
+    if (isRunning())
+    {
+        return false;
+    }
+
+    // The only copy made on the GUI thread, the workers clone this one
+    m_snapshot.reset(doc->clone());
+
+    auto workers = std::max(1, QThread::idealThreadCount() - 1);
+    workers = std::min(workers, 1 + doc->characterCount() / charsPerWorker);
+
+    m_job = std::make_shared<Job>();
+    m_job->snapshot = m_snapshot.get();
+    m_job->path = path;
+    m_job->title = doc->metaInformation(QTextDocument::DocumentTitle);
+    m_job->layout = layout;
+    m_job->dpi = QPicture{}.logicalDpiY();
+    m_job->workers = workers;
+    m_job->total = -1;
+    m_job->written = 0;
+    m_job->running = workers;
+    m_job->cancelled = false;
+    m_job->elapsed.start();
+
+    // Every task blocks on the others at some point, so all of them need a thread
+    m_pool.setMaxThreadCount(workers + 1);
+
+    tools::startTask(&m_pool, [this, job = m_job]
+        {
+            write(job);
+        }
+    );
+
+    for (auto worker = 0; worker < workers; ++worker)
+    {
+        tools::startTask(&m_pool, [this, job = m_job, worker]
+            {
+                render(job, worker);
+            }
+        );
+    }
+
+    RTE_LOG_INFO("pdf export started", {"path", path}, {"workers", workers});
+
+    return true;
+}
+
+void PdfExporter::cancel()
+{
+    if (!m_job)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock{m_job->mutex};
+    m_job->cancelled = true;
+    m_job->changed.notify_all();
+}
+
+auto PdfExporter::isRunning() const -> bool
+{
+    return m_job != nullptr;
+}
+
+auto PdfExporter::defaultLayout() -> QPageLayout
+{
+    return QPageLayout{ QPageSize{QPageSize::A4}, QPageLayout::Portrait, QMarginsF{20, 20, 20, 20}, QPageLayout::Millimeter };
+}
+
+// Lays out its own clone and renders pages worker, worker + workers, ... of it
+auto PdfExporter::render(std::shared_ptr<Job> job, int worker) -> void
+{
+    RTE_TRACE_SCOPE("pdf.render");
+
+    std::unique_ptr<QTextDocument> doc;
+    {
+        // Cloning registers a cursor in the snapshot, so one clone at a time
+        std::lock_guard<std::mutex> lock{job->mutex};
+        if (!job->cancelled)
+        {
+            doc.reset(job->snapshot->clone());
+        }
+    }
+
+    if (doc)
+    {
+        auto pageRect = job->layout.paintRectPixels(job->dpi);
+        doc->setPageSize(pageRect.size());
+
+        auto total = doc->pageCount();
+        {
+            std::lock_guard<std::mutex> lock{job->mutex};
+            job->total = total;
+            job->changed.notify_all();
+        }
+
+        for (auto page = worker; page < total; page += job->workers)
+        {
+            {
+                std::unique_lock<std::mutex> lock{job->mutex};
+                job->changed.wait(lock, [&]
+                    {
+                        return job->cancelled || page < job->written + job->workers * pagesAhead;
+                    }
+                );
+            }
+
+            if (job->cancelled)
+            {
+                break;
+            }
+
+            QRectF clip{ 0, static_cast<qreal>(page * pageRect.height()), static_cast<qreal>(pageRect.width()), static_cast<qreal>(pageRect.height()) };
+
+            QAbstractTextDocumentLayout::PaintContext context;
+            context.clip = clip;
+            context.palette.setColor(QPalette::Text, Qt::black);
+
+            QPicture picture;
+            QPainter painter{&picture};
+            painter.translate(0, -clip.top());
+            painter.setClipRect(clip);
+            doc->documentLayout()->draw(&painter, context);
+            painter.end();
+
+            std::lock_guard<std::mutex> lock{job->mutex};
+            job->pages.emplace(page, std::move(picture));
+            job->changed.notify_all();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{job->mutex};
+    --job->running;
+    job->changed.notify_all();
+}
+
+auto PdfExporter::write(std::shared_ptr<Job> job) -> void
+{
+    RTE_TRACE_SCOPE("pdf.write");
+
+    QPdfWriter writer{job->path};
+    writer.setTitle(job->title);
+    writer.setCreator(QStringLiteral("RichTextEditor"));
+    writer.setPageLayout(job->layout);
+    writer.setResolution(job->dpi);
+
+    QString error;
+    QPainter painter;
+
+    if (!painter.begin(&writer))
+    {
+        error = tr("Can't write %1").arg(job->path);
+        std::lock_guard<std::mutex> lock{job->mutex};
+        job->cancelled = true;
+        job->changed.notify_all();
+    }
+
+    for (auto page = 0; !job->cancelled; ++page)
+    {
+        QPicture picture;
+        int total;
+        {
+            std::unique_lock<std::mutex> lock{job->mutex};
+            job->changed.wait(lock, [&]
+                {
+                    return job->cancelled || job->total == page || job->pages.count(page) > 0;
+                }
+            );
+
+            total = job->total;
+            if (job->cancelled || total == page)
+            {
+                break;
+            }
+
+            auto it = job->pages.find(page);
+            picture = std::move(it->second);
+            job->pages.erase(it);
+            job->written = page + 1;
+            job->changed.notify_all();
+        }
+
+        if (page > 0)
+        {
+            writer.newPage();
+        }
+
+        painter.drawPicture(0, 0, picture);
+
+        QMetaObject::invokeMethod(this, [this, page, total]
+            {
+                emit progress(page + 1, total);
+            },
+            Qt::QueuedConnection
+        );
+    }
+
+    if (painter.isActive())
+    {
+        painter.end();
+    }
+
+    // The snapshot goes away with the job, so the workers have to be out first
+    {
+        std::unique_lock<std::mutex> lock{job->mutex};
+        job->changed.wait(lock, [&]
+            {
+                return job->running == 0;
+            }
+        );
+    }
+
+    auto ok = !job->cancelled;
+    if (!ok)
+    {
+        QFile::remove(job->path);
+    }
+
+    QMetaObject::invokeMethod(this, [this, job, ok, error]
+        {
+            onFinished(job.get(), ok, error);
+        },
+        Qt::QueuedConnection
+    );
+}
+
+auto PdfExporter::onFinished(Job const* job, bool ok, QString const& error) -> void
+{
+    if (job != m_job.get())
+    {
+        return;
+    }
+
+    RTE_LOG_INFO("pdf export finished", {"path", job->path}, {"ok", ok}, {"pages", job->written}, {"ms", job->elapsed.elapsed()});
+
+    m_job.reset();
+    m_snapshot.reset();
+
+    emit finished(ok, error);
+}
@@ -0,0 +1,406 @@
+#include "regexsearch.hpp"
+#include "tools.hpp"
+#include "tracing.hpp"
+
+#include <QTextBlock>
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr int batchChars = 256 * 1024;
+constexpr int batchBlocks = 2048;
+constexpr int sliceChars = 4 * 1024 * 1024;
+constexpr int editDelayMs = 20;
+
+}
+
+RegexSearch::RegexSearch(QObject* parent)
+    : QObject{parent}
+    , m_scanFrom{0}
+    , m_unscanned{0}
+    , m_count{0}
+    , m_active{false}
+{
+    m_sliceTimer.setSingleShot(true);
+
+    connect(&m_sliceTimer, &QTimer::timeout, this, &RegexSearch::scheduleSlice);
+    connect(&m_tracker, &BlockChangeTracker::reset, this, &RegexSearch::onReset);
+    connect(&m_tracker, &BlockChangeTracker::blocksChanged, this, &RegexSearch::onBlocksChanged);
+}
+
+RegexSearch::~RegexSearch()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void RegexSearch::start(QTextDocument* doc, QRegularExpression const& regex)
+{
+    m_regex = regex;
+    m_active = true;
+    m_tracker.setDocument(doc);
+}
+
+void RegexSearch::stop()
+{
+    m_active = false;
+    cancel();
+    m_sliceTimer.stop();
+    m_tracker.setDocument(nullptr);
+
+    m_entries.clear();
+    m_unscanned = 0;
+    m_count = 0;
+}
+
+auto RegexSearch::count() const -> int
+{
+    return m_count;
+}
+
+auto RegexSearch::isComplete() const -> bool
+{
+    return m_unscanned == 0;
+}
+
+auto RegexSearch::matchAfter(int pos) const -> Match
+{
+    auto doc = m_tracker.document();
+    if (!doc)
+    {
+        return { -1, 0 };
+    }
+
+    for (auto block = doc->findBlock(pos); block.isValid(); block = block.next())
+    {
+        auto index = block.blockNumber();
+        if (index >= m_entries.size())
+        {
+            break;
+        }
+
+        for (auto [offset, length] : m_entries[index].result)
+        {
+            if (block.position() + offset >= pos)
+            {
+                return { block.position() + offset, length };
+            }
+        }
+    }
+
+    return { -1, 0 };
+}
+
+auto RegexSearch::matchBefore(int pos) const -> Match
+{
+    auto doc = m_tracker.document();
+    if (!doc)
+    {
+        return { -1, 0 };
+    }
+
+    auto block = doc->findBlock(pos);
+    if (!block.isValid())
+    {
+        block = doc->lastBlock();
+    }
+
+    for (; block.isValid(); block = block.previous())
+    {
+        auto index = block.blockNumber();
+        if (index >= m_entries.size())
+        {
+            continue;
+        }
+
+        auto const& matches = m_entries[index].result;
+        for (auto it = matches.rbegin(); it != matches.rend(); ++it)
+        {
+            if (block.position() + it->first < pos)
+            {
+                return { block.position() + it->first, it->second };
+            }
+        }
+    }
+
+    return { -1, 0 };
+}
+
+auto RegexSearch::matchesIn(int begin, int end) const -> std::vector<Match>
+{
+    std::vector<Match> result;
+
+    auto doc = m_tracker.document();
+    if (!doc)
+    {
+        return result;
+    }
+
+    for (auto block = doc->findBlock(begin); block.isValid() && block.position() <= end; block = block.next())
+    {
+        auto index = block.blockNumber();
+        if (index >= m_entries.size())
+        {
+            break;
+        }
+
+        for (auto [offset, length] : m_entries[index].result)
+        {
+            auto pos = block.position() + offset;
+            if (pos + length >= begin && pos <= end)
+            {
+                result.emplace_back(pos, length);
+            }
+        }
+    }
+
+    return result;
+}
+
+auto RegexSearch::replacements(QString const& replacement) const -> std::vector<std::tuple<int, int, QString>>
+{
+    RTE_TRACE_SCOPE("regex.replacements");
+
+    std::vector<std::tuple<int, int, QString>> result;
+
+    auto doc = m_tracker.document();
+    if (!doc)
+    {
+        return result;
+    }
+
+    auto index = 0;
+    for (auto block = doc->begin(); block.isValid() && index < m_entries.size(); block = block.next(), ++index)
+    {
+        auto const& matches = m_entries[index].result;
+
+        if (matches.empty())
+        {
+            continue;
+        }
+
+        auto text = block.text();
+        for (auto [offset, length] : matches)
+        {
+            auto match = m_regex.match(text, offset, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+            if (match.hasMatch())
+            {
+                result.emplace_back(block.position() + offset, length, expand(match, replacement));
+            }
+        }
+    }
+
+    return result;
+}
+
+auto RegexSearch::expand(QRegularExpressionMatch const& match, QString const& replacement) -> QString
+{
+    QString result;
+    result.reserve(replacement.size());
+
+    for (int i = 0; i < replacement.size(); ++i)
+    {
+        auto chr = replacement[i];
+
+        if (chr == '\\' && i + 1 < replacement.size())
+        {
+            auto next = replacement[i + 1];
+
+            if (next.isDigit())
+            {
+                result += match.captured(next.digitValue());
+                ++i;
+                continue;
+            }
+
+            if (next == '\\')
+            {
+                result += next;
+                ++i;
+                continue;
+            }
+        }
+
+        result += chr;
+    }
+
+    return result;
+}
+
+void RegexSearch::onReset(int blockCount)
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    cancel();
+    m_entries.reset(blockCount);
+
+    m_unscanned = blockCount;
+    m_count = 0;
+
+    emit matchesChanged(m_count, isComplete());
+    m_sliceTimer.start(0);
+}
+
+void RegexSearch::onBlocksChanged(int first, int removed, int added)
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    for (auto i = first; i < first + removed; ++i)
+    {
+        m_count -= static_cast<int>(m_entries[i].result.size());
+        m_unscanned -= m_entries[i].done ? 0 : 1;
+    }
+
+    if (m_entries.replace(first, removed, added))
+    {
+        cancel();
+    }
+
+    m_unscanned += added;
+    m_scanFrom = std::min(m_scanFrom, first);
+
+    emit matchesChanged(m_count, isComplete());
+    m_sliceTimer.start(editDelayMs);
+}
+
+// Snapshots unscanned blocks into batches for the pool until the slice budget is
+// spent, then yields to the event loop and continues with the next slice
+void RegexSearch::scheduleSlice()
+{
+    RTE_TRACE_SCOPE("regex.slice");
+
+    auto doc = m_tracker.document();
+    if (!m_active || !doc)
+    {
+        return;
+    }
+
+    std::vector<std::tuple<int, quint64, QString>> batch;
+    auto batchSize = 0;
+    auto sliceSize = 0;
+
+    auto submit = [&]
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+
+        tools::startTask(&m_pool, [this, batch, regex = m_regex, token = m_generation.token()]
+            {
+                std::vector<Scanned> results;
+                results.reserve(batch.size());
+
+                for (auto const& [block, stamp, text] : batch)
+                {
+                    if (token.isCancelled())
+                    {
+                        return;
+                    }
+
+                    results.push_back(Scanned{ block, stamp, scan(regex, text) });
+                }
+
+                QMetaObject::invokeMethod(this, [=, generation = token.generation]
+                    {
+                        accept(generation, results);
+                    },
+                    Qt::QueuedConnection
+                );
+            }
+        );
+
+        batch.clear();
+        batchSize = 0;
+    };
+
+    auto index = m_scanFrom;
+    auto block = doc->findBlockByNumber(index);
+
+    for (; block.isValid() && index < m_entries.size(); block = block.next(), ++index)
+    {
+        auto& entry = m_entries[index];
+        if (entry.done || entry.queued)
+        {
+            continue;
+        }
+
+        if (sliceSize >= sliceChars)
+        {
+            break;
+        }
+
+        auto text = block.text();
+        batchSize += text.size();
+        sliceSize += text.size();
+
+        entry.queued = true;
+        batch.emplace_back(index, entry.stamp, std::move(text));
+
+        if (batchSize >= batchChars || static_cast<int>(batch.size()) >= batchBlocks)
+        {
+            submit();
+        }
+    }
+
+    submit();
+    m_scanFrom = index;
+
+    if (block.isValid() && index < m_entries.size())
+    {
+        m_sliceTimer.start(0);
+    }
+}
+
+auto RegexSearch::scan(QRegularExpression const& regex, QString const& text) -> std::vector<std::pair<int, int>>
+{
+    std::vector<std::pair<int, int>> matches;
+
+    auto it = regex.globalMatch(text);
+    while (it.hasNext())
+    {
+        auto match = it.next();
+        if (match.capturedLength() > 0)
+        {
+            matches.emplace_back(match.capturedStart(), match.capturedLength());
+        }
+    }
+
+    return matches;
+}
+
+// In-flight batches are dropped; their blocks are still unscanned and get queued again
+auto RegexSearch::cancel() -> void
+{
+    m_generation.cancel(m_pool);
+    m_entries.unqueue();
+    m_scanFrom = 0;
+}
+
+auto RegexSearch::accept(quint64 generation, std::vector<Scanned> const& results) -> void
+{
+    if (!m_generation.isCurrent(generation))
+    {
+        return;
+    }
+
+    for (auto const& result : results)
+    {
+        if (auto entry = m_entries.take(result.block, result.stamp))
+        {
+            entry->result = result.matches;
+            m_count += static_cast<int>(entry->result.size());
+            --m_unscanned;
+        }
+    }
+
+    emit matchesChanged(m_count, isComplete());
+}
@@ -3,15 +3,25 @@
 #include "dbussession.hpp"
 #include "formatactions.hpp"
 #include "texteditoractions.hpp"
+#include "fontfamilyloader.hpp"
+#include "formatstatetracker.hpp"
+#include "findpanel.hpp"
 
 #include <QComboBox>
-#include <QFontComboBox>
+#include <QDockWidget>
 #include <QFontDatabase>
 #include <QDebug>
 #include <QColorDialog>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QInputDialog>
+#include <QLocale>
+#include <QProgressDialog>
 #include <QApplication>
+#include <QSignalBlocker>
+#include <QStatusBar>
+#include <QtConcurrent>
 
 #include <algorithm>
 #include <iterator>
@@ -20,6 +30,19 @@ RichTextEditor::RichTextEditor(QMainWindow* parent)
     : m_docsEditor{nullptr}
     , m_builder{new MenuBarBuilder{this}}
     , m_textObserver{nullptr}
+    , m_actionsObserver{nullptr}
+    , m_formatCoalescer{nullptr}
+    , m_formatTracker{new FormatStateTracker{this}}
+    , m_styleSelector{nullptr}
+    , m_textFinder{nullptr}
+    , m_findPanel{nullptr}
+    , m_findDock{nullptr}
+    , m_statistics{new DocumentStatistics{this}}
+    , m_statisticsLabel{nullptr}
+    , m_spellChecker{nullptr}
+    , m_pdfExporter{new PdfExporter{this}}
+    , m_preloader{new FilePreloader{this}}
+    , m_fontToolBar{nullptr}
 {   }
 
 void RichTextEditor::buildUi()
@@ -27,11 +50,41 @@ void RichTextEditor::buildUi()
     setupFileActions();
     setupEditActions();
     setupFormatActions();
-    setupFontSelectorToolBar();
+    setupViewActions();
 
     buildEditorAndObjects();
 }
 
+// Everything the first frame can do without: toolbars, icons and the font list
+void RichTextEditor::completeUi()
+{
+    m_builder->completeDeferred();
+    setupFontSelectorToolBar();
+
+    refreshStyles();
+    m_formatTracker->refresh();
+    onViewerChanged(m_docsEditor->currentViewer());
+}
+
+void RichTextEditor::openInViewer(QString const& path)
+{
+    try
+    {
+        ::openInViewer(path, m_docsEditor);
+    }
+    catch (std::exception const& excp)
+    {
+        statusBar()->showMessage(QString::fromStdString(excp.what()), 5000);
+    }
+}
+
+// Safe before buildUi: files are read on the preloader's pool and only added from
+// the event loop, so startup reads them while the window is being built
+void RichTextEditor::openFiles(QStringList const& paths)
+{
+    m_preloader->start(paths);
+}
+
 void RichTextEditor::setupFileActions()
 {
     m_builder->startBuild(tr("File actions"), tr("File"));
@@ -42,7 +95,7 @@ void RichTextEditor::setupFileActions()
     };
 
     auto newAction = m_builder->setActionShortcut(QKeySequence::New)
-        ->setActionIcon(QIcon{":/icons/filenew.png"})
+        ->setActionIcon(":/icons/filenew.png")
         ->createAction(tr("&New"), newFn);
 
     auto openFn = [&](QAction* action)
@@ -52,7 +105,7 @@ void RichTextEditor::setupFileActions()
     };
 
     auto openAction = m_builder->setActionShortcut(QKeySequence::Open)
-        ->setActionIcon(QIcon{":/icons/fileopen.png"})
+        ->setActionIcon(":/icons/fileopen.png")
         ->createAction(tr("&Open"), openFn);
 
     auto saveFn = [&](QAction* action)
@@ -64,13 +117,22 @@ void RichTextEditor::setupFileActions()
     };
 
     auto saveAction = m_builder->setActionShortcut(QKeySequence::Save)
-        ->setActionIcon(QIcon{":/icons/filesave.png"})
+        ->setActionIcon(":/icons/filesave.png")
         ->enableSepartorToMenu()
         ->createAction(tr("&Save"), saveFn);
 
+    // The extension picks the format, the selected filter supplies a missing one
     auto saveAsFn = [&](QAction* action)
     {
-        auto path = QFileDialog::getSaveFileName(this);
+        QString filter;
+        auto path = QFileDialog::getSaveFileName(this, tr("Save as"), {},
+            tr("HTML (*.html *.htm);;Markdown (*.md);;OpenDocument text (*.odt)"), &filter);
+
+        if (!path.isEmpty() && QFileInfo{path}.suffix().isEmpty())
+        {
+            path += filter.contains("*.md") ? ".md" : filter.contains("*.odt") ? ".odt" : ".html";
+        }
+
         return path.isEmpty() ? nullptr : new FileSaveAsAction{path, m_docsEditor};
     };
 
@@ -78,6 +140,20 @@ void RichTextEditor::setupFileActions()
         ->disableForToolBar()
         ->createAction(tr("Save as"), saveAsFn);
 
+    auto exportPdfFn = [&](QAction* action) -> Action*
+    {
+        auto path = QFileDialog::getSaveFileName(this, tr("Export PDF"), {}, tr("PDF files (*.pdf)"));
+        if (!path.isEmpty())
+        {
+            exportPdf(path);
+        }
+
+        return nullptr;
+    };
+
+    auto exportPdfAction = m_builder->disableForToolBar()
+        ->createAction(tr("Export &PDF..."), exportPdfFn);
+
     auto quitFn = [&](QAction* action)
     {
         QApplication::exit(EXIT_SUCCESS);
@@ -89,6 +165,8 @@ void RichTextEditor::setupFileActions()
         ->enableSepartorToMenu()
         ->createAction(tr("Quit"), quitFn);
 
+    m_documentActions << saveAction << saveAsAction << exportPdfAction;
+
     m_builder->endBuild();
 }
 
@@ -102,7 +180,7 @@ void RichTextEditor::setupEditActions()
     };
 
     auto undoAction = m_builder->setActionShortcut(QKeySequence::Undo)
-        ->setActionIcon(QIcon{":/icons/editundo.png"})
+        ->setActionIcon(":/icons/editundo.png")
         ->createAction(tr("&Undo"), undoFn);
 
     auto redoFn = [&](QAction* action)
@@ -111,7 +189,7 @@ void RichTextEditor::setupEditActions()
     };
 
     auto redoAction = m_builder->setActionShortcut(QKeySequence::Redo)
-        ->setActionIcon(QIcon{":/icons/editredo.png"})
+        ->setActionIcon(":/icons/editredo.png")
         ->createAction(tr("&Redo"), redoFn);
 
     auto copyFn = [&](QAction* action)
@@ -120,7 +198,7 @@ void RichTextEditor::setupEditActions()
     };
 
     auto copyAction = m_builder->setActionShortcut(QKeySequence::Copy)
-        ->setActionIcon(QIcon{":/icons/editcopy.png"})
+        ->setActionIcon(":/icons/editcopy.png")
         ->enableSepartorToMenu()
         ->createAction(tr("&Copy"), copyFn);
 
@@ -130,7 +208,7 @@ void RichTextEditor::setupEditActions()
     };
 
     auto cutAction = m_builder->setActionShortcut(QKeySequence::Cut)
-        ->setActionIcon(QIcon{":/icons/editcut.png"})
+        ->setActionIcon(":/icons/editcut.png")
         ->createAction(tr("&Cut"), cutFn);
 
     auto pasteFn = [&](QAction* action)
@@ -139,9 +217,55 @@ void RichTextEditor::setupEditActions()
     };
 
     auto pasteAction = m_builder->setActionShortcut(QKeySequence::Paste)
-        ->setActionIcon(QIcon{":/icons/editpaste.png"})
+        ->setActionIcon(":/icons/editpaste.png")
         ->createAction(tr("&Paste"), pasteFn);
 
+    auto findFn = [&](QAction* action) -> Action*
+    {
+        m_findDock->show();
+        m_findPanel->activate(m_docsEditor->getEditor()->textCursor().selectedText());
+        return nullptr;
+    };
+
+    auto findAction = m_builder->setActionShortcut(QKeySequence::Find)
+        ->enableSepartorToMenu()
+        ->disableForToolBar()
+        ->createAction(tr("&Find and replace..."), findFn);
+
+    m_documentActions << undoAction << redoAction << copyAction << cutAction << pasteAction << findAction;
+
+    // The system locale's dictionary is only loaded once checking is turned on
+    auto spellFn = [&](QAction* action) -> Action*
+    {
+        m_spellChecker->setEnabled(action->isChecked());
+
+        if (action->isChecked() && !m_spellChecker->hasDictionary())
+        {
+            auto path = SpellDictionary::find(QLocale::system().name());
+            if (path.isEmpty())
+            {
+                path = QFileDialog::getOpenFileName(this, tr("Spelling dictionary"), {}, tr("Hunspell dictionaries (*.dic)"));
+            }
+
+            loadDictionary(path);
+        }
+
+        return nullptr;
+    };
+
+    auto spellAction = m_builder->setCheckable(true)
+        ->disableForToolBar()
+        ->createAction(tr("Check &spelling"), spellFn);
+
+    auto dictionaryFn = [&](QAction* action) -> Action*
+    {
+        loadDictionary(QFileDialog::getOpenFileName(this, tr("Spelling dictionary"), {}, tr("Hunspell dictionaries (*.dic)")));
+        return nullptr;
+    };
+
+    auto dictionaryAction = m_builder->disableForToolBar()
+        ->createAction(tr("Spelling &dictionary..."), dictionaryFn);
+
     m_builder->endBuild();
 }
 
@@ -155,7 +279,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto boldAction = m_builder->setActionShortcut(QKeySequence::Bold)
-        ->setActionIcon(QIcon{":/icons/formatbold.png"})
+        ->setActionIcon(":/icons/formatbold.png")
         ->setCheckable(true)
         ->createAction(tr("&Bold"), boldFn);
 
@@ -165,7 +289,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto italicAction = m_builder->setActionShortcut(QKeySequence::Italic)
-        ->setActionIcon(QIcon{":/icons/formatitalic.png"})
+        ->setActionIcon(":/icons/formatitalic.png")
         ->setCheckable(true)
         ->createAction(tr("&Italic"), italicFn);
 
@@ -175,18 +299,22 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto underlineAction = m_builder->setActionShortcut(QKeySequence::Underline)
-        ->setActionIcon(QIcon{":/icons/formatunderline.png"})
+        ->setActionIcon(":/icons/formatunderline.png")
         ->setCheckable(true)
         ->enableSepartorToMenu()
         ->createAction(tr("&Underline"), underlineFn);
 
+    m_formatTracker->trackCheckable(boldAction, [](QTextCharFormat const& fmt) { return fmt.fontWeight() >= QFont::Bold; });
+    m_formatTracker->trackCheckable(italicAction, [](QTextCharFormat const& fmt) { return fmt.fontItalic(); });
+    m_formatTracker->trackCheckable(underlineAction, [](QTextCharFormat const& fmt) { return fmt.fontUnderline(); });
+
     auto alignLeftFn = [=](QAction* action)
     {
         return new FormatAlignLeft{ m_docsEditor->getEditor() };
     };
 
     auto aligntLeftAction = m_builder->setActionShortcut(Qt::ALT | Qt::Key_L)
-        ->setActionIcon(QIcon{":/icons/formatalignleft.png"})
+        ->setActionIcon(":/icons/formatalignleft.png")
         ->createAction(tr("Align &Left"), alignLeftFn);
 
     auto alignCenterFn = [=](QAction* action)
@@ -195,7 +323,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto alignCenterAction = m_builder->setActionShortcut(Qt::ALT | Qt::Key_C)
-        ->setActionIcon(QIcon{":/icons/formataligncenter.png"})
+        ->setActionIcon(":/icons/formataligncenter.png")
         ->createAction(tr("Align &Center"), alignCenterFn);
 
     auto alignRightFn = [=](QAction* action)
@@ -204,7 +332,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto alignRightAction = m_builder->setActionShortcut(Qt::ALT | Qt::Key_R)
-        ->setActionIcon(QIcon{":/icons/formatalignright.png"})
+        ->setActionIcon(":/icons/formatalignright.png")
         ->createAction(tr("Algin &Right"), alignRightFn);
 
     auto alignJustifyFn = [=](QAction* action)
@@ -213,7 +341,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto alignJustifyAction = m_builder->setActionShortcut(Qt::ALT | Qt::Key_J)
-        ->setActionIcon(QIcon{":/icons/formatalignjustify.png"})
+        ->setActionIcon(":/icons/formatalignjustify.png")
         ->enableSepartorToMenu()
         ->createAction(tr("Align &Justify"), alignJustifyFn);
 
@@ -223,7 +351,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto indentAction = m_builder->setActionShortcut(Qt::ALT | Qt::SHIFT | Qt::Key_I)
-        ->setActionIcon(QIcon{":/icons/formatindent.png"})
+        ->setActionIcon(":/icons/formatindent.png")
         ->createAction(tr("Indent"), indentFn);
 
     auto unindentFn = [=](QAction* action)
@@ -232,7 +360,7 @@ void RichTextEditor::setupFormatActions()
     };
 
     auto unindentAction = m_builder->setActionShortcut(Qt::ALT | Qt::SHIFT | Qt::Key_U)
-        ->setActionIcon(QIcon{":/icons/formatunindent.png"})
+        ->setActionIcon(":/icons/formatunindent.png")
         ->createAction(tr("Unindent"), unindentFn);
 
     auto colorFn = [=](QAction* qAction)
@@ -241,7 +369,7 @@ void RichTextEditor::setupFormatActions()
         return new FormatColor{ color, m_docsEditor->getEditor() };
     };
 
-    auto colorAction = m_builder->setActionIcon(QIcon{ ":/icons/formatcolor.png" })
+    auto colorAction = m_builder->setActionIcon(":/icons/formatcolor.png")
         ->createAction(tr("Change color"), colorFn);
 
     auto underlineColorFn = [=](QAction* indent)
@@ -250,18 +378,97 @@ void RichTextEditor::setupFormatActions()
         return new FormatUnderlineColor{ color, m_docsEditor->getEditor() };
     };
 
-    auto underlineColorAction = m_builder->setActionIcon(QIcon{ ":/icons/formatunderlinecolor.png" })
+    auto underlineColorAction = m_builder->setActionIcon(":/icons/formatunderlinecolor.png")
         ->createAction(tr("Change underline color"));
 
+    auto newStyle = [=](DocumentStyles::Kind kind) -> Action*
+    {
+        auto name = QInputDialog::getText(this, tr("New style"), tr("Style name:"));
+        if (name.isEmpty())
+        {
+            return nullptr;
+        }
+
+        auto editor = m_docsEditor->getEditor();
+        auto cursor = editor->textCursor();
+
+        QTextBlockFormat blockFmt;
+        if (kind == DocumentStyles::Kind::Paragraph)
+        {
+            blockFmt = cursor.blockFormat();
+            blockFmt.clearProperty(QTextFormat::ObjectIndex);
+        }
+
+        auto id = DocumentStyles::of(editor->document())->allocateId(name);
+        return new StyleDefine{ DocumentStyles::Style{ id, name, kind, blockFmt, cursor.charFormat() }, editor };
+    };
+
+    auto newParagraphStyleAction = m_builder->disableForToolBar()
+        ->createAction(tr("New paragraph style..."), [=](QAction*) { return newStyle(DocumentStyles::Kind::Paragraph); });
+
+    auto newCharacterStyleAction = m_builder->disableForToolBar()
+        ->createAction(tr("New character style..."), [=](QAction*) { return newStyle(DocumentStyles::Kind::Character); });
+
+    m_documentActions << boldAction << italicAction << underlineAction
+        << aligntLeftAction << alignCenterAction << alignRightAction << alignJustifyAction
+        << indentAction << unindentAction << colorAction << underlineColorAction
+        << newParagraphStyleAction << newCharacterStyleAction;
+
+    m_builder->endBuild();
+}
+
+void RichTextEditor::setupViewActions()
+{
+    m_builder->startBuild(tr("View actions"), tr("View"));
+
+    auto splitSideBySideFn = [=](QAction* action)
+    {
+        m_docsEditor->splitView(Qt::Horizontal);
+        return nullptr;
+    };
+
+    auto splitSideBySideAction = m_builder->setActionShortcut(Qt::CTRL | Qt::ALT | Qt::Key_Right)
+        ->disableForToolBar()
+        ->createAction(tr("Split &Left/Right"), splitSideBySideFn);
+
+    auto splitStackedFn = [=](QAction* action)
+    {
+        m_docsEditor->splitView(Qt::Vertical);
+        return nullptr;
+    };
+
+    auto splitStackedAction = m_builder->setActionShortcut(Qt::CTRL | Qt::ALT | Qt::Key_Down)
+        ->disableForToolBar()
+        ->createAction(tr("Split &Top/Bottom"), splitStackedFn);
+
+    auto closeSplitFn = [=](QAction* action)
+    {
+        m_docsEditor->closeView();
+        return nullptr;
+    };
+
+    auto closeSplitAction = m_builder->setActionShortcut(Qt::CTRL | Qt::ALT | Qt::Key_W)
+        ->disableForToolBar()
+        ->enableSepartorToMenu()
+        ->createAction(tr("&Close split"), closeSplitFn);
+
     m_builder->endBuild();
 }
 
 void RichTextEditor::setupFontSelectorToolBar()
 {
     auto fontSelectorToolBar = addToolBar(tr("Font selector"));
+    m_fontToolBar = fontSelectorToolBar;
 
     auto sizeSelector = new QComboBox;
-    auto fontSelector = new QFontComboBox;
+    auto fontSelector = new QComboBox;
+
+    // Only the current family until the full list arrives from FontFamilyLoader
+    fontSelector->setEditable(true);
+    fontSelector->setInsertPolicy(QComboBox::NoInsert);
+    fontSelector->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+    fontSelector->setMinimumContentsLength(16);
+    fontSelector->addItem(QApplication::font().family());
 
     auto sizes = QFontDatabase::standardSizes();
     QStringList sSizes;
@@ -274,30 +481,322 @@ void RichTextEditor::setupFontSelectorToolBar()
 
     connect(sizeSelector, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=] (int index)
         {
-            auto size = sizeSelector->itemText(index).toInt();
-            auto action = std::make_unique<FormatSize>(size, m_docsEditor->getEditor());
-            action->execute();
+            QTextCharFormat fmt;
+            fmt.setFontPointSize(sizeSelector->itemText(index).toInt());
+            m_formatCoalescer->merge(fmt);
         }
     );
 
-    connect(fontSelector, &QFontComboBox::currentFontChanged, this, [=](QFont const& font)
+    connect(fontSelector, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=](int index)
         {
-            auto action = std::make_unique<FormatFamily>(font.family(), m_docsEditor->getEditor());
-            action->execute();
+            QTextCharFormat fmt;
+            fmt.setFontFamily(fontSelector->itemText(index));
+            m_formatCoalescer->merge(fmt);
         }
     );
 
+    auto fontLoader = new FontFamilyLoader{this};
+    connect(fontLoader, &FontFamilyLoader::loaded, this, [=](QStringList const& families)
+        {
+            QSignalBlocker blocker{fontSelector};
+            auto current = fontSelector->currentText();
+
+            fontSelector->clear();
+            fontSelector->addItems(families);
+
+            auto index = fontSelector->findText(current);
+            if (index < 0)
+            {
+                fontSelector->insertItem(0, current);
+                index = 0;
+            }
+            fontSelector->setCurrentIndex(index);
+
+            fontLoader->deleteLater();
+        }
+    );
+    fontLoader->start();
+
+    m_formatTracker->trackComboText(sizeSelector, [](QTextCharFormat const& fmt, QTextDocument const* doc)
+        {
+            auto size = fmt.hasProperty(QTextFormat::FontPointSize) ? fmt.fontPointSize() : doc->defaultFont().pointSizeF();
+            return QVariant{ QString::number(size) };
+        }
+    );
+
+    m_formatTracker->trackComboText(fontSelector, [](QTextCharFormat const& fmt, QTextDocument const* doc)
+        {
+            auto family = fmt.hasProperty(QTextFormat::FontFamily) ? fmt.fontFamily() : doc->defaultFont().family();
+            return QVariant{ family };
+        }
+    );
+
+    m_styleSelector = new QComboBox;
+    m_styleSelector->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+
+    connect(m_styleSelector, QOverload<int>::of(&QComboBox::activated), this, [=](int index)
+        {
+            applyStyle(m_styleSelector->itemData(index).toInt());
+        }
+    );
+
+    m_formatTracker->trackComboText(m_styleSelector, [](QTextCharFormat const& fmt, QTextDocument const* doc)
+        {
+            auto styles = DocumentStyles::find(doc);
+            auto id = fmt.hasProperty(DocumentStyles::StyleIdProperty) ? fmt.intProperty(DocumentStyles::StyleIdProperty) : DocumentStyles::Normal;
+            auto style = styles ? styles->style(id) : nullptr;
+
+            return QVariant{ style ? style->name : QString{} };
+        }
+    );
+
+    fontSelectorToolBar->addWidget(m_styleSelector);
     fontSelectorToolBar->addWidget(fontSelector);
     fontSelectorToolBar->addWidget(sizeSelector);
 }
 
+void RichTextEditor::refreshStyles()
+{
+    auto styles = DocumentStyles::of(m_docsEditor->getCurrentDocument());
+    connect(styles, &DocumentStyles::stylesChanged, this, &RichTextEditor::refreshStyles, Qt::UniqueConnection);
+
+    if (!m_styleSelector)
+    {
+        return;
+    }
+
+    QSignalBlocker blocker{m_styleSelector};
+    auto current = m_styleSelector->currentText();
+
+    m_styleSelector->clear();
+    for (auto const& style : styles->styles())
+    {
+        m_styleSelector->addItem(style.name, style.id);
+    }
+
+    m_styleSelector->setCurrentIndex(std::max(0, m_styleSelector->findText(current)));
+}
+
+// A user style goes out with its definition the first time it's used in a session,
+// after that only its id is sent
+void RichTextEditor::applyStyle(int id)
+{
+    m_formatCoalescer->flush();
+
+    auto editor = m_docsEditor->getEditor();
+    auto styles = DocumentStyles::of(editor->document());
+    auto style = styles->style(id);
+
+    if (!style)
+    {
+        return;
+    }
+
+    ActionUP action = std::make_unique<StyleApply>(id, editor);
+
+    if (!styles->isSynced(id))
+    {
+        std::vector<ActionUP> children;
+        children.push_back(std::make_unique<StyleDefine>(*style, editor));
+        children.push_back(std::move(action));
+        action = std::make_unique<CompositeAction>(std::move(children), editor);
+    }
+
+    action->execute();
+    DBusSession::instance()->sendAction(std::move(action));
+    editor->setFocus();
+}
+
+void RichTextEditor::loadDictionary(QString const& path)
+{
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    using Result = std::shared_ptr<SpellDictionary const>;
+
+    auto watcher = new QFutureWatcher<Result>{this};
+
+    connect(watcher, &QFutureWatcher<Result>::finished, this, [=]
+        {
+            m_spellChecker->setDictionary(watcher->result());
+            watcher->deleteLater();
+        }
+    );
+
+    watcher->setFuture(QtConcurrent::run(&SpellDictionary::load, path));
+}
+
+// The progress dialog is modeless, editing goes on while the pages are rendered
+void RichTextEditor::exportPdf(QString path)
+{
+    if (!path.endsWith(".pdf", Qt::CaseInsensitive))
+    {
+        path += ".pdf";
+    }
+
+    if (!m_pdfExporter->start(m_docsEditor->getCurrentDocument(), path))
+    {
+        statusBar()->showMessage(tr("An export is already running"), 5000);
+        return;
+    }
+
+    auto dialog = new QProgressDialog{tr("Exporting %1").arg(QFileInfo{path}.fileName()), tr("Cancel"), 0, 0, this};
+    dialog->setWindowModality(Qt::NonModal);
+    dialog->setMinimumDuration(500);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+
+    connect(dialog, &QProgressDialog::canceled, m_pdfExporter, &PdfExporter::cancel);
+    connect(m_pdfExporter, &PdfExporter::finished, dialog, &QProgressDialog::close);
+    connect(m_pdfExporter, &PdfExporter::progress, dialog, [dialog](int pages, int total)
+        {
+            dialog->setMaximum(total);
+            dialog->setValue(pages);
+        }
+    );
+}
+
 void RichTextEditor::buildEditorAndObjects()
 {
     auto editor = new AdditionalEmiterTextEditor;
     m_docsEditor = new EditorTabWidget{ editor };
     GlobalMementoBuilder::createInstance(m_docsEditor);
     m_actionsObserver = new DBusActionsObserver{m_docsEditor->getEditor(), this};
+    m_formatCoalescer = new FormatCoalescer{m_docsEditor, 300, this};
+    connect(m_docsEditor, &EditorTabWidget::currentDocumentChanged, this, &RichTextEditor::refreshStyles);
+    connect(m_docsEditor, &EditorTabWidget::currentViewerChanged, this, &RichTextEditor::onViewerChanged);
+    refreshStyles();
+    m_formatTracker->attach(m_docsEditor);
+
+    m_textFinder = new TextFinder{m_docsEditor, this};
+    m_findPanel = new FindPanel{m_textFinder};
+    m_findDock = new QDockWidget{tr("Find and replace"), this};
+    m_findDock->setObjectName("findDock");
+    m_findDock->setWidget(m_findPanel);
+    m_findDock->hide();
+    addDockWidget(Qt::BottomDockWidgetArea, m_findDock);
+
+    connect(m_findDock, &QDockWidget::visibilityChanged, this, [=](bool visible)
+        {
+            if (!visible)
+            {
+                m_textFinder->clear();
+            }
+        }
+    );
+
+    connect(m_findPanel, &FindPanel::closeRequested, this, [=]
+        {
+            m_findDock->hide();
+            m_docsEditor->getEditor()->setFocus();
+        }
+    );
+    m_spellChecker = new SpellChecker{m_docsEditor, this};
+
+    connect(m_spellChecker, &SpellChecker::dictionaryChanged, this, [=](bool loaded)
+        {
+            if (!loaded)
+            {
+                statusBar()->showMessage(tr("The spelling dictionary couldn't be loaded"), 5000);
+            }
+        }
+    );
+
+    connect(m_pdfExporter, &PdfExporter::finished, this, [=](bool ok, QString const& error)
+        {
+            statusBar()->showMessage(ok ? tr("PDF exported") : error.isEmpty() ? tr("PDF export cancelled") : error, 5000);
+        }
+    );
+
+    // Sent the way the open dialog sends them, peers load the files themselves
+    connect(m_preloader, &FilePreloader::loaded, this, [=](QString const& path, QTextDocument* doc, bool first)
+        {
+            m_docsEditor->addDocument(path, doc, false, first);
+            DBusSession::instance()->sendAction(std::make_unique<FileOpenAction>(path, m_docsEditor));
+
+            if (first)
+            {
+                raise();
+                activateWindow();
+            }
+        }
+    );
+
+    connect(m_preloader, &FilePreloader::viewRequested, this, [=](QString const& path)
+        {
+            openInViewer(path);
+            DBusSession::instance()->sendAction(std::make_unique<FileOpenAction>(path, m_docsEditor));
+        }
+    );
+
+    connect(m_preloader, &FilePreloader::failed, this, [=](QString const& path, QString const& error)
+        {
+            statusBar()->showMessage(error, 5000);
+        }
+    );
+
+    m_statisticsLabel = new QLabel;
+    statusBar()->addPermanentWidget(m_statisticsLabel);
+
+    connect(m_statistics, &DocumentStatistics::changed, this, &RichTextEditor::updateStatistics);
+    connect(m_docsEditor, &EditorTabWidget::currentDocumentChanged, m_statistics, &DocumentStatistics::setDocument);
+    connect(m_docsEditor, &EditorTabWidget::currentEditorChanged, this, &RichTextEditor::updateStatistics);
+    connect(editor, &QTextEdit::cursorPositionChanged, this, &RichTextEditor::updateStatistics);
+    m_statistics->setDocument(m_docsEditor->getCurrentDocument());
+
     editor->setDocumentTitle("Example title");
     setCentralWidget(m_docsEditor);
     m_textObserver = new TextChangeObserver{ editor, 10 };
+
+    connect(m_docsEditor, &EditorTabWidget::viewAdded, this, [this](AdditionalEmiterTextEditor* view)
+        {
+            new TextChangeObserver{ view, 10 };
+            connect(view, &QTextEdit::cursorPositionChanged, this, &RichTextEditor::updateStatistics);
+        }
+    );
+
+    // The closed view may be the one both observers were created on. Every view has its
+    // own TextChangeObserver, which dies with it.
+    connect(m_docsEditor, &EditorTabWidget::viewClosed, this, [this](AdditionalEmiterTextEditor* view)
+        {
+            auto survivor = static_cast<AdditionalEmiterTextEditor*>(m_docsEditor->getEditor());
+
+            if (m_actionsObserver->editor() == view)
+            {
+                m_actionsObserver->setEditor(survivor);
+            }
+
+            if (m_textObserver && m_textObserver->parent() == view)
+            {
+                m_textObserver = survivor->findChild<TextChangeObserver*>(QString{}, Qt::FindDirectChildrenOnly);
+                if (!m_textObserver)
+                {
+                    m_textObserver = new TextChangeObserver{ survivor, 10 };
+                }
+            }
+        }
+    );
+}
+
+void RichTextEditor::updateStatistics()
+{
+    auto totals = m_statistics->totals();
+    auto words = m_statistics->wordsBefore(m_docsEditor->getEditor()->textCursor());
+
+    m_statisticsLabel->setText(tr("Word %1 of %2, %3 characters, %4 paragraphs")
+        .arg(words).arg(totals.words).arg(totals.characters).arg(totals.paragraphs));
+}
+
+void RichTextEditor::onViewerChanged(LargeFileViewer* viewer)
+{
+    for (auto action : m_documentActions)
+    {
+        action->setEnabled(!viewer);
+    }
+
+    if (m_fontToolBar)
+    {
+        m_fontToolBar->setEnabled(!viewer);
+    }
 }
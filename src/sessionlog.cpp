@@ -0,0 +1,457 @@
+#include "sessionlog.hpp"
+#include "tracing.hpp"
+#include "logging.hpp"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace sessionlog
+{
+
+namespace
+{
+
+constexpr char headerMagic[] = "RTESLOG1";
+constexpr char trailerMagic[] = "RTESEND1";
+constexpr qint64 headerSize = 16;
+constexpr qint64 trailerSize = 24;
+constexpr qint64 indexEntrySize = 1 + 24;
+
+constexpr qint64 indexEveryFrames = 1024;
+constexpr qint64 indexEveryBytes = 1024 * 1024;
+constexpr int flushBytes = 256 * 1024;
+
+// Frames waiting for the writer before append() warns, and how often it does
+constexpr qint64 behindBytes = 4 * 1024 * 1024;
+constexpr auto warningInterval = std::chrono::seconds{5};
+
+void appendVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out.append(static_cast<char>(value));
+}
+
+void append64(QByteArray& out, quint64 value)
+{
+    char bytes[8];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 8);
+}
+
+auto read64(uchar const* data) -> qint64
+{
+    return static_cast<qint64>(qFromLittleEndian<quint64>(data));
+}
+
+}
+
+Writer::Writer()
+    : m_queuedBytes{0}
+    , m_maxQueuedBytes{0}
+    , m_stopping{false}
+    , m_offset{0}
+    , m_lastTimeUs{0}
+    , m_frames{0}
+    , m_bytes{0}
+    , m_lastIndexOffset{0}
+    , m_framesSinceIndex{0}
+    , m_bytesSinceIndex{0}
+    , m_failed{false}
+{   }
+
+Writer::~Writer()
+{
+    close();
+}
+
+auto Writer::open(QString const& path) -> bool
+{
+    m_path = path;
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_start = std::chrono::steady_clock::now();
+    m_lastWarning = m_start - warningInterval;
+
+    m_buffer.reserve(flushBytes * 2);
+    m_buffer.append(headerMagic, 8);
+    append64(m_buffer, static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()));
+
+    m_thread = std::thread{&Writer::run, this};
+    return true;
+}
+
+auto Writer::errorString() const -> QString
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_error;
+}
+
+// Timestamps are taken here, so time spent in the queue doesn't skew them
+void Writer::append(QByteArray const& frame)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto timeUs = std::chrono::duration_cast<std::chrono::microseconds>(now - m_start).count();
+
+    qint64 queued = 0;
+    bool wasEmpty = false;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_stopping || !m_thread.joinable())
+        {
+            return;
+        }
+
+        wasEmpty = m_queue.empty();
+        m_queue.push_back(Queued{ timeUs, frame });
+        m_queuedBytes += frame.size();
+        m_maxQueuedBytes = std::max(m_maxQueuedBytes, m_queuedBytes);
+        queued = m_queuedBytes;
+    }
+
+    if (wasEmpty)
+    {
+        m_wakeup.notify_one();
+    }
+
+    if (queued > behindBytes && now - m_lastWarning >= warningInterval)
+    {
+        m_lastWarning = now;
+        RTE_LOG_WARNING("session recorder falling behind", {"queuedBytes", queued}, {"path", m_path});
+    }
+}
+
+void Writer::close()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+
+    m_wakeup.notify_one();
+    m_thread.join();
+    m_file.close();
+
+    RTE_LOG_INFO("session log closed",
+        {"path", m_path},
+        {"frames", m_frames},
+        {"frameBytes", m_bytes},
+        {"fileBytes", m_offset},
+        {"maxQueuedBytes", m_maxQueuedBytes});
+}
+
+// Takes the whole queue at once and writes it with one call
+void Writer::run()
+{
+    std::vector<Queued> batch;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wakeup.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+
+            if (m_queue.empty())
+            {
+                break;
+            }
+
+            batch.swap(m_queue);
+            m_queuedBytes = 0;
+        }
+
+        RTE_TRACE_SCOPE("sessionlog.write");
+
+        for (auto const& queued : batch)
+        {
+            encode(queued);
+        }
+
+        batch.clear();
+        flush();
+    }
+
+    writeIndex();
+
+    append64(m_buffer, static_cast<quint64>(m_lastIndexOffset));
+    append64(m_buffer, static_cast<quint64>(m_frames));
+    m_buffer.append(trailerMagic, 8);
+
+    flush();
+}
+
+void Writer::encode(Queued const& queued)
+{
+    auto before = m_buffer.size();
+
+    appendVarint(m_buffer, static_cast<quint64>(queued.timeUs - m_lastTimeUs) << 1);
+    appendVarint(m_buffer, static_cast<quint64>(queued.frame.size()));
+    m_buffer.append(queued.frame);
+
+    m_lastTimeUs = queued.timeUs;
+    m_bytes += queued.frame.size();
+    ++m_frames;
+    ++m_framesSinceIndex;
+    m_bytesSinceIndex += m_buffer.size() - before;
+
+    if (m_framesSinceIndex >= indexEveryFrames || m_bytesSinceIndex >= indexEveryBytes)
+    {
+        writeIndex();
+    }
+
+    if (m_buffer.size() >= flushBytes)
+    {
+        flush();
+    }
+}
+
+void Writer::writeIndex()
+{
+    if (m_framesSinceIndex == 0)
+    {
+        return;
+    }
+
+    auto offset = m_offset + m_buffer.size();
+
+    appendVarint(m_buffer, 1);
+    append64(m_buffer, static_cast<quint64>(m_lastIndexOffset));
+    append64(m_buffer, static_cast<quint64>(m_lastTimeUs));
+    append64(m_buffer, static_cast<quint64>(m_frames));
+
+    m_lastIndexOffset = offset;
+    m_framesSinceIndex = 0;
+    m_bytesSinceIndex = 0;
+}
+
+// After a write error the rest is still encoded, so offsets stay consistent, but
+// no longer written
+void Writer::flush()
+{
+    if (m_buffer.isEmpty())
+    {
+        return;
+    }
+
+    if (!m_failed && (m_file.write(m_buffer) != m_buffer.size() || !m_file.flush()))
+    {
+        m_failed = true;
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_error = m_file.errorString();
+        RTE_LOG_ERROR("can't write session log", {"path", m_path}, {"error", m_error});
+    }
+
+    m_offset += m_buffer.size();
+    m_buffer.resize(0);
+}
+
+Reader::Reader()
+    : m_data{nullptr}
+    , m_size{0}
+    , m_end{0}
+    , m_pos{0}
+    , m_lastTimeUs{0}
+    , m_frameCount{-1}
+{   }
+
+auto Reader::open(QString const& path) -> bool
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+
+    if (m_size < headerSize || !m_data || std::memcmp(m_data, headerMagic, 8) != 0)
+    {
+        m_error = QString{"Not a session log"};
+        return false;
+    }
+
+    m_startTime = QDateTime::fromMSecsSinceEpoch(read64(m_data + 8));
+    m_end = m_size;
+    m_index.clear();
+
+    if (m_size >= headerSize + trailerSize && std::memcmp(m_data + m_size - 8, trailerMagic, 8) == 0)
+    {
+        m_end = m_size - trailerSize;
+        m_frameCount = read64(m_data + m_end + 8);
+
+        // Every link points backwards, anything else is damage and ends the chain
+        auto offset = read64(m_data + m_end);
+        while (offset >= headerSize)
+        {
+            Index index;
+            qint64 previous = 0;
+
+            if (!readIndex(offset, previous, index) || previous >= offset)
+            {
+                break;
+            }
+
+            m_index.push_back(index);
+            offset = previous;
+        }
+
+        std::reverse(m_index.begin(), m_index.end());
+    }
+
+    m_pos = headerSize;
+    m_lastTimeUs = 0;
+
+    return true;
+}
+
+auto Reader::errorString() const -> QString
+{
+    return m_error;
+}
+
+auto Reader::startTime() const -> QDateTime
+{
+    return m_startTime;
+}
+
+auto Reader::isComplete() const -> bool
+{
+    return m_frameCount >= 0;
+}
+
+auto Reader::frameCount() const -> qint64
+{
+    return m_frameCount;
+}
+
+auto Reader::next(Entry& entry) -> bool
+{
+    while (m_pos < m_end)
+    {
+        quint64 tag = 0;
+        if (!readVarint(tag))
+        {
+            return false;
+        }
+
+        if (tag & 1)
+        {
+            if (m_end - m_pos < indexEntrySize - 1)
+            {
+                return false;
+            }
+
+            m_lastTimeUs = read64(m_data + m_pos + 8);
+            m_pos += indexEntrySize - 1;
+            continue;
+        }
+
+        quint64 size = 0;
+        if (!readVarint(size) || size > static_cast<quint64>(m_end - m_pos))
+        {
+            return false;
+        }
+
+        m_lastTimeUs += static_cast<qint64>(tag >> 1);
+
+        entry.timeUs = m_lastTimeUs;
+        entry.frame = QByteArray{reinterpret_cast<char const*>(m_data + m_pos), static_cast<int>(size)};
+        m_pos += static_cast<qint64>(size);
+
+        return true;
+    }
+
+    return false;
+}
+
+// An index entry carries the time of the frame before it, so the one to resume from
+// is the last entry earlier than timeUs
+void Reader::seek(qint64 timeUs)
+{
+    m_pos = headerSize;
+    m_lastTimeUs = 0;
+
+    auto it = std::lower_bound(m_index.begin(), m_index.end(), timeUs, [](Index const& index, qint64 time)
+        {
+            return index.timeUs < time;
+        }
+    );
+
+    if (it != m_index.begin())
+    {
+        auto const& index = *std::prev(it);
+        m_pos = index.offset + indexEntrySize;
+        m_lastTimeUs = index.timeUs;
+    }
+
+    Entry entry;
+    for (;;)
+    {
+        auto pos = m_pos;
+        auto lastTimeUs = m_lastTimeUs;
+
+        if (!next(entry))
+        {
+            return;
+        }
+
+        if (entry.timeUs >= timeUs)
+        {
+            m_pos = pos;
+            m_lastTimeUs = lastTimeUs;
+            return;
+        }
+    }
+}
+
+auto Reader::readVarint(quint64& value) -> bool
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64 && m_pos < m_end; shift += 7)
+    {
+        auto byte = m_data[m_pos++];
+        value |= static_cast<quint64>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto Reader::readIndex(qint64 offset, qint64& previous, Index& index) const -> bool
+{
+    if (offset + indexEntrySize > m_end || m_data[offset] != 1)
+    {
+        return false;
+    }
+
+    previous = read64(m_data + offset + 1);
+    index = Index{ offset, read64(m_data + offset + 9), read64(m_data + offset + 17) };
+
+    return true;
+}
+
+}
@@ -0,0 +1,349 @@
+#include "spellchecker.hpp"
+#include "tools.hpp"
+#include "tracing.hpp"
+
+#include <QColor>
+#include <QScrollBar>
+#include <QTextBlock>
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr int editDelayMs = 300;
+constexpr int sliceChars = 64 * 1024;
+constexpr int visiblePriority = 1;
+
+}
+
+SpellChecker::SpellChecker(EditorTabWidget* docsEditor, QObject* parent)
+    : QObject{parent}
+    , m_docsEditor{docsEditor}
+    , m_scanFrom{0}
+    , m_backgroundInFlight{0}
+    , m_enabled{false}
+{
+    // One thread, so checking never competes with the GUI thread for more than a core
+    m_pool.setMaxThreadCount(1);
+
+    m_editTimer.setSingleShot(true);
+    m_editTimer.setInterval(editDelayMs);
+
+    connect(&m_editTimer, &QTimer::timeout, this, &SpellChecker::schedule);
+    connect(&m_tracker, &BlockChangeTracker::reset, this, &SpellChecker::onReset);
+    connect(&m_tracker, &BlockChangeTracker::blocksChanged, this, &SpellChecker::onBlocksChanged);
+    connect(m_docsEditor, &EditorTabWidget::currentEditorChanged, this, &SpellChecker::onEditorChanged);
+    connect(m_docsEditor, &EditorTabWidget::currentDocumentChanged, this, &SpellChecker::onDocumentChanged);
+
+    onEditorChanged(m_docsEditor->getEditor());
+    onDocumentChanged(m_docsEditor->getCurrentDocument());
+}
+
+SpellChecker::~SpellChecker()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void SpellChecker::setDictionary(std::shared_ptr<SpellDictionary const> dictionary)
+{
+    m_dictionary = std::move(dictionary);
+    attach();
+
+    emit dictionaryChanged(m_dictionary != nullptr);
+}
+
+auto SpellChecker::hasDictionary() const -> bool
+{
+    return m_dictionary != nullptr;
+}
+
+void SpellChecker::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    attach();
+}
+
+auto SpellChecker::isEnabled() const -> bool
+{
+    return m_enabled;
+}
+
+auto SpellChecker::misspelledIn(int begin, int end) const -> std::vector<std::pair<int, int>>
+{
+    std::vector<std::pair<int, int>> result;
+
+    auto doc = m_tracker.document();
+    if (!doc)
+    {
+        return result;
+    }
+
+    for (auto block = doc->findBlock(begin); block.isValid() && block.position() <= end; block = block.next())
+    {
+        auto index = block.blockNumber();
+        if (index >= m_entries.size())
+        {
+            break;
+        }
+
+        for (auto [offset, length] : m_entries[index].result)
+        {
+            result.emplace_back(block.position() + offset, length);
+        }
+    }
+
+    return result;
+}
+
+void SpellChecker::onEditorChanged(QTextEdit* editor)
+{
+    if (m_editor)
+    {
+        disconnect(m_editor->verticalScrollBar(), nullptr, this, nullptr);
+        disconnect(m_editor->horizontalScrollBar(), nullptr, this, nullptr);
+        m_editor->setExtraSelections(blocktracking::otherSelections(m_editor, UnderlineProperty));
+    }
+
+    m_editor = editor;
+
+    connect(m_editor->verticalScrollBar(), &QScrollBar::valueChanged, this, &SpellChecker::onScrolled);
+    connect(m_editor->horizontalScrollBar(), &QScrollBar::valueChanged, this, &SpellChecker::onScrolled);
+
+    onScrolled();
+}
+
+void SpellChecker::onDocumentChanged(QTextDocument* doc)
+{
+    m_document = doc;
+    attach();
+}
+
+void SpellChecker::onReset(int blockCount)
+{
+    cancel();
+    m_editTimer.stop();
+
+    m_entries.reset(blockCount);
+    m_scanFrom = 0;
+
+    updateUnderlines();
+    schedule();
+}
+
+// Typing only restamps the edited blocks; checking waits for a pause
+void SpellChecker::onBlocksChanged(int first, int removed, int added)
+{
+    if (m_entries.replace(first, removed, added))
+    {
+        if (m_scanFrom > first)
+        {
+            m_scanFrom = std::max(first, m_scanFrom + added - removed);
+        }
+
+        cancel();
+    }
+
+    m_scanFrom = std::min(m_scanFrom, first);
+    m_editTimer.start();
+}
+
+void SpellChecker::onScrolled()
+{
+    updateUnderlines();
+    schedule();
+}
+
+// Visible blocks go out first and jump the queue; the rest of the document follows
+// one slice at a time, the next one leaving when the previous one came back
+void SpellChecker::schedule()
+{
+    RTE_TRACE_SCOPE("spell.schedule");
+
+    auto doc = m_tracker.document();
+    if (!doc || !m_dictionary)
+    {
+        return;
+    }
+
+    auto count = m_entries.size();
+
+    Batch visible;
+    auto [first, last] = visibleBlocks();
+    auto block = doc->findBlockByNumber(first);
+
+    for (auto index = first; index <= last && index < count && block.isValid(); ++index, block = block.next())
+    {
+        enqueue(visible, index, block);
+    }
+
+    submit(std::move(visible), true);
+
+    if (m_backgroundInFlight > 0)
+    {
+        return;
+    }
+
+    Batch background;
+    auto size = 0;
+    auto index = m_scanFrom;
+    block = doc->findBlockByNumber(index);
+
+    for (; index < count && block.isValid() && size < sliceChars; ++index, block = block.next())
+    {
+        size += enqueue(background, index, block);
+    }
+
+    m_scanFrom = index;
+    submit(std::move(background), false);
+}
+
+void SpellChecker::updateUnderlines()
+{
+    if (!m_editor)
+    {
+        return;
+    }
+
+    auto selections = blocktracking::otherSelections(m_editor, UnderlineProperty);
+
+    if (m_tracker.document() && m_editor->document() == m_tracker.document())
+    {
+        auto viewport = m_editor->viewport()->rect();
+        auto first = m_editor->cursorForPosition(viewport.topLeft()).position();
+        auto last = m_editor->cursorForPosition(viewport.bottomRight()).position();
+
+        QTextCharFormat fmt;
+        fmt.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+        fmt.setUnderlineColor(QColor{Qt::red});
+        fmt.setProperty(UnderlineProperty, true);
+
+        for (auto [pos, length] : misspelledIn(first, last))
+        {
+            QTextCursor cursor{m_tracker.document()};
+            cursor.setPosition(pos);
+            cursor.setPosition(pos + length, QTextCursor::KeepAnchor);
+            selections.append(QTextEdit::ExtraSelection{ cursor, fmt });
+        }
+    }
+
+    m_editor->setExtraSelections(selections);
+}
+
+// Checking runs only while enabled and a dictionary is there
+auto SpellChecker::attach() -> void
+{
+    m_tracker.setDocument(m_enabled && m_dictionary ? m_document.data() : nullptr);
+}
+
+// Batches in flight are dropped; their blocks get queued again, so the background
+// scan resumes at the first of them
+auto SpellChecker::cancel() -> void
+{
+    m_generation.cancel(m_pool);
+    m_scanFrom = std::min(m_scanFrom, m_entries.unqueue());
+    m_backgroundInFlight = 0;
+}
+
+auto SpellChecker::visibleBlocks() const -> std::pair<int, int>
+{
+    if (!m_editor || m_editor->document() != m_tracker.document())
+    {
+        return { 0, -1 };
+    }
+
+    auto viewport = m_editor->viewport()->rect();
+    auto first = m_editor->cursorForPosition(viewport.topLeft()).blockNumber();
+    auto last = m_editor->cursorForPosition(viewport.bottomRight()).blockNumber();
+
+    return { first, last };
+}
+
+// Returns the characters taken, at least one per block so empty blocks count too
+auto SpellChecker::enqueue(Batch& batch, int index, QTextBlock const& block) -> int
+{
+    auto& entry = m_entries[index];
+    if (entry.done || entry.queued)
+    {
+        return 0;
+    }
+
+    auto text = block.text();
+    auto size = static_cast<int>(text.size()) + 1;
+
+    entry.queued = true;
+    batch.emplace_back(index, entry.stamp, std::move(text));
+
+    return size;
+}
+
+auto SpellChecker::submit(Batch batch, bool visible) -> void
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    m_backgroundInFlight += visible ? 0 : 1;
+
+    auto task = [this, batch = std::move(batch), visible, dictionary = m_dictionary, token = m_generation.token()]
+    {
+        std::vector<Checked> results;
+        results.reserve(batch.size());
+
+        for (auto const& [block, stamp, text] : batch)
+        {
+            if (token.isCancelled())
+            {
+                return;
+            }
+
+            results.push_back(Checked{ block, stamp, dictionary->misspelled(text) });
+        }
+
+        QMetaObject::invokeMethod(this, [=, generation = token.generation]
+            {
+                accept(generation, visible, results);
+            },
+            Qt::QueuedConnection
+        );
+    };
+
+    tools::startTask(&m_pool, std::move(task), visible ? visiblePriority : 0);
+}
+
+auto SpellChecker::accept(quint64 generation, bool visible, std::vector<Checked> const& results) -> void
+{
+    if (!m_generation.isCurrent(generation))
+    {
+        return;
+    }
+
+    auto [first, last] = visibleBlocks();
+    auto inView = false;
+
+    for (auto const& result : results)
+    {
+        auto entry = m_entries.take(result.block, result.stamp);
+        if (!entry)
+        {
+            continue;
+        }
+
+        entry->result = result.misspelled;
+
+        inView = inView || (result.block >= first && result.block <= last);
+    }
+
+    if (inView)
+    {
+        updateUnderlines();
+    }
+
+    if (!visible)
+    {
+        --m_backgroundInFlight;
+        schedule();
+    }
+}
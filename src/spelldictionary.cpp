@@ -0,0 +1,426 @@
+#include "spelldictionary.hpp"
+#include "logging.hpp"
+#include "tracing.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextCodec>
+
+namespace
+{
+
+auto readLines(QString const& path, QByteArray const& encoding, QStringList& lines) -> bool
+{
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    auto codec = QTextCodec::codecForName(encoding);
+    if (!codec)
+    {
+        codec = QTextCodec::codecForName("UTF-8");
+    }
+
+    lines = codec->toUnicode(file.readAll()).split('\n');
+    return true;
+}
+
+// Hunspell names encodings like "ISO8859-1", Qt only knows them hyphenated
+auto codecName(QString const& set) -> QByteArray
+{
+    auto name = set.toLatin1();
+    name.replace("ISO8859", "ISO-8859");
+    return name;
+}
+
+}
+
+SpellDictionary::SpellDictionary()
+    : m_encoding{"UTF-8"}
+    , m_flagType{FlagType::Char}
+{   }
+
+auto SpellDictionary::load(QString const& dicPath) -> std::shared_ptr<SpellDictionary const>
+{
+    RTE_TRACE_SCOPE("spell.load");
+
+    auto dictionary = std::make_shared<SpellDictionary>();
+
+    QFileInfo info{dicPath};
+    dictionary->readAffixes(info.path() + "/" + info.completeBaseName() + ".aff");
+
+    if (!dictionary->readWords(dicPath))
+    {
+        RTE_LOG_WARNING("can't read dictionary", {"path", dicPath});
+        return nullptr;
+    }
+
+    // Affixes are only needed for the expansion
+    dictionary->m_affixes.clear();
+
+    RTE_LOG_INFO("dictionary loaded", {"path", dicPath}, {"words", dictionary->size()});
+
+    return dictionary;
+}
+
+auto SpellDictionary::find(QString const& locale) -> QString
+{
+    auto name = QString{locale}.replace('-', '_') + ".dic";
+
+    QStringList dirs;
+    for (auto const& dir : QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation))
+    {
+        dirs << dir + "/hunspell" << dir + "/myspell" << dir + "/myspell/dicts";
+    }
+
+    for (auto const& dir : dirs)
+    {
+        QFileInfo info{QDir{dir}.filePath(name)};
+        if (info.isReadable())
+        {
+            return info.absoluteFilePath();
+        }
+    }
+
+    return {};
+}
+
+// Title case and all caps words are also accepted when their lower case form is known,
+// and all caps words when their title case form is ("PARIS" for "Paris")
+auto SpellDictionary::contains(QStringView word) const -> bool
+{
+    auto text = word.toString();
+    text.replace(QChar{0x2019}, '\'');
+
+    if (m_words.contains(text))
+    {
+        return true;
+    }
+
+    auto lower = text.toLower();
+    if (lower == text)
+    {
+        return false;
+    }
+
+    auto title = lower;
+    title[0] = title[0].toUpper();
+
+    auto allCaps = text == text.toUpper();
+    if ((allCaps || text == title) && m_words.contains(lower))
+    {
+        return true;
+    }
+
+    return allCaps && m_words.contains(title);
+}
+
+auto SpellDictionary::size() const -> int
+{
+    return m_words.size();
+}
+
+auto SpellDictionary::misspelled(QStringView text) const -> std::vector<std::pair<int, int>>
+{
+    std::vector<std::pair<int, int>> result;
+
+    auto size = static_cast<int>(text.size());
+    auto i = 0;
+
+    while (i < size)
+    {
+        if (!text[i].isLetter())
+        {
+            ++i;
+            continue;
+        }
+
+        auto begin = i;
+        auto digit = begin > 0 && text[begin - 1].isDigit();
+
+        while (i < size)
+        {
+            auto chr = text[i];
+
+            if (chr.isLetterOrNumber() || chr.isMark())
+            {
+                digit = digit || chr.isDigit();
+                ++i;
+            }
+            else if ((chr == '\'' || chr == QChar{0x2019}) && i + 1 < size && text[i + 1].isLetter())
+            {
+                ++i;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if (!digit && i - begin > 1 && !contains(text.mid(begin, i - begin)))
+        {
+            result.emplace_back(begin, i - begin);
+        }
+    }
+
+    return result;
+}
+
+auto SpellDictionary::parseFlags(QString const& flags) const -> QStringList
+{
+    QStringList result;
+
+    switch (m_flagType)
+    {
+    case FlagType::Char:
+        for (auto chr : flags)
+        {
+            result << QString{chr};
+        }
+        break;
+
+    case FlagType::Long:
+        for (int i = 0; i + 1 < flags.size(); i += 2)
+        {
+            result << flags.mid(i, 2);
+        }
+        break;
+
+    case FlagType::Number:
+        result = flags.split(',', Qt::SkipEmptyParts);
+        break;
+    }
+
+    return result;
+}
+
+auto SpellDictionary::readAffixes(QString const& path) -> void
+{
+    QStringList lines;
+
+    // SET comes first in practice, but it may be anywhere in the file
+    if (!readLines(path, "ISO-8859-1", lines))
+    {
+        return;
+    }
+
+    for (auto const& line : lines)
+    {
+        if (line.startsWith("SET "))
+        {
+            m_encoding = codecName(line.mid(4).trimmed());
+            readLines(path, m_encoding, lines);
+            break;
+        }
+    }
+
+    static QRegularExpression const whitespace{"\\s+"};
+
+    for (auto const& line : lines)
+    {
+        auto fields = line.trimmed().split(whitespace, Qt::SkipEmptyParts);
+        if (fields.size() < 2 || fields[0].startsWith('#'))
+        {
+            continue;
+        }
+
+        auto const& keyword = fields[0];
+
+        if (keyword == "FLAG")
+        {
+            m_flagType = fields[1] == "long" ? FlagType::Long : fields[1] == "num" ? FlagType::Number : FlagType::Char;
+        }
+        else if (keyword == "NEEDAFFIX" || keyword == "PSEUDOROOT")
+        {
+            m_needAffixFlag = fields[1];
+        }
+        else if (keyword == "FORBIDDENWORD")
+        {
+            m_forbiddenFlag = fields[1];
+        }
+        else if ((keyword == "PFX" || keyword == "SFX") && fields.size() >= 4)
+        {
+            auto suffix = keyword == "SFX";
+            auto it = m_affixes.find(fields[1]);
+
+            // The first line of a flag is its header: PFX flag cross_product count
+            if (it == m_affixes.end())
+            {
+                m_affixes.insert(fields[1], AffixGroup{ suffix, fields[2] == "Y", {} });
+                continue;
+            }
+
+            auto strip = fields[2] == "0" ? QString{} : fields[2];
+            auto append = fields[3].section('/', 0, 0);
+            if (append == "0")
+            {
+                append.clear();
+            }
+
+            QRegularExpression condition;
+            if (fields.size() > 4 && fields[4] != ".")
+            {
+                condition.setPattern(suffix ? "(?:" + fields[4] + ")$" : "^(?:" + fields[4] + ")");
+            }
+
+            it->rules.push_back(Affix{ strip, append, condition });
+        }
+    }
+}
+
+auto SpellDictionary::readWords(QString const& path) -> bool
+{
+    QStringList lines;
+    if (!readLines(path, m_encoding, lines))
+    {
+        return false;
+    }
+
+    auto first = true;
+
+    for (auto const& line : lines)
+    {
+        auto entry = line.trimmed();
+
+        // The first line holds the approximate word count
+        if (first)
+        {
+            first = false;
+
+            auto isCount = false;
+            entry.toInt(&isCount);
+            if (isCount)
+            {
+                continue;
+            }
+        }
+
+        // Morphological fields follow the word after white space
+        auto end = 0;
+        while (end < entry.size() && !entry[end].isSpace())
+        {
+            ++end;
+        }
+
+        if (end == 0)
+        {
+            continue;
+        }
+
+        QString word;
+        QString flags;
+
+        for (int i = 0; i < end; ++i)
+        {
+            if (entry[i] == '\\' && i + 1 < end && entry[i + 1] == '/')
+            {
+                word += '/';
+                ++i;
+            }
+            else if (entry[i] == '/')
+            {
+                flags = entry.mid(i + 1, end - i - 1);
+                break;
+            }
+            else
+            {
+                word += entry[i];
+            }
+        }
+
+        addWord(word, parseFlags(flags));
+    }
+
+    return true;
+}
+
+// Cross products combine every cross suffix form with every cross prefix
+auto SpellDictionary::addWord(QString const& word, QStringList const& flags) -> void
+{
+    if (word.isEmpty() || (!m_forbiddenFlag.isEmpty() && flags.contains(m_forbiddenFlag)))
+    {
+        return;
+    }
+
+    if (m_needAffixFlag.isEmpty() || !flags.contains(m_needAffixFlag))
+    {
+        m_words.insert(word);
+    }
+
+    QStringList crossSuffixed;
+
+    for (auto const& flag : flags)
+    {
+        auto it = m_affixes.constFind(flag);
+        if (it == m_affixes.constEnd() || !it->suffix)
+        {
+            continue;
+        }
+
+        auto forms = apply(*it, word);
+        for (auto const& form : forms)
+        {
+            m_words.insert(form);
+        }
+
+        if (it->cross)
+        {
+            crossSuffixed << forms;
+        }
+    }
+
+    for (auto const& flag : flags)
+    {
+        auto it = m_affixes.constFind(flag);
+        if (it == m_affixes.constEnd() || it->suffix)
+        {
+            continue;
+        }
+
+        for (auto const& form : apply(*it, word))
+        {
+            m_words.insert(form);
+        }
+
+        if (!it->cross)
+        {
+            continue;
+        }
+
+        for (auto const& suffixed : crossSuffixed)
+        {
+            for (auto const& form : apply(*it, suffixed))
+            {
+                m_words.insert(form);
+            }
+        }
+    }
+}
+
+auto SpellDictionary::apply(AffixGroup const& group, QString const& word) -> QStringList
+{
+    QStringList forms;
+
+    for (auto const& rule : group.rules)
+    {
+        if (!rule.condition.pattern().isEmpty() && !rule.condition.match(word).hasMatch())
+        {
+            continue;
+        }
+
+        if (group.suffix && word.endsWith(rule.strip) && word.size() > rule.strip.size())
+        {
+            forms << word.chopped(rule.strip.size()) + rule.append;
+        }
+        else if (!group.suffix && word.startsWith(rule.strip) && word.size() > rule.strip.size())
+        {
+            forms << rule.append + word.mid(rule.strip.size());
+        }
+    }
+
+    return forms;
+}
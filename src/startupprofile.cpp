@@ -0,0 +1,160 @@
+#include "startupprofile.hpp"
+#include "tracing.hpp"
+
+#include <QEvent>
+#include <QTimer>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace startupprofile
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Mark
+{
+    char const* phase;
+    Clock::time_point time;
+};
+
+// The goal on a cold cache, counted from begin()
+constexpr double firstPaintTargetMs = 150;
+
+Clock::time_point origin = Clock::now();
+std::vector<Mark> marks;
+bool enabled = false;
+
+auto msBetween(Clock::time_point from, Clock::time_point to) -> double
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+struct FirstPaintFilter : public QObject
+{
+    FirstPaintFilter(QWidget* widget, std::function<void()> fn)
+        : QObject{widget}
+        , m_fn{std::move(fn)}
+        , m_fired{false}
+    {
+        widget->installEventFilter(this);
+        QTimer::singleShot(1000, this, [this] { timeout(); });
+    }
+
+    // The first paint removes the filter at once, later paints before fn runs don't
+    // mark or queue it again
+    bool eventFilter(QObject* watched, QEvent* event) override
+    {
+        if (event->type() == QEvent::Paint && !m_fired)
+        {
+            m_fired = true;
+            watched->removeEventFilter(this);
+            mark("first paint");
+
+            // Queued, so the paint and the flush to screen finish first
+            QTimer::singleShot(0, this, [this] { run(); });
+        }
+
+        return QObject::eventFilter(watched, event);
+    }
+
+    void timeout()
+    {
+        if (m_fired)
+        {
+            return;
+        }
+
+        m_fired = true;
+        parent()->removeEventFilter(this);
+        run();
+    }
+
+    void run()
+    {
+        deleteLater();
+        m_fn();
+    }
+
+    std::function<void()> m_fn;
+    bool m_fired;
+};
+
+}
+
+void begin()
+{
+    origin = Clock::now();
+    marks.clear();
+    marks.reserve(16);
+}
+
+void setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+void mark(char const* phase)
+{
+    auto now = Clock::now();
+
+#if defined(RICHTEXT_TRACING)
+    // Same clock as tracing::now()
+    auto previous = marks.empty() ? origin : marks.back().time;
+    auto toNs = [](Clock::time_point time)
+    {
+        return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+    };
+    tracing::record(phase, toNs(previous), toNs(now));
+#endif
+
+    marks.push_back(Mark{ phase, now });
+}
+
+auto elapsedMs() -> double
+{
+    return msBetween(origin, Clock::now());
+}
+
+void afterFirstPaint(QWidget* widget, std::function<void()> fn)
+{
+    new FirstPaintFilter{ widget, std::move(fn) };
+}
+
+void report()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    std::fprintf(stderr, "startup profile:\n");
+
+    auto previous = origin;
+    auto firstPaint = -1.0;
+
+    for (auto const& mark : marks)
+    {
+        std::fprintf(stderr, "  %9.1f ms  %+9.1f ms  %s\n", msBetween(origin, mark.time), msBetween(previous, mark.time), mark.phase);
+        previous = mark.time;
+
+        if (std::strcmp(mark.phase, "first paint") == 0)
+        {
+            firstPaint = msBetween(origin, mark.time);
+        }
+    }
+
+    if (firstPaint >= 0)
+    {
+        std::fprintf(stderr, "  first paint %.1f ms, target %.0f ms: %s\n", firstPaint, firstPaintTargetMs, firstPaint <= firstPaintTargetMs ? "met" : "missed");
+    }
+
+    std::fflush(stderr);
+}
+
+}
@@ -1,6 +1,9 @@
 #include "texteditoractions.hpp"
 #include "formatactions.hpp"
+#include "actionregistry.hpp"
 #include "tools.hpp"
+#include "tracing.hpp"
+#include "documentwriters.hpp"
 
 #include <exception>
 #include <cerrno>
@@ -10,6 +13,7 @@
 #include <QTextStream>
 #include <QTextList>
 #include <QFile>
+#include <QFileInfo>
 #include <QApplication>
 
 std::unique_ptr<GlobalMementoBuilder> GlobalMementoBuilder::_instance;
@@ -20,91 +24,27 @@ GlobalMementoBuilder::GlobalMementoBuilder(EditorTabWidget* docsEditor)
 
 bool GlobalMementoBuilder::actionIsSupported(ActionType action) const
 {
-	switch (action)
-	{
-	case ActionType::FormatBold:
-	case ActionType::FormatItalic:
-	case ActionType::FormatUnderline:
-	case ActionType::FormatAlignLeft:
-	case ActionType::FormatAlignRight:
-	case ActionType::FormatAlignCenter:
-	case ActionType::FormatAlignJustify:
-	case ActionType::FormatIndent:
-	case ActionType::FormatUnindent:
-	case ActionType::FormatColor:
-    case ActionType::FormatUnderlineColor:
-    case ActionType::FileOpen:
-    case ActionType::FileSave:
-    case ActionType::FileSaveAs:
-    case ActionType::DocNew:
-    case ActionType::TextChange:
-    case ActionType::EditCopy:
-    case ActionType::EditCut:
-    case ActionType::EditPaste:
-    case ActionType::EditRedo:
-    case ActionType::EditUndo:
-		return true;
-	default:
-		return false;
-	}
+    return static_cast<std::size_t>(action) < ActionRegistry::size;
 }
 
-//TODO enable support other action mementos
 ActionUP GlobalMementoBuilder::deserializeAction(QByteArray&& data, ActionType type)
 {
-	switch (auto editor = m_docsEditor->getEditor(); type)
-	{
-    case ActionType::FormatBold:
-        return build<FormatBold, BoldMemento>(std::move(data), editor);
-    case ActionType::FormatItalic:
-        return build<FormatItalic, ItalicMemento>(std::move(data), editor);
-	case ActionType::FormatUnderline:
-        return build<FormatUnderline, UnderlineMemento>(std::move(data), editor);
-	case ActionType::FormatAlignLeft:
-        return build<FormatAlignLeft, AlignLeftMemento>(std::move(data), editor);
-	case ActionType::FormatAlignRight:
-        return build<FormatAlignRight, AlignRightMemento>(std::move(data), editor);
-	case ActionType::FormatAlignCenter:
-        return build<FormatAlignCenter, AlignCenterMemento>(std::move(data), editor);
-	case ActionType::FormatAlignJustify:
-        return build<FormatAlignJustify, AlignJustifyMemento>(std::move(data), editor);
-    case ActionType::FormatIndent:
-	case ActionType::FormatUnindent:
-        return build<FormatIndent, IndentMemento>(std::move(data), editor);
-	case ActionType::FormatColor:
-        return build<FormatColor, ColorMemento>(std::move(data), editor);
-	case ActionType::FormatUnderlineColor:
-        return build<FormatUnderlineColor, UnderlineColorMemento>(std::move(data), editor);
-    case ActionType::FileOpen:
-        return build<FileOpenAction, FileOpenMemento>(std::move(data), m_docsEditor);
-    case ActionType::FileSave:
-        return build<FileSaveAction, FileSaveMemento>(std::move(data), m_docsEditor);
-    case ActionType::FileSaveAs:
-        return build<FileSaveAsAction, FileSaveAsMemento>(std::move(data), m_docsEditor);
-    case ActionType::DocNew:
-        return build<DocNewAction, DocNewMemento>(std::move(data), m_docsEditor);
-    case ActionType::EditCopy:
-        return build<EditCopyAction, EditCopyMemento>(std::move(data), editor);
-    case ActionType::EditPaste:
-        return build<EditPasteAction, EditPasteMemento>(std::move(data), editor);
-    case ActionType::EditCut:
-        return build<EditCutAction, EditCutMemento>(std::move(data), editor);
-    case ActionType::EditUndo:
-        return build<EditUndoAction, EditUndoMemento>(std::move(data), editor);
-    case ActionType::EditRedo:
-        return build<EditRedoAction, EditRedoMemento>(std::move(data), editor);
-    case ActionType::FontSize:
-        return build<FormatSize, SizeMemento>(std::move(data), editor);
-    case ActionType::FontFamily:
-        return build<FormatFamily, FamilyMemento>(std::move(data), editor);
-    case ActionType::TextChange:
-        return build<TextChangeAction_1, TextChangeAction_1::MementoInner>(std::move(data), editor);
-    default:
+    QDataStream stream{ &data, QIODevice::ReadOnly };
+    return deserializeAction(stream, type);
+}
+
+ActionUP GlobalMementoBuilder::deserializeAction(QDataStream& stream, ActionType type)
+{
+    if (!actionIsSupported(type))
+    {
         auto errorMsg = QString{"%1: Attemption build memento from unsupported ActionType{%2}"}
                 .arg(FUNC_SIGN)
                 .arg(static_cast<int>(type));
         throw std::logic_error{errorMsg.toStdString()};
-	}
+    }
+
+    auto deserializer = actionRegistry[static_cast<std::size_t>(type)];
+    return deserializer(*this, stream);
 }
 
 void GlobalMementoBuilder::createInstance(EditorTabWidget* docsEditor)
@@ -498,28 +438,49 @@ const Memento* FileOpenAction::getMemento() const
     return m_memento.get();
 }
 
+void openInViewer(QString const& path, EditorTabWidget* docsEditor)
+{
+    auto viewer = std::make_unique<LargeFileViewer>();
+
+    if (!viewer->open(path))
+    {
+        throw std::runtime_error{
+            QString{"Can't view file{%1}"}
+                .arg(path)
+                .toStdString()
+        };
+    }
+
+    docsEditor->addViewer(path, viewer.release());
+}
+
 //TODO implement
 void FileOpenAction::execute()
 {
+    RTE_TRACE_SCOPE("file.load");
+
     auto path = std::get<0>(m_memento->m_items);
 
-    QFile file{path};
-    if (!file.open(QIODevice::ReadOnly))
+    if (QFileInfo{path}.size() >= LargeFileViewer::autoThreshold)
+    {
+        openInViewer(path, m_docsEditor);
+        return;
+    }
+
+    auto doc = std::make_unique<QTextDocument>();
+    QString error;
+
+    if (!documentwriters::load(path, doc.get(), &error))
     {
         throw std::runtime_error{
             QString{"Can't open file{%1}. Error{%2}"}
                 .arg(path)
-                .arg(std::strerror(errno))
+                .arg(error)
                 .toStdString()
         };
     }
 
-    QTextStream file_stream{&file};
-    auto content = file_stream.readAll();
-    auto doc = new QTextDocument;
-    doc->setHtml(content);
-
-    m_docsEditor->addDocument(path, doc);
+    m_docsEditor->addDocument(path, doc.release());
 }
 
 void FileOpenAction::setMemento(MementoUP memento)
@@ -590,24 +551,26 @@ FileSaveAsAction::FileSaveAsAction(QString const& path, EditorTabWidget* docsEdi
 //TODO implementation
 void FileSaveAsAction::execute()
 {
+    RTE_TRACE_SCOPE("file.save");
+
     auto path = std::get<0>(m_memento->m_items);
-    QFile file{path};
+    auto doc = m_docsEditor->getCurrentDocument();
+    QString error;
 
-    if (!file.open(QIODevice::WriteOnly))
+    if (!documentwriters::save(doc, path, &error))
     {
         throw std::runtime_error{
-            QString{"Cann't open file. Error{%1}"}
-                .arg(std::strerror(errno))
+            QString{"Can't write file. Error{%1}"}
+                .arg(error)
                 .toStdString()
         };
     }
 
-    QTextStream file_stream{&file};
-    auto doc = m_docsEditor->getCurrentDocument();
-    auto content = doc->toHtml();
-    file_stream << content;
-    file_stream.flush();
-    m_docsEditor->changeCurrentTitle(path);
+    // An export leaves the document at its path, so Save doesn't write the export again
+    if (documentwriters::isLossless(documentwriters::formatFor(path)))
+    {
+        m_docsEditor->changeCurrentTitle(path);
+    }
 }
 
 const Memento* FileSaveAsAction::getMemento() const
@@ -650,24 +613,21 @@ FileSaveAction::FileSaveAction(QString const& docTitle, EditorTabWidget* docsEdi
 //TODO implementation
 void FileSaveAction::execute()
 {
+    RTE_TRACE_SCOPE("file.save");
+
     auto path = std::get<0>(m_memento->m_items);
     auto document = m_docsEditor->getCurrentDocument();
-    auto content = document->toHtml();
+    QString error;
 
-    QFile file{path};
-    if (!file.open(QIODevice::WriteOnly))
+    if (!documentwriters::save(document, path, &error))
     {
         throw std::runtime_error{
-            QString{"Can't open file. Error{%1}"}
-                .arg(std::strerror(errno))
+            QString{"Can't write file. Error{%1}"}
+                .arg(error)
                 .toStdString()
         };
     }
 
-    QTextStream file_stream{&file};
-    file_stream << content;
-    file_stream.flush();
-
     m_docsEditor->changeCurrentTitle(path);
 }
 
@@ -865,3 +825,203 @@ void EditUndoAction::setMemento(MementoUP memento)
 
     throwInvalidMemento(casted);
 }
+
+TextReplaceMemento::TextReplaceMemento(int pos, int length, QString const& text)
+    : StreamItemsMemento{pos, length, text}
+{   }
+
+ActionType TextReplaceMemento::getActionType() const
+{
+    return ActionType::TextReplace;
+}
+
+TextReplaceAction::TextReplaceAction(QTextEdit* textEditor)
+    : m_editor{textEditor}
+    , m_memento{nullptr}
+{   }
+
+TextReplaceAction::TextReplaceAction(int pos, int length, QString const& text, QTextEdit* textEditor)
+    : m_editor{textEditor}
+    , m_memento{std::make_unique<TextReplaceMemento>(pos, length, text)}
+{   }
+
+void TextReplaceAction::execute()
+{
+    auto const& [pos, length, text] = m_memento->m_items;
+
+    auto cursor = m_editor->textCursor();
+    cursor.setPosition(pos);
+    cursor.setPosition(pos + length, QTextCursor::KeepAnchor);
+    cursor.insertText(text);
+}
+
+const Memento* TextReplaceAction::getMemento() const
+{
+    return m_memento.get();
+}
+
+void TextReplaceAction::setMemento(MementoUP memento)
+{
+    auto casted = tools::unique_dyn_cast<TextReplaceMemento>(std::move(memento));
+
+    if (casted)
+    {
+        m_memento = std::move(casted);
+        return;
+    }
+
+    throwInvalidMemento(casted);
+}
+
+CompositeMemento::CompositeMemento(std::vector<ActionUP> children)
+    : m_children{std::move(children)}
+{   }
+
+ActionType CompositeMemento::getActionType() const
+{
+    return ActionType::Composite;
+}
+
+QByteArray CompositeMemento::toRaw() const
+{
+    QByteArray raw;
+    QDataStream rawStream{ &raw, QIODevice::WriteOnly };
+    writeRaw(rawStream);
+
+    return raw;
+}
+
+void CompositeMemento::initFromRaw(QByteArray&& raw)
+{
+    QDataStream rawStream{ &raw, QIODevice::ReadOnly };
+    readRaw(rawStream);
+}
+
+void CompositeMemento::writeRaw(QDataStream& stream) const
+{
+    stream << static_cast<quint32>(m_children.size());
+
+    for (auto const& child : m_children)
+    {
+        auto memento = child->getMemento();
+        stream << static_cast<int>(memento->getActionType());
+
+        auto block = tools::beginBlock(stream);
+        memento->writeRaw(stream);
+        tools::endBlock(stream, block);
+    }
+}
+
+namespace
+{
+
+// Composites only nest a few levels deep, a deeper frame is crafted to blow the stack
+constexpr int maxCompositeDepth = 8;
+
+thread_local int compositeDepth = 0;
+
+struct CompositeDepthGuard
+{
+    CompositeDepthGuard() { ++compositeDepth; }
+    ~CompositeDepthGuard() { --compositeDepth; }
+};
+
+}
+
+// Frames come from other peers: a block running past the data, a child reading past
+// its block or composites nested deeper than maxCompositeDepth mark the stream corrupt
+// and drop every child, so nothing half-read runs
+void CompositeMemento::readRaw(QDataStream& stream)
+{
+    auto builder = GlobalMementoBuilder::instance();
+    auto device = stream.device();
+    CompositeDepthGuard depth;
+
+    m_children.clear();
+
+    if (compositeDepth > maxCompositeDepth)
+    {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+
+    quint32 count{0};
+    stream >> count;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        int type{0};
+        quint32 length{0};
+        stream >> type >> length;
+
+        auto blockEnd = device->pos() + length;
+        if (stream.status() != QDataStream::Ok || blockEnd > device->size())
+        {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+
+        auto actionType = static_cast<ActionType>(type);
+
+        if (builder->actionIsSupported(actionType))
+        {
+            m_children.emplace_back(builder->deserializeAction(stream, actionType));
+        }
+
+        if (stream.status() != QDataStream::Ok || device->pos() > blockEnd)
+        {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+
+        device->seek(blockEnd);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        m_children.clear();
+    }
+}
+
+CompositeAction::CompositeAction(QTextEdit* textEditor)
+    : m_editor{textEditor}
+    , m_memento{nullptr}
+{   }
+
+CompositeAction::CompositeAction(std::vector<ActionUP> children, QTextEdit* textEditor)
+    : m_editor{textEditor}
+    , m_memento{std::make_unique<CompositeMemento>(std::move(children))}
+{   }
+
+void CompositeAction::execute()
+{
+    RTE_TRACE_SCOPE("action.composite");
+
+    auto cursor = m_editor->textCursor();
+    cursor.beginEditBlock();
+
+    for (auto const& child : m_memento->m_children)
+    {
+        child->execute();
+    }
+
+    cursor.endEditBlock();
+}
+
+const Memento* CompositeAction::getMemento() const
+{
+    return m_memento.get();
+}
+
+void CompositeAction::setMemento(MementoUP memento)
+{
+    auto casted = tools::unique_dyn_cast<CompositeMemento>(std::move(memento));
+
+    if (casted)
+    {
+        m_memento = std::move(casted);
+        return;
+    }
+
+    throwInvalidMemento(casted);
+}
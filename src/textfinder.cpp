@@ -0,0 +1,528 @@
+#include "textfinder.hpp"
+#include "textsearch.hpp"
+#include "tools.hpp"
+#include "texteditoractions.hpp"
+#include "dbussession.hpp"
+#include "logging.hpp"
+#include "tracing.hpp"
+
+#include <QColor>
+#include <QScrollBar>
+#include <QTextBlock>
+
+#include <algorithm>
+#include <climits>
+
+TextFinder::TextFinder(EditorTabWidget* docsEditor, QObject* parent)
+    : QObject{parent}
+    , m_docsEditor{docsEditor}
+    , m_caseSensitive{false}
+    , m_regexMode{false}
+    , m_revision{-1}
+    , m_pendingChunks{0}
+    , m_alignedChunks{0}
+    , m_alignedEnd{0}
+    , m_count{0}
+    , m_replacePending{false}
+{
+    m_restartTimer.setSingleShot(true);
+    m_restartTimer.setInterval(200);
+
+    connect(&m_restartTimer, &QTimer::timeout, this, &TextFinder::restart);
+    connect(&m_regexSearch, &RegexSearch::matchesChanged, this, &TextFinder::onRegexMatchesChanged);
+    connect(m_docsEditor, &EditorTabWidget::currentEditorChanged, this, &TextFinder::onEditorChanged);
+    connect(m_docsEditor, &EditorTabWidget::currentDocumentChanged, this, &TextFinder::onDocumentChanged);
+
+    onEditorChanged(m_docsEditor->getEditor());
+    onDocumentChanged(m_docsEditor->getCurrentDocument());
+}
+
+TextFinder::~TextFinder()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void TextFinder::find(QString const& needle, bool caseSensitive, bool regex)
+{
+    m_needle = needle;
+    m_caseSensitive = caseSensitive;
+    m_regexMode = regex;
+    m_replacePending = false;
+    restart();
+}
+
+void TextFinder::clear()
+{
+    m_needle.clear();
+    m_replacePending = false;
+    restart();
+}
+
+auto TextFinder::count() const -> int
+{
+    return m_regexMode ? m_regexSearch.count() : m_count;
+}
+
+auto TextFinder::next() -> bool
+{
+    if (!m_editor)
+    {
+        return false;
+    }
+
+    auto match = matchAfter(m_editor->textCursor().selectionEnd());
+    if (match.first < 0)
+    {
+        match = matchAfter(0);
+    }
+
+    select(match);
+    return match.first >= 0;
+}
+
+auto TextFinder::previous() -> bool
+{
+    if (!m_editor)
+    {
+        return false;
+    }
+
+    auto match = matchBefore(m_editor->textCursor().selectionStart());
+    if (match.first < 0)
+    {
+        match = matchBefore(INT_MAX);
+    }
+
+    select(match);
+    return match.first >= 0;
+}
+
+auto TextFinder::replaceCurrent(QString const& replacement) -> bool
+{
+    if (!m_editor || m_needle.isEmpty())
+    {
+        return false;
+    }
+
+    auto cursor = m_editor->textCursor();
+    auto selected = cursor.selectedText();
+    auto text = replacement;
+    auto matched = false;
+
+    // Matched in its block like RegexSearch scans, so lookarounds, anchors and \b see
+    // the text around the selection
+    if (m_regexMode)
+    {
+        auto block = cursor.document()->findBlock(cursor.selectionStart());
+        auto offset = cursor.selectionStart() - block.position();
+        auto match = m_regex.match(block.text(), offset, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+        matched = match.hasMatch() && match.capturedLength() == selected.size();
+        text = matched ? RegexSearch::expand(match, replacement) : QString{};
+    }
+    else
+    {
+        auto cs = m_caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+        matched = selected.compare(m_needle, cs) == 0;
+    }
+
+    if (!cursor.hasSelection() || !matched)
+    {
+        next();
+        return false;
+    }
+
+    auto action = std::make_unique<TextReplaceAction>(cursor.selectionStart(), selected.size(), text, m_editor);
+    action->execute();
+    DBusSession::instance()->sendAction(std::move(action));
+
+    next();
+    return true;
+}
+
+// Matches come from the search, which has to be finished and up to date: the
+// replacement waits for it otherwise, leaving the GUI thread alone meanwhile
+void TextFinder::replaceAll(QString const& replacement)
+{
+    if (!m_editor || m_needle.isEmpty())
+    {
+        emit replaced(0);
+        return;
+    }
+
+    auto upToDate = m_regexMode
+        ? m_regexSearch.isComplete()
+        : m_pendingChunks == 0 && m_document && m_document->revision() == m_revision;
+
+    if (upToDate)
+    {
+        replaceMatches(replacement);
+        return;
+    }
+
+    m_replacement = replacement;
+    m_replacePending = true;
+
+    if (!m_regexMode && !m_restartTimer.isActive() && m_pendingChunks == 0)
+    {
+        restart();
+    }
+}
+
+// Children go back to front so earlier positions stay valid
+auto TextFinder::replaceMatches(QString const& replacement) -> void
+{
+    RTE_TRACE_SCOPE("search.replaceAll");
+
+    std::vector<ActionUP> children;
+
+    if (m_regexMode)
+    {
+        auto replacements = m_regexSearch.replacements(replacement);
+        children.reserve(replacements.size());
+
+        for (auto it = replacements.rbegin(); it != replacements.rend(); ++it)
+        {
+            auto const& [pos, length, text] = *it;
+            children.push_back(std::make_unique<TextReplaceAction>(pos, length, text, m_editor));
+        }
+    }
+    else
+    {
+        children.reserve(m_count);
+
+        for (auto chunk = m_chunks.rbegin(); chunk != m_chunks.rend(); ++chunk)
+        {
+            for (auto it = chunk->matches.rbegin(); it != chunk->matches.rend(); ++it)
+            {
+                children.push_back(std::make_unique<TextReplaceAction>(*it, m_needle.size(), replacement, m_editor));
+            }
+        }
+    }
+
+    auto count = static_cast<int>(children.size());
+
+    if (count > 0)
+    {
+        auto action = std::make_unique<CompositeAction>(std::move(children), m_editor);
+        action->execute();
+        DBusSession::instance()->sendAction(std::move(action));
+
+        RTE_LOG_INFO("replaced all", {"matches", count}, {"regex", m_regexMode});
+    }
+
+    emit replaced(count);
+}
+
+void TextFinder::onEditorChanged(QTextEdit* editor)
+{
+    if (m_editor)
+    {
+        disconnect(m_editor->verticalScrollBar(), nullptr, this, nullptr);
+        disconnect(m_editor->horizontalScrollBar(), nullptr, this, nullptr);
+        m_editor->setExtraSelections(blocktracking::otherSelections(m_editor, HighlightProperty));
+    }
+
+    m_editor = editor;
+
+    connect(m_editor->verticalScrollBar(), &QScrollBar::valueChanged, this, &TextFinder::updateHighlights);
+    connect(m_editor->horizontalScrollBar(), &QScrollBar::valueChanged, this, &TextFinder::updateHighlights);
+
+    updateHighlights();
+}
+
+void TextFinder::onDocumentChanged(QTextDocument* doc)
+{
+    if (m_document)
+    {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &TextFinder::onContentsChange);
+    }
+
+    m_document = doc;
+    m_replacePending = false;
+    connect(m_document, &QTextDocument::contentsChange, this, &TextFinder::onContentsChange);
+
+    restart();
+}
+
+// Previews and other layout-only updates don't bump the revision
+void TextFinder::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (m_needle.isEmpty() || m_regexMode || m_document->revision() == m_revision)
+    {
+        return;
+    }
+
+    cancel();
+    m_chunks.clear();
+    m_count = 0;
+    updateHighlights();
+
+    m_restartTimer.start();
+}
+
+void TextFinder::updateHighlights()
+{
+    if (!m_editor)
+    {
+        return;
+    }
+
+    auto selections = blocktracking::otherSelections(m_editor, HighlightProperty);
+
+    if (!m_needle.isEmpty() && count() > 0 && m_editor->document() == m_document)
+    {
+        auto viewport = m_editor->viewport()->rect();
+        auto first = m_editor->cursorForPosition(viewport.topLeft()).position();
+        auto last = m_editor->cursorForPosition(viewport.bottomRight()).position();
+
+        QTextCharFormat fmt;
+        fmt.setBackground(QColor{255, 225, 110});
+        fmt.setProperty(HighlightProperty, true);
+
+        for (auto [pos, length] : matchesIn(first, last))
+        {
+            QTextCursor cursor{m_document.data()};
+            cursor.setPosition(pos);
+            cursor.setPosition(pos + length, QTextCursor::KeepAnchor);
+            selections.append(QTextEdit::ExtraSelection{ cursor, fmt });
+        }
+    }
+
+    m_editor->setExtraSelections(selections);
+}
+
+auto TextFinder::restart() -> void
+{
+    cancel();
+    m_restartTimer.stop();
+    m_chunks.clear();
+    m_count = 0;
+
+    m_regexSearch.stop();
+
+    if (m_needle.isEmpty() || !m_document)
+    {
+        updateHighlights();
+        emit matchesChanged(0, true);
+        return;
+    }
+
+    RTE_TRACE_SCOPE("search.start");
+
+    m_elapsed.start();
+
+    if (m_regexMode)
+    {
+        auto options = QRegularExpression::UseUnicodePropertiesOption;
+        if (!m_caseSensitive)
+        {
+            options |= QRegularExpression::CaseInsensitiveOption;
+        }
+
+        m_regex = QRegularExpression{m_needle, options};
+        if (!m_regex.isValid())
+        {
+            updateHighlights();
+            emit matchesChanged(0, true);
+            emit invalidPattern(m_regex.errorString());
+            return;
+        }
+
+        m_regexSearch.start(m_document, m_regex);
+        return;
+    }
+
+    m_revision = m_document->revision();
+
+    m_text = m_document->toPlainText();
+    auto chunks = std::max(1, static_cast<int>((m_text.size() + textsearch::chunkSize - 1) / textsearch::chunkSize));
+
+    m_chunks.assign(chunks, Chunk{ {}, false });
+    m_pendingChunks = chunks;
+
+    auto token = m_generation.token();
+    auto generation = token.generation;
+
+    for (int c = 0; c < chunks; ++c)
+    {
+        tools::startTask(&m_pool, [=, text = m_text, needle = m_needle, cs = m_caseSensitive]
+            {
+                if (token.isCancelled())
+                {
+                    return;
+                }
+
+                auto matches = textsearch::findAll(text, needle, cs, c * textsearch::chunkSize, (c + 1) * textsearch::chunkSize);
+
+                QMetaObject::invokeMethod(this, [=]
+                    {
+                        onChunkFound(generation, c, matches);
+                    },
+                    Qt::QueuedConnection
+                );
+            }
+        );
+    }
+}
+
+// Tasks of an older search skip their work and their results are dropped
+auto TextFinder::cancel() -> void
+{
+    m_generation.cancel(m_pool);
+    m_pendingChunks = 0;
+    m_alignedChunks = 0;
+    m_alignedEnd = 0;
+    m_text.clear();
+}
+
+auto TextFinder::onChunkFound(quint64 generation, int index, std::vector<int> const& matches) -> void
+{
+    if (!m_generation.isCurrent(generation))
+    {
+        return;
+    }
+
+    m_chunks[index] = Chunk{ matches, true };
+    m_count += static_cast<int>(matches.size());
+    --m_pendingChunks;
+
+    alignChunks();
+
+    updateHighlights();
+    emit matchesChanged(m_count, m_pendingChunks == 0);
+
+    if (m_pendingChunks == 0)
+    {
+        m_text.clear();
+
+        RTE_LOG_DEBUG("search finished", {"matches", m_count}, {"chunks", static_cast<int>(m_chunks.size())}, {"ms", m_elapsed.elapsed()});
+        emit finished(m_count, m_elapsed.elapsed());
+
+        if (m_replacePending)
+        {
+            m_replacePending = false;
+            replaceMatches(m_replacement);
+        }
+    }
+}
+
+// Chunks are aligned in order as soon as the one before is, so once the search is
+// finished the matches are those of a single scan
+auto TextFinder::alignChunks() -> void
+{
+    for (; m_alignedChunks < static_cast<int>(m_chunks.size()) && m_chunks[m_alignedChunks].done; ++m_alignedChunks)
+    {
+        auto& matches = m_chunks[m_alignedChunks].matches;
+        auto before = static_cast<int>(matches.size());
+
+        textsearch::realign(m_text, m_needle, m_caseSensitive, m_alignedEnd, (m_alignedChunks + 1) * textsearch::chunkSize, matches);
+        m_count += static_cast<int>(matches.size()) - before;
+
+        if (!matches.empty())
+        {
+            m_alignedEnd = matches.back() + m_needle.size();
+        }
+    }
+}
+
+void TextFinder::onRegexMatchesChanged(int count, bool complete)
+{
+    updateHighlights();
+    emit matchesChanged(count, complete);
+
+    if (complete && m_elapsed.isValid())
+    {
+        RTE_LOG_DEBUG("regex search finished", {"matches", count}, {"ms", m_elapsed.elapsed()});
+        emit finished(count, m_elapsed.elapsed());
+        m_elapsed.invalidate();
+    }
+
+    if (complete && m_replacePending)
+    {
+        m_replacePending = false;
+        replaceMatches(m_replacement);
+    }
+}
+
+auto TextFinder::matchAfter(int pos) const -> Match
+{
+    if (m_regexMode)
+    {
+        return m_regexSearch.matchAfter(pos);
+    }
+
+    for (auto c = std::max(0, pos / textsearch::chunkSize); c < static_cast<int>(m_chunks.size()); ++c)
+    {
+        auto const& matches = m_chunks[c].matches;
+        auto it = std::lower_bound(matches.begin(), matches.end(), pos);
+
+        if (it != matches.end())
+        {
+            return { *it, m_needle.size() };
+        }
+    }
+
+    return { -1, 0 };
+}
+
+auto TextFinder::matchBefore(int pos) const -> Match
+{
+    if (m_regexMode)
+    {
+        return m_regexSearch.matchBefore(pos);
+    }
+
+    for (auto c = std::min(static_cast<int>(m_chunks.size()) - 1, pos / textsearch::chunkSize); c >= 0; --c)
+    {
+        auto const& matches = m_chunks[c].matches;
+        auto it = std::lower_bound(matches.begin(), matches.end(), pos);
+
+        if (it != matches.begin())
+        {
+            return { *std::prev(it), m_needle.size() };
+        }
+    }
+
+    return { -1, 0 };
+}
+
+auto TextFinder::matchesIn(int begin, int end) const -> std::vector<Match>
+{
+    if (m_regexMode)
+    {
+        return m_regexSearch.matchesIn(begin, end);
+    }
+
+    std::vector<Match> result;
+    begin = std::max(0, begin - m_needle.size());
+
+    auto firstChunk = begin / textsearch::chunkSize;
+    auto lastChunk = std::min(static_cast<int>(m_chunks.size()) - 1, end / textsearch::chunkSize);
+
+    for (auto c = firstChunk; c <= lastChunk; ++c)
+    {
+        auto const& matches = m_chunks[c].matches;
+
+        for (auto it = std::lower_bound(matches.begin(), matches.end(), begin); it != matches.end() && *it <= end; ++it)
+        {
+            result.emplace_back(*it, m_needle.size());
+        }
+    }
+
+    return result;
+}
+
+auto TextFinder::select(Match match) -> void
+{
+    auto [pos, length] = match;
+    if (pos < 0)
+    {
+        return;
+    }
+
+    auto cursor = m_editor->textCursor();
+    cursor.setPosition(pos);
+    cursor.setPosition(pos + length, QTextCursor::KeepAnchor);
+    m_editor->setTextCursor(cursor);
+}
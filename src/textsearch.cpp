@@ -0,0 +1,339 @@
+#include "textsearch.hpp"
+#include "tools.hpp"
+#include "tracing.hpp"
+
+#include <QChar>
+#include <QSemaphore>
+
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RTE_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace textsearch
+{
+
+namespace
+{
+
+struct Needle
+{
+    std::vector<ushort> chars;
+    bool fold;
+};
+
+inline auto foldChar(ushort c) -> ushort
+{
+    if (c < 0x80)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<ushort>(c | 0x20) : c;
+    }
+
+    return static_cast<ushort>(QChar::toCaseFolded(static_cast<uint>(c)));
+}
+
+inline auto matchesAt(ushort const* s, Needle const& needle) -> bool
+{
+    auto m = needle.chars.size();
+
+    if (needle.fold)
+    {
+        for (std::size_t k = 0; k < m; ++k)
+        {
+            if (foldChar(s[k]) != needle.chars[k])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    return std::equal(needle.chars.begin(), needle.chars.end(), s);
+}
+
+// Candidates start in [i, end), the text is readable up to end + m - 1
+auto findScalar(ushort const* s, int i, int end, int& next, Needle const& needle, std::vector<int>& out) -> void
+{
+    auto m = static_cast<int>(needle.chars.size());
+
+    for (i = std::max(i, next); i < end; ++i)
+    {
+        if (matchesAt(s + i, needle))
+        {
+            out.push_back(i);
+            next = i + m;
+            i = next - 1;
+        }
+    }
+}
+
+#ifdef RTE_SEARCH_X86
+
+// Each 16-bit lane sets two adjacent bits of a byte movemask
+template<typename Mask>
+inline auto reportCandidates(Mask mask, ushort const* s, int i, int& next, Needle const& needle, std::vector<int>& out) -> void
+{
+    while (mask)
+    {
+        auto bit = __builtin_ctz(mask);
+        mask &= ~(Mask{3} << bit);
+
+        auto pos = i + bit / 2;
+        if (pos >= next && matchesAt(s + pos, needle))
+        {
+            out.push_back(pos);
+            next = pos + static_cast<int>(needle.chars.size());
+        }
+    }
+}
+
+// Same result as foldChar wherever foldChar gives ASCII: besides A-Z only LATIN SMALL
+// LETTER LONG S and KELVIN SIGN fold into ASCII, to 's' and 'k'
+__attribute__((target("sse2")))
+inline auto foldSse2(__m128i x) -> __m128i
+{
+    auto upper = _mm_and_si128(_mm_cmpgt_epi16(x, _mm_set1_epi16('A' - 1)), _mm_cmplt_epi16(x, _mm_set1_epi16('Z' + 1)));
+    x = _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi16(0x20)));
+
+    auto longS = _mm_cmpeq_epi16(x, _mm_set1_epi16(0x017F));
+    auto kelvin = _mm_cmpeq_epi16(x, _mm_set1_epi16(0x212A));
+    x = _mm_or_si128(_mm_andnot_si128(longS, x), _mm_and_si128(longS, _mm_set1_epi16('s')));
+    return _mm_or_si128(_mm_andnot_si128(kelvin, x), _mm_and_si128(kelvin, _mm_set1_epi16('k')));
+}
+
+__attribute__((target("sse2")))
+auto findSse2(ushort const* s, int i, int end, int& next, Needle const& needle, std::vector<int>& out) -> int
+{
+    constexpr int lanes = 8;
+    auto m = static_cast<int>(needle.chars.size());
+    auto first = _mm_set1_epi16(static_cast<short>(needle.chars.front()));
+    auto last = _mm_set1_epi16(static_cast<short>(needle.chars.back()));
+
+    for (; i + lanes <= end; i += lanes)
+    {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(s + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(s + i + m - 1));
+
+        if (needle.fold)
+        {
+            a = foldSse2(a);
+            b = foldSse2(b);
+        }
+
+        auto eq = _mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+        reportCandidates(mask, s, i, next, needle, out);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline auto foldAvx2(__m256i x) -> __m256i
+{
+    auto upper = _mm256_and_si256(_mm256_cmpgt_epi16(x, _mm256_set1_epi16('A' - 1)), _mm256_cmpgt_epi16(_mm256_set1_epi16('Z' + 1), x));
+    x = _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi16(0x20)));
+
+    auto longS = _mm256_cmpeq_epi16(x, _mm256_set1_epi16(0x017F));
+    auto kelvin = _mm256_cmpeq_epi16(x, _mm256_set1_epi16(0x212A));
+    x = _mm256_blendv_epi8(x, _mm256_set1_epi16('s'), longS);
+    return _mm256_blendv_epi8(x, _mm256_set1_epi16('k'), kelvin);
+}
+
+__attribute__((target("avx2")))
+auto findAvx2(ushort const* s, int i, int end, int& next, Needle const& needle, std::vector<int>& out) -> int
+{
+    constexpr int lanes = 16;
+    auto m = static_cast<int>(needle.chars.size());
+    auto first = _mm256_set1_epi16(static_cast<short>(needle.chars.front()));
+    auto last = _mm256_set1_epi16(static_cast<short>(needle.chars.back()));
+
+    for (; i + lanes <= end; i += lanes)
+    {
+        auto a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s + i));
+        auto b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s + i + m - 1));
+
+        if (needle.fold)
+        {
+            a = foldAvx2(a);
+            b = foldAvx2(b);
+        }
+
+        auto eq = _mm256_and_si256(_mm256_cmpeq_epi16(a, first), _mm256_cmpeq_epi16(b, last));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+        reportCandidates(mask, s, i, next, needle, out);
+    }
+
+    return i;
+}
+
+enum class Kernel
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+auto detectKernel() -> Kernel
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return Kernel::Avx2;
+    }
+
+    return __builtin_cpu_supports("sse2") ? Kernel::Sse2 : Kernel::Scalar;
+}
+
+auto kernel() -> Kernel
+{
+    static auto const detected = detectKernel();
+    return detected;
+}
+
+#endif
+
+auto makeNeedle(QStringView needle, bool caseSensitive) -> Needle
+{
+    auto chars = reinterpret_cast<ushort const*>(needle.data());
+    Needle result{ std::vector<ushort>(chars, chars + needle.size()), !caseSensitive };
+
+    if (result.fold)
+    {
+        std::transform(result.chars.begin(), result.chars.end(), result.chars.begin(), foldChar);
+    }
+
+    return result;
+}
+
+// The kernels fold only what folds into ASCII, so a non-ASCII letter at either end of
+// the needle could miss its other-case variants in the text
+auto vectorizable(Needle const& needle) -> bool
+{
+    if (!needle.fold)
+    {
+        return true;
+    }
+
+    auto ascii = [](ushort c)
+    {
+        return c < 0x80;
+    };
+
+    return ascii(needle.chars.front()) && ascii(needle.chars.back());
+}
+
+// Candidates start in [begin, end), matches reach at most end + needle size - 1
+auto findRange(ushort const* s, int begin, int end, Needle const& needle) -> std::vector<int>
+{
+    std::vector<int> out;
+    auto next = begin;
+    auto i = begin;
+
+#ifdef RTE_SEARCH_X86
+    if (vectorizable(needle))
+    {
+        switch (kernel())
+        {
+        case Kernel::Avx2: i = findAvx2(s, i, end, next, needle, out); break;
+        case Kernel::Sse2: i = findSse2(s, i, end, next, needle, out); break;
+        case Kernel::Scalar: break;
+        }
+    }
+#endif
+
+    findScalar(s, i, end, next, needle, out);
+    return out;
+}
+
+}
+
+auto kernelName() -> char const*
+{
+#ifdef RTE_SEARCH_X86
+    switch (kernel())
+    {
+    case Kernel::Avx2: return "avx2";
+    case Kernel::Sse2: return "sse2";
+    case Kernel::Scalar: break;
+    }
+#endif
+
+    return "scalar";
+}
+
+auto findAll(QStringView text, QStringView needle, bool caseSensitive, int begin, int end) -> std::vector<int>
+{
+    if (end < 0)
+    {
+        end = static_cast<int>(text.size());
+    }
+
+    end = std::min(end, static_cast<int>(text.size() - needle.size()) + 1);
+
+    if (needle.isEmpty() || begin >= end)
+    {
+        return {};
+    }
+
+    return findRange(reinterpret_cast<ushort const*>(text.data()), begin, end, makeNeedle(needle, caseSensitive));
+}
+
+// A chunk with no match before from agrees with the scan that got there; otherwise
+// its matches are all redone from the end of the last match before it
+auto realign(QStringView text, QStringView needle, bool caseSensitive, int from, int end, std::vector<int>& matches) -> void
+{
+    if (!matches.empty() && matches.front() < from)
+    {
+        matches = findAll(text, needle, caseSensitive, from, end);
+    }
+}
+
+auto findAllParallel(QString const& text, QString const& needle, bool caseSensitive) -> std::vector<int>
+{
+    RTE_TRACE_SCOPE("search.findAll");
+
+    auto chunks = static_cast<int>((text.size() + chunkSize - 1) / chunkSize);
+    if (chunks <= 1)
+    {
+        return findAll(text, needle, caseSensitive);
+    }
+
+    std::vector<std::vector<int>> results(chunks);
+    QSemaphore done;
+
+    for (int c = 0; c < chunks; ++c)
+    {
+        tools::startTask(QThreadPool::globalInstance(), [&, c]
+            {
+                results[c] = findAll(text, needle, caseSensitive, c * chunkSize, (c + 1) * chunkSize);
+                done.release();
+            }
+        );
+    }
+
+    done.acquire(chunks);
+
+    std::vector<int> matches;
+    auto next = 0;
+
+    for (int c = 0; c < chunks; ++c)
+    {
+        auto& chunk = results[c];
+        realign(text, needle, caseSensitive, next, (c + 1) * chunkSize, chunk);
+
+        if (!chunk.empty())
+        {
+            matches.insert(matches.end(), chunk.begin(), chunk.end());
+            next = chunk.back() + static_cast<int>(needle.size());
+        }
+    }
+
+    return matches;
+}
+
+}
@@ -0,0 +1,240 @@
+#include "tracing.hpp"
+
+#if defined(RICHTEXT_TRACING)
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace tracing
+{
+
+namespace
+{
+
+constexpr std::size_t ringCapacity = 1 << 14;
+
+// Rings of exited threads kept for a dump that hasn't happened yet; past that the
+// oldest go, so short-lived threads can't grow the registry without bound
+constexpr std::size_t maxExitedRings = 16;
+
+struct Slot
+{
+    std::atomic<char const*> name{nullptr};
+    std::atomic<std::int64_t> begin{0};
+    std::atomic<std::int64_t> end{0};
+};
+
+// Single writer (the owning thread), read concurrently by dumps. Slots that may
+// have been overwritten while a dump copied them are dropped by re-checking `head`.
+struct Ring
+{
+    explicit Ring(int threadId)
+        : tid{threadId}
+    {   }
+
+    void push(char const* name, std::int64_t beginNs, std::int64_t endNs)
+    {
+        auto index = head.load(std::memory_order_relaxed);
+        auto& slot = slots[index % ringCapacity];
+
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.begin.store(beginNs, std::memory_order_relaxed);
+        slot.end.store(endNs, std::memory_order_relaxed);
+
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    int tid;
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<bool> exited{false};
+    std::array<Slot, ringCapacity> slots;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+    int nextTid{0};
+};
+
+// Never destroyed: threads of leaked pools may still exit during static destruction
+Registry& registry()
+{
+    static auto instance = new Registry;
+    return *instance;
+}
+
+// Drops the oldest rings of exited threads beyond maxExitedRings
+void trimExited(Registry& reg)
+{
+    auto exited = static_cast<std::size_t>(std::count_if(reg.rings.begin(), reg.rings.end(),
+        [](std::shared_ptr<Ring> const& ring) { return ring->exited.load(std::memory_order_acquire); }));
+
+    for (auto it = reg.rings.begin(); it != reg.rings.end() && exited > maxExitedRings; )
+    {
+        if ((*it)->exited.load(std::memory_order_acquire))
+        {
+            it = reg.rings.erase(it);
+            --exited;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+// Marks the ring when its thread exits; the ring stays registered so its spans still
+// end up in the next dump, which then drops it
+struct RingOwner
+{
+    RingOwner()
+    {
+        auto& reg = registry();
+        std::lock_guard lock{reg.mutex};
+
+        ring = std::make_shared<Ring>(reg.nextTid++);
+        reg.rings.push_back(ring);
+    }
+
+    ~RingOwner()
+    {
+        ring->exited.store(true, std::memory_order_release);
+
+        auto& reg = registry();
+        std::lock_guard lock{reg.mutex};
+        trimExited(reg);
+    }
+
+    std::shared_ptr<Ring> ring;
+};
+
+Ring& threadRing()
+{
+    thread_local RingOwner owner;
+    return *owner.ring;
+}
+
+void appendEvents(QJsonArray& events, Ring const& ring, qint64 pid)
+{
+    auto last = ring.head.load(std::memory_order_acquire);
+    auto first = last > ringCapacity ? last - ringCapacity : 0;
+
+    std::vector<QJsonObject> copied;
+    copied.reserve(static_cast<std::size_t>(last - first));
+
+    for (auto index = first; index < last; ++index)
+    {
+        auto const& slot = ring.slots[index % ringCapacity];
+        auto begin = slot.begin.load(std::memory_order_relaxed);
+        auto end = slot.end.load(std::memory_order_relaxed);
+
+        copied.push_back(QJsonObject{
+            {"name", QString::fromLatin1(slot.name.load(std::memory_order_relaxed))},
+            {"ph", "X"},
+            {"ts", begin / 1000.0},
+            {"dur", (end - begin) / 1000.0},
+            {"pid", pid},
+            {"tid", ring.tid},
+        });
+    }
+
+    auto overwritten = ring.head.load(std::memory_order_acquire);
+    auto valid = overwritten > ringCapacity ? overwritten - ringCapacity : 0;
+
+    for (auto index = std::max(first, valid); index < last; ++index)
+    {
+        events.append(copied[static_cast<std::size_t>(index - first)]);
+    }
+}
+
+}
+
+std::int64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void record(char const* name, std::int64_t beginNs, std::int64_t endNs)
+{
+    threadRing().push(name, beginNs, endNs);
+}
+
+QByteArray dumpChromeTrace()
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        auto& reg = registry();
+        std::lock_guard lock{reg.mutex};
+        rings = reg.rings;
+    }
+
+    auto pid = QCoreApplication::applicationPid();
+
+    // A ring whose thread had exited before the copy holds no spans the dump misses
+    std::vector<Ring const*> dumped;
+
+    QJsonArray events;
+    for (auto const& ring : rings)
+    {
+        if (ring->exited.load(std::memory_order_acquire))
+        {
+            dumped.push_back(ring.get());
+        }
+
+        appendEvents(events, *ring, pid);
+    }
+
+    if (!dumped.empty())
+    {
+        auto& reg = registry();
+        std::lock_guard lock{reg.mutex};
+
+        reg.rings.erase(std::remove_if(reg.rings.begin(), reg.rings.end(),
+            [&](std::shared_ptr<Ring> const& ring)
+            {
+                return std::find(dumped.begin(), dumped.end(), ring.get()) != dumped.end();
+            }),
+            reg.rings.end());
+    }
+
+    QJsonObject trace{
+        {"traceEvents", events},
+        {"displayTimeUnit", "ns"},
+    };
+
+    return QJsonDocument{trace}.toJson(QJsonDocument::Compact);
+}
+
+void writeChromeTrace(QString const& path)
+{
+    QFile file{path};
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        throw std::runtime_error{
+            QString{"Can't write trace to file{%1}. Error{%2}"}
+                .arg(path)
+                .arg(file.errorString())
+                .toStdString()
+        };
+    }
+
+    file.write(dumpChromeTrace());
+}
+
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "zipwriter.hpp"
+
+#include <QDateTime>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr quint32 localHeaderSignature = 0x04034b50;
+constexpr quint32 descriptorSignature = 0x08074b50;
+constexpr quint32 centralHeaderSignature = 0x02014b50;
+constexpr quint32 endOfCentralSignature = 0x06054b50;
+
+constexpr quint16 versionNeeded = 20;
+constexpr quint16 flagDescriptor = 0x0008;
+constexpr quint16 flagUtf8 = 0x0800;
+constexpr quint16 methodStored = 0;
+constexpr quint16 methodDeflated = 8;
+
+constexpr int outputChunk = 64 * 1024;
+
+void append16(QByteArray& out, quint16 value)
+{
+    char bytes[2];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 2);
+}
+
+void append32(QByteArray& out, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+}
+
+ZipWriter::ZipWriter(QIODevice* device)
+    : m_device{device}
+    , m_stream{}
+    , m_inEntry{false}
+    , m_offset{0}
+{
+    auto now = QDateTime::currentDateTime();
+    auto date = now.date();
+    auto time = now.time();
+
+    m_time = static_cast<quint16>((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+    m_date = static_cast<quint16>((std::max(date.year() - 1980, 0) << 9) | (date.month() << 5) | date.day());
+
+    m_buffer.resize(outputChunk);
+}
+
+ZipWriter::~ZipWriter()
+{
+    if (m_inEntry)
+    {
+        deflateEnd(&m_stream);
+    }
+}
+
+auto ZipWriter::addStored(QString const& name, QByteArray const& data) -> bool
+{
+    Entry entry{ name.toUtf8(), methodStored, flagUtf8, 0, 0, 0, m_offset };
+    entry.crc = crc32(0, reinterpret_cast<Bytef const*>(data.constData()), data.size());
+    entry.compressedSize = data.size();
+    entry.size = data.size();
+
+    if (!writeLocalHeader(entry) || !put(data))
+    {
+        return false;
+    }
+
+    m_entries.push_back(entry);
+    return true;
+}
+
+auto ZipWriter::beginEntry(QString const& name) -> bool
+{
+    if (m_inEntry)
+    {
+        return false;
+    }
+
+    Entry entry{ name.toUtf8(), methodDeflated, flagUtf8 | flagDescriptor, 0, 0, 0, m_offset };
+
+    // Negative window bits: raw deflate, zip has its own framing
+    m_stream = z_stream{};
+    if (deflateInit2(&m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    m_inEntry = true;
+    m_entries.push_back(entry);
+
+    return writeLocalHeader(entry);
+}
+
+auto ZipWriter::write(QByteArray const& data) -> bool
+{
+    if (!m_inEntry || data.isEmpty())
+    {
+        return m_inEntry;
+    }
+
+    auto& entry = m_entries.back();
+    entry.crc = crc32(entry.crc, reinterpret_cast<Bytef const*>(data.constData()), data.size());
+    entry.size += data.size();
+
+    m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    m_stream.avail_in = data.size();
+
+    return deflateInto(Z_NO_FLUSH);
+}
+
+auto ZipWriter::endEntry() -> bool
+{
+    if (!m_inEntry)
+    {
+        return false;
+    }
+
+    m_stream.next_in = nullptr;
+    m_stream.avail_in = 0;
+
+    auto ok = deflateInto(Z_FINISH);
+    deflateEnd(&m_stream);
+    m_inEntry = false;
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    auto const& entry = m_entries.back();
+
+    QByteArray descriptor;
+    append32(descriptor, descriptorSignature);
+    append32(descriptor, entry.crc);
+    append32(descriptor, entry.compressedSize);
+    append32(descriptor, entry.size);
+
+    return put(descriptor);
+}
+
+auto ZipWriter::finish() -> bool
+{
+    if (m_inEntry && !endEntry())
+    {
+        return false;
+    }
+
+    auto directoryOffset = m_offset;
+
+    QByteArray directory;
+    for (auto const& entry : m_entries)
+    {
+        append32(directory, centralHeaderSignature);
+        append16(directory, versionNeeded);
+        append16(directory, versionNeeded);
+        append16(directory, entry.flags);
+        append16(directory, entry.method);
+        append16(directory, m_time);
+        append16(directory, m_date);
+        append32(directory, entry.crc);
+        append32(directory, entry.compressedSize);
+        append32(directory, entry.size);
+        append16(directory, static_cast<quint16>(entry.name.size()));
+        append16(directory, 0);
+        append16(directory, 0);
+        append16(directory, 0);
+        append16(directory, 0);
+        append32(directory, 0);
+        append32(directory, entry.offset);
+        directory += entry.name;
+    }
+
+    auto directorySize = static_cast<quint32>(directory.size());
+
+    append32(directory, endOfCentralSignature);
+    append16(directory, 0);
+    append16(directory, 0);
+    append16(directory, static_cast<quint16>(m_entries.size()));
+    append16(directory, static_cast<quint16>(m_entries.size()));
+    append32(directory, directorySize);
+    append32(directory, directoryOffset);
+    append16(directory, 0);
+
+    return put(directory);
+}
+
+// Sizes and CRC are left zero when a data descriptor follows
+auto ZipWriter::writeLocalHeader(Entry const& entry) -> bool
+{
+    auto described = (entry.flags & flagDescriptor) != 0;
+
+    QByteArray header;
+    append32(header, localHeaderSignature);
+    append16(header, versionNeeded);
+    append16(header, entry.flags);
+    append16(header, entry.method);
+    append16(header, m_time);
+    append16(header, m_date);
+    append32(header, described ? 0 : entry.crc);
+    append32(header, described ? 0 : entry.compressedSize);
+    append32(header, described ? 0 : entry.size);
+    append16(header, static_cast<quint16>(entry.name.size()));
+    append16(header, 0);
+    header += entry.name;
+
+    return put(header);
+}
+
+auto ZipWriter::deflateInto(int flush) -> bool
+{
+    auto& entry = m_entries.back();
+
+    do
+    {
+        m_stream.next_out = reinterpret_cast<Bytef*>(m_buffer.data());
+        m_stream.avail_out = m_buffer.size();
+
+        auto result = deflate(&m_stream, flush);
+        if (result == Z_STREAM_ERROR)
+        {
+            return false;
+        }
+
+        auto produced = m_buffer.size() - static_cast<int>(m_stream.avail_out);
+        entry.compressedSize += produced;
+
+        if (produced > 0 && !put(QByteArray::fromRawData(m_buffer.constData(), produced)))
+        {
+            return false;
+        }
+    }
+    while (m_stream.avail_out == 0 || (flush == Z_FINISH && m_stream.avail_in > 0));
+
+    return true;
+}
+
+auto ZipWriter::put(QByteArray const& data) -> bool
+{
+    if (m_device->write(data) != data.size())
+    {
+        return false;
+    }
+
+    m_offset += data.size();
+    return true;
+}